@@ -0,0 +1,605 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+// ROS includes
+#include <ros/ros.h>
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/CompressedImage.h>
+#include <cv_bridge/cv_bridge.h>
+
+// OpenCV includes
+#include <opencv2/opencv.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+// Boost for filesystem (C++14 compatible)
+#include <boost/filesystem.hpp>
+
+#include "annexb.hpp"
+#include "log.hpp"
+#include "preview_index.hpp"
+#include "video_output.hpp"
+
+class BagProcessor {
+private:
+    std::string bag_path_;
+    std::string output_dir_;
+    
+    struct TopicInfo {
+        std::string topic_name;
+        std::string msg_type;
+        int msg_count;
+    };
+    
+    std::vector<TopicInfo> image_topics_;
+    std::map<std::string, std::string> topic_directories_;
+    std::map<std::string, int> extraction_counts_;
+    std::map<std::string, std::string> h264_outputs_;  // passthrough topic -> .h264 file
+    
+    // Bag time range from analyzeBag(), used to lay out preview contact sheets
+    double bag_start_time_ = 0.0;
+    double bag_duration_ = 0.0;
+    
+    VideoOutputOptions video_options_;
+    int video_failures_ = 0;
+    
+    bool convertImagesToVideo(const std::string& images_dir, const std::string& output_video_path) {
+        std::cout << "🎬 Converting images to H264 video..." << std::endl;
+        std::cout << "  Input: " << images_dir << std::endl;
+        std::cout << "  Output: " << output_video_path << std::endl;
+        
+        // ffmpeg command to convert images to H264 MP4 at 30fps
+        std::ostringstream cmd;
+        cmd << "ffmpeg -y "  // -y to overwrite output file
+            << "-framerate 30 "  // Input framerate
+            << "-pattern_type glob "  // Use glob pattern
+            << "-i '" << images_dir << "/*.jpg' "  // Input pattern
+            << "-vf 'scale=trunc(iw/2)*2:trunc(ih/2)*2' "  // Ensure even dimensions
+            << "-c:v libx264 "  // H264 codec
+            << "-pix_fmt yuv420p "  // Pixel format
+            << "-r 30 "  // Output framerate  
+            << "'" << output_video_path << "'";
+        
+        std::cout << "Running: " << cmd.str() << std::endl;
+        
+        int result = system(cmd.str().c_str());
+        
+        if (result == 0) {
+            std::cout << "✅ Video conversion successful: " << output_video_path << std::endl;
+            return true;
+        } else {
+            std::cout << "❌ Video conversion failed (exit code: " << result << ")" << std::endl;
+            return false;
+        }
+    }
+
+    // How a topic's messages are turned into frames
+    enum class ConversionPolicy {
+        RawImage,         // sensor_msgs/Image through cv_bridge
+        CompressedImage,  // sensor_msgs/CompressedImage through cv::imdecode
+        H264Passthrough   // CompressedImage with format "h264": Annex-B copied as is
+    };
+
+    // Encoded stream of an H.264 CompressedImage topic, written to
+    // "<prefix>.h264" where MediaSource in the streamer can play it
+    struct H264Writer {
+        std::string path;
+        std::ofstream out;
+        std::vector<annexb::Nal> nals;  // reused for every message
+        size_t bytes = 0;
+        int idr_frames = 0;
+        int parameter_sets = 0;
+    };
+    
+    static const size_t kMaxImageFileName = 64;
+    
+    // Per-topic extraction state. Resolved once per bag and looked up by
+    // connection ID, so the per-message path does no string hashing or copies.
+    struct TopicHandler {
+        std::string topic_name;
+        ConversionPolicy policy = ConversionPolicy::RawImage;
+        std::string path;        // "<topic_dir>/" followed by the current image name
+        size_t dir_length = 0;   // length of the "<topic_dir>/" prefix in path
+        int attempts = 0;
+        int successes = 0;
+        std::unique_ptr<PreviewIndex> preview;
+        std::unique_ptr<LadderEncoder> ladder;  // Ladder and Cmaf modes only
+        std::unique_ptr<H264Writer> h264;       // H264Passthrough only
+    };
+
+    static bool isH264Format(const std::string& format) {
+        std::string lower = format;
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        return lower.find("h264") != std::string::npos;
+    }
+
+    // Appends one message's NAL units to the topic's .h264 file. Only complete
+    // NALs found by the scanner are written, each behind a 4-byte start code,
+    // so leading garbage or a missing start code cannot corrupt the stream.
+    bool appendH264(TopicHandler& handler, const rosbag::MessageInstance& msg) {
+        sensor_msgs::CompressedImageConstPtr compressed_msg = msg.instantiate<sensor_msgs::CompressedImage>();
+        if (!compressed_msg || compressed_msg->data.empty()) {
+            return false;
+        }
+
+        H264Writer& writer = *handler.h264;
+        writer.nals.clear();
+        annexb::splitNalUnits(compressed_msg->data.data(), compressed_msg->data.size(), writer.nals);
+        if (writer.nals.empty()) {
+            return false;
+        }
+
+        static const char kStartCode[4] = {0x00, 0x00, 0x00, 0x01};
+        for (const annexb::Nal& nal : writer.nals) {
+            uint8_t type = nal.type();
+            if (type == 5) {
+                writer.idr_frames++;
+            } else if (type == 7 || type == 8) {
+                writer.parameter_sets++;
+            }
+            writer.out.write(kStartCode, sizeof(kStartCode));
+            writer.out.write(reinterpret_cast<const char*>(nal.data), nal.size);
+            writer.bytes += sizeof(kStartCode) + nal.size;
+        }
+        return static_cast<bool>(writer.out);
+    }
+
+    // Switches a CompressedImage topic to passthrough if its first message is H.264
+    void detectH264(TopicHandler& handler, const rosbag::MessageInstance& msg) {
+        sensor_msgs::CompressedImageConstPtr compressed_msg = msg.instantiate<sensor_msgs::CompressedImage>();
+        if (!compressed_msg || !isH264Format(compressed_msg->format)) {
+            return;
+        }
+
+        handler.policy = ConversionPolicy::H264Passthrough;
+        handler.ladder.reset();  // nothing to re-encode
+        handler.h264.reset(new H264Writer());
+        handler.h264->path = videoPathPrefix(handler.topic_name) + ".h264";
+        handler.h264->out.open(handler.h264->path, std::ios::binary | std::ios::trunc);
+        h264_outputs_[handler.topic_name] = handler.h264->path;
+        std::cout << "🎞️  " << handler.topic_name << " carries H.264 (" << compressed_msg->format
+                  << "), writing " << handler.h264->path << std::endl;
+    }
+    
+    cv::Mat decodeFrame(const rosbag::MessageInstance& msg, ConversionPolicy policy) {
+        if (policy == ConversionPolicy::CompressedImage) {
+            sensor_msgs::CompressedImageConstPtr compressed_msg = msg.instantiate<sensor_msgs::CompressedImage>();
+            return compressed_msg ? cv::imdecode(compressed_msg->data, cv::IMREAD_COLOR) : cv::Mat();
+        }
+        
+        // Convert ROS message to sensor_msgs::Image
+        sensor_msgs::ImageConstPtr image_msg = msg.instantiate<sensor_msgs::Image>();
+        if (!image_msg) {
+            return cv::Mat();
+        }
+        
+        // Convert to OpenCV image using cv_bridge
+        cv_bridge::CvImagePtr cv_ptr;
+        
+        try {
+            // Try to convert the image
+            if (image_msg->encoding == "bgr8" || image_msg->encoding == "rgb8") {
+                cv_ptr = cv_bridge::toCvCopy(image_msg, "bgr8");
+            } else if (image_msg->encoding == "mono8") {
+                cv_ptr = cv_bridge::toCvCopy(image_msg, "mono8");
+            } else if (image_msg->encoding == "mono16") {
+                cv_ptr = cv_bridge::toCvCopy(image_msg, "mono16");
+                // Convert 16-bit to 8-bit
+                cv_ptr->image.convertTo(cv_ptr->image, CV_8UC1, 1.0/256.0);
+            } else {
+                // Try default conversion
+                cv_ptr = cv_bridge::toCvCopy(image_msg, "bgr8");
+            }
+        } catch (cv_bridge::Exception& e) {
+            // If conversion fails, try with original encoding
+            cv_ptr = cv_bridge::toCvCopy(image_msg);
+        }
+        
+        return cv_ptr ? cv_ptr->image : cv::Mat();
+    }
+
+    // "<output_dir>/<topic_dir_name>", the prefix shared by all of a topic's video files
+    std::string videoPathPrefix(const std::string& topic_name) {
+        return output_dir_ + "/" + boost::filesystem::path(topic_directories_[topic_name]).filename().string();
+    }
+
+    // Helper function to replace filesystem functionality
+    bool file_exists(const std::string& path) {
+        struct stat buffer;
+        return (stat(path.c_str(), &buffer) == 0);
+    }
+
+    void create_directories(const std::string& path) {
+        boost::filesystem::create_directories(path);
+    }
+
+public:
+    BagProcessor(const std::string& bag_path, const std::string& output_dir = "extracted_images") 
+        : bag_path_(bag_path), output_dir_(output_dir) {}
+
+    void setVideoOutputOptions(const VideoOutputOptions& options) {
+        video_options_ = options;
+    }
+
+    // Per-topic number of images written by the last extractImages() call
+    const std::map<std::string, int>& getExtractionCounts() const {
+        return extraction_counts_;
+    }
+
+    bool analyzeBag() {
+        std::cout << "=== ANALYZING BAG FILE ===" << std::endl;
+        std::cout << "Bag file: " << bag_path_ << std::endl;
+        std::cout << "==============================" << std::endl;
+
+        try {
+            rosbag::Bag bag;
+            bag.open(bag_path_, rosbag::bagmode::Read);
+
+            // Get bag info
+            rosbag::View view(bag);
+            
+            // Count total messages and get duration
+            int total_messages = 0;
+            ros::Time start_time = ros::TIME_MAX;
+            ros::Time end_time = ros::TIME_MIN;
+            
+            std::map<std::string, int> topic_counts;
+            std::map<std::string, std::string> topic_types;
+
+            // First pass: collect metadata
+            for (const rosbag::MessageInstance& msg : view) {
+                total_messages++;
+                
+                if (msg.getTime() < start_time) start_time = msg.getTime();
+                if (msg.getTime() > end_time) end_time = msg.getTime();
+                
+                std::string topic = msg.getTopic();
+                topic_counts[topic]++;
+                topic_types[topic] = msg.getDataType();
+            }
+
+            double duration = (end_time - start_time).toSec();
+            bag_start_time_ = start_time.toSec();
+            bag_duration_ = duration;
+            
+            std::cout << "Duration: " << std::fixed << std::setprecision(2) << duration << " seconds" << std::endl;
+            std::cout << "Message count: " << total_messages << std::endl;
+            std::cout << "Topics: " << topic_counts.size() << std::endl << std::endl;
+
+            // Display topic information
+            std::cout << "Topics Information:" << std::endl;
+            std::cout << "----------------------------------------" << std::endl;
+            
+            for (const auto& topic_pair : topic_counts) {
+                const std::string& topic_name = topic_pair.first;
+                int count = topic_pair.second;
+                const std::string& msg_type = topic_types[topic_name];
+                
+                std::cout << "Topic: " << topic_name << std::endl;
+                std::cout << "  Type: " << msg_type << std::endl;
+                std::cout << "  Count: " << count << std::endl << std::endl;
+
+                // Check if this is an image topic
+                if (msg_type.find("Image") != std::string::npos || 
+                    topic_name.find("image") != std::string::npos) {
+                    
+                    TopicInfo info;
+                    info.topic_name = topic_name;
+                    info.msg_type = msg_type;
+                    info.msg_count = count;
+                    image_topics_.push_back(info);
+                }
+            }
+
+            // Display found image topics
+            if (!image_topics_.empty()) {
+                std::cout << "Found " << image_topics_.size() << " image topics:" << std::endl;
+                for (const auto& topic : image_topics_) {
+                    std::cout << "  - " << topic.topic_name << ": " << topic.msg_count << " images" << std::endl;
+                }
+            } else {
+                std::cout << "No image topics found!" << std::endl;
+                bag.close();
+                return false;
+            }
+
+            bag.close();
+            std::cout << std::endl;
+            return true;
+
+        } catch (const std::exception& e) {
+            std::cerr << "Error analyzing bag file: " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    bool createOutputDirectories() {
+        std::cout << "=== CREATING OUTPUT DIRECTORIES ===" << std::endl;
+        
+        try {
+            // Create main output directory
+            create_directories(output_dir_);
+            
+            // Create directories for each image topic
+            for (const auto& topic : image_topics_) {
+                // Clean topic name for directory (replace / with _)
+                std::string dir_name = topic.topic_name;
+                std::replace(dir_name.begin(), dir_name.end(), '/', '_');
+                std::replace(dir_name.begin(), dir_name.end(), ':', '_');
+                
+                // Remove leading/trailing underscores
+                if (!dir_name.empty() && dir_name[0] == '_') {
+                    dir_name = dir_name.substr(1);
+                }
+                
+                std::string topic_dir = output_dir_ + "/" + dir_name;
+                create_directories(topic_dir);
+                
+                topic_directories_[topic.topic_name] = topic_dir;
+                extraction_counts_[topic.topic_name] = 0;
+                
+                std::cout << "Created directory: " << topic_dir << std::endl;
+            }
+            
+            std::cout << std::endl;
+            return true;
+            
+        } catch (const std::exception& e) {
+            std::cerr << "Error creating directories: " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    bool extractImages() {
+        std::cout << "=== EXTRACTING IMAGES ===" << std::endl;
+        std::cout << "Extracting ALL images from bag file..." << std::endl;
+        
+        try {
+            rosbag::Bag bag;
+            bag.open(bag_path_, rosbag::bagmode::Read);
+
+            // Create view for image topics only
+            std::vector<std::string> image_topic_names;
+            for (const auto& topic : image_topics_) {
+                image_topic_names.push_back(topic.topic_name);
+            }
+            
+            rosbag::View view(bag, rosbag::TopicQuery(image_topic_names));
+            
+            int processed_messages = 0;
+            h264_outputs_.clear();
+            
+            // One handler per image topic, reachable from every connection that records it
+            std::vector<TopicHandler> handlers(image_topics_.size());
+            std::map<std::string, TopicHandler*> handlers_by_topic;
+            for (size_t i = 0; i < image_topics_.size(); i++) {
+                const TopicInfo& topic = image_topics_[i];
+                TopicHandler& handler = handlers[i];
+                handler.topic_name = topic.topic_name;
+                handler.policy = topic.msg_type == "sensor_msgs/CompressedImage"
+                    ? ConversionPolicy::CompressedImage : ConversionPolicy::RawImage;
+                handler.path = topic_directories_[topic.topic_name] + "/";
+                handler.dir_length = handler.path.size();
+                handler.path.reserve(handler.dir_length + kMaxImageFileName);
+                handler.preview.reset(new PreviewIndex(
+                    topic_directories_[topic.topic_name], bag_start_time_, bag_duration_));
+                if (video_options_.mode != VideoOutputOptions::Mode::Progressive) {
+                    handler.ladder.reset(new LadderEncoder(video_options_, videoPathPrefix(topic.topic_name)));
+                }
+                handlers_by_topic[topic.topic_name] = &handler;
+            }
+            
+            std::vector<TopicHandler*> handlers_by_connection;
+            for (const rosbag::ConnectionInfo* connection : view.getConnections()) {
+                if (connection->id >= handlers_by_connection.size()) {
+                    handlers_by_connection.resize(connection->id + 1, nullptr);
+                }
+                auto it = handlers_by_topic.find(connection->topic);
+                if (it != handlers_by_topic.end()) {
+                    handlers_by_connection[connection->id] = it->second;
+                }
+            }
+
+            char filename[kMaxImageFileName];
+            
+            for (const rosbag::MessageInstance& msg : view) {
+                uint32_t connection_id = msg.getConnectionInfo()->id;
+                if (connection_id >= handlers_by_connection.size() || !handlers_by_connection[connection_id]) {
+                    continue;
+                }
+                TopicHandler& handler = *handlers_by_connection[connection_id];
+                handler.attempts++;
+                processed_messages++;
+
+                try {
+                    if (handler.policy == ConversionPolicy::CompressedImage && handler.attempts == 1) {
+                        detectH264(handler, msg);
+                    }
+                    if (handler.policy == ConversionPolicy::H264Passthrough) {
+                        if (appendH264(handler, msg)) {
+                            handler.successes++;
+                        }
+                        continue;
+                    }
+
+                    cv::Mat image = decodeFrame(msg, handler.policy);
+
+                    if (!image.empty()) {
+                        // Generate filename with timestamp
+                        double timestamp = msg.getTime().toSec();
+                        snprintf(filename, sizeof(filename), "image_%04d_%.3f.jpg", handler.successes, timestamp);
+                        
+                        handler.path.resize(handler.dir_length);
+                        handler.path.append(filename);
+                        
+                        // Save image
+                        if (cv::imwrite(handler.path, image)) {
+                            int frame_number = handler.successes++;
+                            
+                            // Progress update every 50 images
+                            if (handler.successes % 50 == 0) {
+                                LOG_INFO("  {}: saved {} images", handler.topic_name, handler.successes);
+                            }
+
+                            // Reuse the decoded frame for the renditions and the low-resolution
+                            // preview. The image is saved and counted already, so an error there
+                            // only costs that output.
+                            if (handler.ladder) {
+                                try {
+                                    handler.ladder->addFrame(image);
+                                } catch (const std::exception& e) {
+                                    LOG_EVERY_MS(logging::Level::Warn, 1000, "Rendition ladder skipped a frame of {}: {}",
+                                                 handler.topic_name, e.what());
+                                }
+                            }
+                            try {
+                                handler.preview->addFrame(image, timestamp, frame_number, filename);
+                            } catch (const std::exception& e) {
+                                LOG_EVERY_MS(logging::Level::Warn, 1000, "Preview skipped a frame of {}: {}",
+                                             handler.topic_name, e.what());
+                            }
+                        } else {
+                            LOG_EVERY_MS(logging::Level::Error, 1000, "Failed to save image: {}", handler.path);
+                        }
+                    }
+                } catch (const std::exception& e) {
+                    if (handler.attempts <= 5) {  // Only show first few errors
+                        LOG_ERROR("Error processing image {} from {}: {}", handler.attempts,
+                                  handler.topic_name, e.what());
+                    }
+                }
+            }
+
+            bag.close();
+            logging::flush();  // progress lines before the summary below
+            
+            video_failures_ = 0;
+            for (auto& handler : handlers) {
+                if (handler.h264) {
+                    handler.h264->out.close();
+                    std::cout << "🎞️  H.264 stream written: " << handler.h264->path << " ("
+                              << handler.successes << " frames, " << handler.h264->idr_frames << " IDR, "
+                              << handler.h264->parameter_sets << " SPS/PPS, "
+                              << handler.h264->bytes / 1024 << " KB)" << std::endl;
+                    continue;
+                }
+                handler.preview->finish();
+                if (handler.ladder && !handler.ladder->finish()) {
+                    video_failures_++;
+                }
+            }
+
+            // Print final results
+            std::cout << std::endl << "Extraction completed:" << std::endl;
+            std::cout << "--------------------------------------------------" << std::endl;
+            
+            int total_attempted = 0;
+            int total_extracted = 0;
+            
+            for (const auto& handler : handlers) {
+                int attempted = handler.attempts;
+                int extracted = handler.successes;
+                double success_rate = attempted > 0 ? (double(extracted) / attempted * 100.0) : 0.0;
+                
+                total_attempted += attempted;
+                total_extracted += extracted;
+                extraction_counts_[handler.topic_name] = extracted;
+                
+                std::cout << handler.topic_name << ":" << std::endl;
+                std::cout << "  Attempted: " << attempted << std::endl;
+                std::cout << "  Successful: " << extracted << std::endl;
+                std::cout << "  Success rate: " << std::fixed << std::setprecision(1) 
+                         << success_rate << "%" << std::endl;
+            }
+            
+            double overall_success = total_attempted > 0 ? (double(total_extracted) / total_attempted * 100.0) : 0.0;
+            std::cout << std::endl << "Overall Results:" << std::endl;
+            std::cout << "  Total attempted: " << total_attempted << std::endl;
+            std::cout << "  Total extracted: " << total_extracted << std::endl;
+            std::cout << "  Overall success rate: " << std::fixed << std::setprecision(1) 
+                     << overall_success << "%" << std::endl;
+
+            return total_extracted > 0;
+
+        } catch (const std::exception& e) {
+            std::cerr << "Error extracting images: " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    bool process() {
+        std::cout << "Starting bag file processing..." << std::endl;
+        std::cout << "Bag file: " << bag_path_ << std::endl;
+        std::cout << "Output directory: " << output_dir_ << std::endl << std::endl;
+
+        // Step 1: Analyze bag file
+        if (!analyzeBag()) {
+            std::cerr << "Failed to analyze bag file" << std::endl;
+            return false;
+        }
+
+        // Step 2: Create output directories
+        if (!createOutputDirectories()) {
+            std::cerr << "Failed to create output directories" << std::endl;
+            return false;
+        }
+
+        // Step 3: Extract images
+        if (!extractImages()) {
+            std::cerr << "Failed to extract images" << std::endl;
+            return false;
+        }
+
+        // Step 4: Convert images to videos
+        bool all_conversions_success = true;
+        if (video_options_.mode != VideoOutputOptions::Mode::Progressive) {
+            // Renditions were already encoded during extraction
+            all_conversions_success = video_failures_ == 0;
+        } else {
+            std::cout << std::endl << "=== CONVERTING IMAGES TO VIDEOS ===" << std::endl;
+            
+            for (const auto& topic_dir_pair : topic_directories_) {
+                const std::string& topic_name = topic_dir_pair.first;
+                const std::string& images_dir = topic_dir_pair.second;
+                if (h264_outputs_.count(topic_name)) {
+                    continue;  // already encoded; written as-is during extraction
+                }
+            
+                // Generate output video filename based on directory name
+                std::string dir_name = boost::filesystem::path(images_dir).filename().string();
+                std::string video_filename = dir_name + "_30fps.mp4";
+                std::string output_video_path = output_dir_ + "/" + video_filename;
+            
+                std::cout << std::endl << "Converting topic: " << topic_name << std::endl;
+            
+                if (!convertImagesToVideo(images_dir, output_video_path)) {
+                    std::cout << "⚠️  Video conversion failed for " << topic_name << std::endl;
+                    all_conversions_success = false;
+                }
+            }
+        }
+
+        std::cout << std::endl << "✅ Bag processing completed successfully!" << std::endl;
+        std::cout << "Images extracted to: " << output_dir_ << std::endl;
+        
+        if (all_conversions_success) {
+            std::cout << "✅ All videos converted successfully!" << std::endl;
+        } else {
+            std::cout << "⚠️  Some video conversions failed" << std::endl;
+        }
+        
+        return true;
+    }
+};
@@ -21,6 +21,9 @@ fi
 
 echo "Building for platform: $PLATFORM"
 
+# Stage shared sources into the build context
+rm -rf ./common && cp -r ../common ./common
+
 # Build the Docker image
 echo "Building Docker image..."
 docker build \
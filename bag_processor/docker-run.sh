@@ -51,7 +51,10 @@ docker run \
     -v "$JETSON_DIR:/workspace/jetson" \
     -v "$CURRENT_DIR:/workspace/build/output" \
     -w /workspace/build \
-    bag-processor:latest
+    -e LOG_LEVEL=${LOG_LEVEL:-info} \
+    -e LOG_FORMAT=${LOG_FORMAT:-text} \
+    bag-processor:latest \
+    ./rosbag_analyzed "$@"
 
 if [ $? -eq 0 ]; then
     echo ""
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <limits>
+
+#include <opencv2/opencv.hpp>
+
+// The frame as 8-bit gray or BGR, for outputs that take nothing else (the
+// preview JPEGs, the rendition encoder's pipe). 8-bit 1- and 3-channel frames
+// are returned as they are. 16-bit and float frames (depth, thermal) are
+// stretched over their own min..max range and BGRA loses its alpha, both into
+// `converted`. Any other channel count gives an empty Mat.
+inline const cv::Mat& toDisplayable(const cv::Mat& frame, cv::Mat& converted) {
+    if (frame.depth() == CV_8U && (frame.channels() == 1 || frame.channels() == 3)) {
+        return frame;
+    }
+    if (frame.channels() != 1 && frame.channels() != 3 && frame.channels() != 4) {
+        converted.release();
+        return converted;
+    }
+
+    if (frame.depth() == CV_8U) {
+        frame.copyTo(converted);
+    } else {
+        // Depth images mark "no reading" with NaN or +/-Inf; keep those out of the range
+        cv::Mat values;
+        frame.convertTo(values, CV_32F);
+        cv::Mat samples = values.reshape(1);
+        cv::patchNaNs(samples, 0.0);
+        samples.setTo(0.0, cv::abs(samples) == std::numeric_limits<float>::infinity());
+        cv::normalize(values, converted, 0, 255, cv::NORM_MINMAX, CV_8U);
+    }
+    if (converted.channels() == 4) {
+        cv::cvtColor(converted, converted, cv::COLOR_BGRA2BGR);
+    }
+    return converted;
+}
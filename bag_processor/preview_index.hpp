@@ -0,0 +1,275 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+
+#include "frame_format.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Adds one row of 8-bit samples into a row of 16-bit accumulators.
+// This is the hot part of the area-average kernel: it touches every source byte.
+inline void accumulateRow(const uint8_t* src, uint16_t* acc, int count) {
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i acc_lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i));
+        __m128i acc_hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i + 8));
+        acc_lo = _mm_add_epi16(acc_lo, _mm_unpacklo_epi8(pixels, zero));
+        acc_hi = _mm_add_epi16(acc_hi, _mm_unpackhi_epi8(pixels, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + i), acc_lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + i + 8), acc_hi);
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t pixels = vld1q_u8(src + i);
+        uint16x8_t acc_lo = vld1q_u16(acc + i);
+        uint16x8_t acc_hi = vld1q_u16(acc + i + 8);
+        vst1q_u16(acc + i, vaddw_u8(acc_lo, vget_low_u8(pixels)));
+        vst1q_u16(acc + i + 8, vaddw_u8(acc_hi, vget_high_u8(pixels)));
+    }
+#endif
+    for (; i < count; i++) {
+        acc[i] += src[i];
+    }
+}
+
+// Area-average (box filter) downscale of an 8-bit image by an integer factor.
+// Vertical sums run through accumulateRow(); the horizontal reduction only
+// touches one accumulated row per output row.
+inline void areaDownscale(const cv::Mat& src, cv::Mat& dst, int factor) {
+    CV_Assert(src.depth() == CV_8U && factor >= 1 && factor <= 256);
+
+    const int channels = src.channels();
+    const int out_cols = src.cols / factor;
+    const int out_rows = src.rows / factor;
+    const int row_values = out_cols * factor * channels;
+    const uint32_t area = static_cast<uint32_t>(factor * factor);
+
+    dst.create(out_rows, out_cols, src.type());
+    std::vector<uint16_t> row_sum(row_values);
+
+    for (int y = 0; y < out_rows; y++) {
+        std::fill(row_sum.begin(), row_sum.end(), 0);
+        for (int dy = 0; dy < factor; dy++) {
+            accumulateRow(src.ptr<uint8_t>(y * factor + dy), row_sum.data(), row_values);
+        }
+
+        uint8_t* out = dst.ptr<uint8_t>(y);
+        for (int x = 0; x < out_cols; x++) {
+            for (int c = 0; c < channels; c++) {
+                uint32_t sum = 0;
+                const uint16_t* block = row_sum.data() + x * factor * channels + c;
+                for (int dx = 0; dx < factor; dx++) {
+                    sum += block[dx * channels];
+                }
+                out[x * channels + c] = static_cast<uint8_t>((sum + area / 2) / area);
+            }
+        }
+    }
+}
+
+// Low-resolution browsing aids for one image topic, built from the frames the
+// extractor has already decoded:
+//   preview/contact_sheet.jpg  - up to kSheetMaxTiles tiles spread over the whole run
+//   preview/strip_NNNN.jpg     - one thumbnail per second, kStripThumbs per page
+//   preview/index.csv          - second -> frame, full-size image, strip page and slot
+class PreviewIndex {
+public:
+    static const int kThumbWidth = 160;
+    static const int kStripThumbs = 60;
+    static const int kSheetColumns = 10;
+    static const int kSheetMaxTiles = 100;
+
+    PreviewIndex(const std::string& topic_dir, double start_time, double duration)
+        : preview_dir_(topic_dir + "/preview"), start_time_(start_time) {
+        tile_interval_ = std::max(1, static_cast<int>(std::ceil(duration / kSheetMaxTiles)));
+        tile_count_ = std::min(kSheetMaxTiles, static_cast<int>(duration) / tile_interval_ + 1);
+        tile_filled_.assign(tile_count_, false);
+    }
+
+    // Called for every saved frame; only the first frame of each second is kept.
+    // Any depth or channel count cv_bridge hands out is accepted; frames that
+    // cannot be shown as 8-bit BGR are left out of the preview.
+    void addFrame(const cv::Mat& input, double timestamp, int frame_number, const char* image_file) {
+        if (input.empty()) {
+            return;
+        }
+
+        long second = static_cast<long>(std::floor(timestamp - start_time_));
+        if (second == last_second_) {
+            return;
+        }
+        last_second_ = second;
+
+        const cv::Mat& frame = displayable(input);
+        if (frame.empty()) {
+            return;
+        }
+
+        if (!initialized_ && !initialize(frame)) {
+            return;
+        }
+
+        makeThumbnail(frame);
+
+        // Thumbnail strip page
+        int slot = strip_slots_used_;
+        thumb_.copyTo(strip_page_(cv::Rect(slot * thumb_size_.width, 0, thumb_size_.width, thumb_size_.height)));
+        strip_slots_used_++;
+        std::string strip_file = stripFileName(strip_page_number_);
+
+        // Contact sheet tile
+        if (second >= 0) {
+            long tile = second / tile_interval_;
+            if (tile < tile_count_ && !tile_filled_[tile]) {
+                placeTile(static_cast<int>(tile), second);
+            }
+        }
+
+        index_file_ << second << "," << std::fixed << std::setprecision(3) << timestamp << ","
+                    << frame_number << "," << image_file << "," << strip_file << "," << slot << "\n";
+
+        if (strip_slots_used_ == kStripThumbs) {
+            flushStripPage();
+        }
+    }
+
+    bool finish() {
+        if (!initialized_) {
+            return false;
+        }
+
+        flushStripPage();
+        index_file_.close();
+
+        bool ok = cv::imwrite(preview_dir_ + "/contact_sheet.jpg", contact_sheet_);
+        std::cout << "🖼️  Preview written: " << preview_dir_ << " (" << strip_page_number_
+                  << " strip pages, 1 tile per " << tile_interval_ << "s)" << std::endl;
+        return ok;
+    }
+
+private:
+    std::string preview_dir_;
+    double start_time_;
+    int tile_interval_ = 1;
+    int tile_count_ = 0;
+    std::vector<bool> tile_filled_;
+
+    bool initialized_ = false;
+    long last_second_ = -1;
+    cv::Size thumb_size_;
+    cv::Mat reduced_;
+    cv::Mat resized_;
+    cv::Mat thumb_;
+    cv::Mat strip_page_;
+    int strip_slots_used_ = 0;
+    int strip_page_number_ = 0;
+    cv::Mat contact_sheet_;
+    std::ofstream index_file_;
+    cv::Mat converted_;
+    bool warned_format_ = false;
+
+    // 8-bit with 1 or 3 channels, as areaDownscale() and the JPEG pages need
+    const cv::Mat& displayable(const cv::Mat& frame) {
+        const cv::Mat& result = toDisplayable(frame, converted_);
+        if (result.empty() && !warned_format_) {
+            std::cerr << "No preview for " << frame.channels() << "-channel frames in "
+                      << preview_dir_ << std::endl;
+            warned_format_ = true;
+        }
+        return result;
+    }
+
+    bool initialize(const cv::Mat& frame) {
+        boost::filesystem::create_directories(preview_dir_);
+
+        int thumb_height = std::max(2, (frame.rows * kThumbWidth / frame.cols) & ~1);
+        thumb_size_ = cv::Size(kThumbWidth, thumb_height);
+
+        strip_page_ = cv::Mat::zeros(thumb_height, kThumbWidth * kStripThumbs, CV_8UC3);
+
+        int sheet_rows = (tile_count_ + kSheetColumns - 1) / kSheetColumns;
+        contact_sheet_ = cv::Mat::zeros(sheet_rows * thumb_height, kSheetColumns * kThumbWidth, CV_8UC3);
+
+        index_file_.open(preview_dir_ + "/index.csv");
+        if (!index_file_) {
+            std::cerr << "Failed to create preview index in " << preview_dir_ << std::endl;
+            return false;
+        }
+        index_file_ << "second,timestamp,frame,image,strip,slot\n";
+
+        initialized_ = true;
+        return true;
+    }
+
+    void makeThumbnail(const cv::Mat& frame) {
+        int factor = std::max(1, std::min(frame.cols / thumb_size_.width, frame.rows / thumb_size_.height));
+
+        const cv::Mat* source = &frame;
+        if (factor > 1) {
+            areaDownscale(frame, reduced_, factor);
+            source = &reduced_;
+        }
+        if (source->size() != thumb_size_) {
+            cv::resize(*source, resized_, thumb_size_, 0, 0, cv::INTER_AREA);
+            source = &resized_;
+        }
+
+        if (source->channels() == 1) {
+            cv::cvtColor(*source, thumb_, cv::COLOR_GRAY2BGR);
+        } else {
+            source->copyTo(thumb_);
+        }
+    }
+
+    void placeTile(int tile, long second) {
+        int x = (tile % kSheetColumns) * thumb_size_.width;
+        int y = (tile / kSheetColumns) * thumb_size_.height;
+        cv::Mat cell = contact_sheet_(cv::Rect(x, y, thumb_size_.width, thumb_size_.height));
+        thumb_.copyTo(cell);
+
+        char label[16];
+        snprintf(label, sizeof(label), "%02ld:%02ld", second / 60, second % 60);
+        cv::putText(cell, label, cv::Point(4, thumb_size_.height - 6), cv::FONT_HERSHEY_SIMPLEX,
+                    0.4, cv::Scalar(0, 255, 255), 1, cv::LINE_AA);
+        tile_filled_[tile] = true;
+    }
+
+    void flushStripPage() {
+        if (strip_slots_used_ == 0) {
+            return;
+        }
+        cv::Mat used = strip_page_(cv::Rect(0, 0, strip_slots_used_ * thumb_size_.width, thumb_size_.height));
+        std::string path = preview_dir_ + "/" + stripFileName(strip_page_number_);
+        if (!cv::imwrite(path, used)) {
+            std::cerr << "Failed to save thumbnail strip: " << path << std::endl;
+        }
+        strip_page_.setTo(cv::Scalar(0, 0, 0));
+        strip_slots_used_ = 0;
+        strip_page_number_++;
+    }
+
+    static std::string stripFileName(int page) {
+        char name[32];
+        snprintf(name, sizeof(name), "strip_%04d.jpg", page);
+        return name;
+    }
+};
@@ -0,0 +1,384 @@
+// Synthetic bag generator and extraction benchmark for rosbag_analyzed.
+//
+// Generates bags with a configurable topic count, resolution, encoding, rate,
+// duration and chunk compression, runs the BagProcessor analysis and
+// extraction stages over each one and appends one JSON line per case to the
+// results file. The field set and order are fixed (see kSchema) so results can
+// be diffed across commits and Jetson models.
+//
+// Usage:
+//   ./rosbag_bench --topics=4 --resolution=640x480,1920x1080
+//       --encoding=bgr8,mono16,bayer,compressed --rate=30 --duration=10
+//       --compression=none,lz4,bz2 --label=$(git rev-parse --short HEAD)
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <sys/utsname.h>
+
+#include "bag_processor.hpp"
+
+namespace {
+
+const char* kSchema = "rosbag_bench/1";
+
+struct BenchCase {
+    int topics;
+    int width;
+    int height;
+    std::string encoding;     // bgr8, mono16, bayer or compressed
+    double rate;              // messages per second per topic
+    double duration;          // seconds
+    std::string compression;  // none, lz4 or bz2
+};
+
+struct StageResult {
+    double seconds = 0.0;
+    long peak_rss_kb = 0;
+};
+
+std::vector<std::string> splitList(const std::string& value) {
+    std::vector<std::string> items;
+    std::stringstream ss(value);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+std::string jsonEscape(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        if (static_cast<unsigned char>(c) >= 0x20) {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+// Reset the kernel's peak RSS counter (VmHWM) so each stage reports its own peak
+bool resetPeakRss() {
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    if (!clear_refs) {
+        return false;
+    }
+    clear_refs << "5";
+    return static_cast<bool>(clear_refs);
+}
+
+long readPeakRssKb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::stol(line.substr(6));
+        }
+    }
+    return 0;
+}
+
+// Jetson boards expose their model in the device tree; fall back to uname elsewhere
+std::string readHostModel() {
+    std::ifstream model_file("/proc/device-tree/model");
+    std::string model;
+    if (model_file && std::getline(model_file, model, '\0') && !model.empty()) {
+        return model;
+    }
+    struct utsname info;
+    if (uname(&info) == 0) {
+        return std::string(info.sysname) + " " + info.machine;
+    }
+    return "unknown";
+}
+
+// Moving bar over a per-topic gradient so the JPEG encoder sees realistic content
+cv::Mat makeFrame(const BenchCase& bench_case, int topic_index, int frame_index) {
+    cv::Mat frame(bench_case.height, bench_case.width, CV_8UC3);
+    for (int y = 0; y < frame.rows; y++) {
+        cv::Vec3b* row = frame.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < frame.cols; x++) {
+            row[x] = cv::Vec3b(static_cast<uchar>(x * 255 / frame.cols),
+                               static_cast<uchar>(y * 255 / frame.rows),
+                               static_cast<uchar>(topic_index * 40));
+        }
+    }
+    int bar_width = std::max(8, frame.cols / 16);
+    int bar_x = (frame_index * 8) % std::max(1, frame.cols - bar_width);
+    cv::rectangle(frame, cv::Rect(bar_x, 0, bar_width, frame.rows), cv::Scalar(255, 255, 255), cv::FILLED);
+    return frame;
+}
+
+cv::Mat toBayerRGGB(const cv::Mat& bgr) {
+    cv::Mat bayer(bgr.rows, bgr.cols, CV_8UC1);
+    for (int y = 0; y < bgr.rows; y++) {
+        const cv::Vec3b* src = bgr.ptr<cv::Vec3b>(y);
+        uchar* dst = bayer.ptr<uchar>(y);
+        for (int x = 0; x < bgr.cols; x++) {
+            // RGGB: R at (even, even), B at (odd, odd), G elsewhere
+            int channel = (y % 2 == 0) ? (x % 2 == 0 ? 2 : 1) : (x % 2 == 0 ? 1 : 0);
+            dst[x] = src[x][channel];
+        }
+    }
+    return bayer;
+}
+
+void fillImageMessage(sensor_msgs::Image& msg, const cv::Mat& pixels, const std::string& encoding) {
+    msg.height = pixels.rows;
+    msg.width = pixels.cols;
+    msg.encoding = encoding;
+    msg.is_bigendian = 0;
+    msg.step = static_cast<uint32_t>(pixels.cols * pixels.elemSize());
+    msg.data.resize(msg.step * msg.height);
+    for (int y = 0; y < pixels.rows; y++) {
+        std::memcpy(&msg.data[y * msg.step], pixels.ptr(y), msg.step);
+    }
+}
+
+// Writes the synthetic bag and returns the total image payload in bytes
+uint64_t writeSyntheticBag(const BenchCase& bench_case, const std::string& bag_path, int& frames_written) {
+    rosbag::Bag bag;
+    bag.open(bag_path, rosbag::bagmode::Write);
+
+    if (bench_case.compression == "lz4") {
+        bag.setCompression(rosbag::compression::LZ4);
+    } else if (bench_case.compression == "bz2") {
+        bag.setCompression(rosbag::compression::BZ2);
+    } else {
+        bag.setCompression(rosbag::compression::Uncompressed);
+    }
+
+    const int frame_count = static_cast<int>(bench_case.rate * bench_case.duration);
+    const ros::Time start_time(1700000000, 0);
+    uint64_t payload_bytes = 0;
+    frames_written = 0;
+
+    for (int f = 0; f < frame_count; f++) {
+        ros::Time stamp = start_time + ros::Duration(f / bench_case.rate);
+
+        for (int t = 0; t < bench_case.topics; t++) {
+            std::string topic = "/bench/cam" + std::to_string(t) + "/image_raw";
+            cv::Mat frame = makeFrame(bench_case, t, f);
+
+            if (bench_case.encoding == "compressed") {
+                sensor_msgs::CompressedImage msg;
+                msg.header.stamp = stamp;
+                msg.header.seq = f;
+                msg.format = "jpeg";
+                cv::imencode(".jpg", frame, msg.data);
+                payload_bytes += msg.data.size();
+                bag.write(topic, stamp, msg);
+            } else {
+                sensor_msgs::Image msg;
+                msg.header.stamp = stamp;
+                msg.header.seq = f;
+
+                if (bench_case.encoding == "mono16") {
+                    cv::Mat gray;
+                    cv::Mat gray16;
+                    cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+                    gray.convertTo(gray16, CV_16UC1, 256.0);
+                    fillImageMessage(msg, gray16, "mono16");
+                } else if (bench_case.encoding == "bayer") {
+                    fillImageMessage(msg, toBayerRGGB(frame), "bayer_rggb8");
+                } else {
+                    fillImageMessage(msg, frame, "bgr8");
+                }
+
+                payload_bytes += msg.data.size();
+                bag.write(topic, stamp, msg);
+            }
+            frames_written++;
+        }
+    }
+
+    bag.close();
+    return payload_bytes;
+}
+
+template <typename Fn>
+StageResult runStage(Fn stage, bool& ok) {
+    StageResult result;
+    resetPeakRss();
+    auto start = std::chrono::steady_clock::now();
+    ok = stage();
+    auto end = std::chrono::steady_clock::now();
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    result.peak_rss_kb = readPeakRssKb();
+    return result;
+}
+
+double perSecond(double amount, double seconds) {
+    return seconds > 0.0 ? amount / seconds : 0.0;
+}
+
+void printUsage() {
+    std::cout << "Usage: rosbag_bench [options]" << std::endl;
+    std::cout << "  --topics=N               image topics per bag (default 2)" << std::endl;
+    std::cout << "  --resolution=WxH[,...]   frame sizes (default 640x480)" << std::endl;
+    std::cout << "  --encoding=E[,...]       bgr8, mono16, bayer, compressed (default bgr8)" << std::endl;
+    std::cout << "  --rate=HZ                messages per second per topic (default 30)" << std::endl;
+    std::cout << "  --duration=S             bag duration in seconds (default 5)" << std::endl;
+    std::cout << "  --compression=C[,...]    none, lz4, bz2 (default none)" << std::endl;
+    std::cout << "  --workdir=DIR            scratch directory (default bench_work)" << std::endl;
+    std::cout << "  --output=FILE            JSON lines results file (default rosbag_bench.jsonl)" << std::endl;
+    std::cout << "  --label=TEXT             free-form tag, e.g. the git commit" << std::endl;
+    std::cout << "  --keep                   keep generated bags and extracted images" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    ros::Time::init();
+
+    int topics = 2;
+    std::vector<std::string> resolutions = {"640x480"};
+    std::vector<std::string> encodings = {"bgr8"};
+    std::vector<std::string> compressions = {"none"};
+    double rate = 30.0;
+    double duration = 5.0;
+    std::string workdir = "bench_work";
+    std::string output_path = "rosbag_bench.jsonl";
+    std::string label;
+    bool keep = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string key = arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+        if (key == "--topics") topics = std::stoi(value);
+        else if (key == "--resolution") resolutions = splitList(value);
+        else if (key == "--encoding") encodings = splitList(value);
+        else if (key == "--compression") compressions = splitList(value);
+        else if (key == "--rate") rate = std::stod(value);
+        else if (key == "--duration") duration = std::stod(value);
+        else if (key == "--workdir") workdir = value;
+        else if (key == "--output") output_path = value;
+        else if (key == "--label") label = value;
+        else if (key == "--keep") keep = true;
+        else {
+            printUsage();
+            return key == "--help" ? 0 : 1;
+        }
+    }
+
+    std::vector<BenchCase> cases;
+    for (const auto& resolution : resolutions) {
+        int width = 0;
+        int height = 0;
+        if (sscanf(resolution.c_str(), "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+            std::cerr << "❌ Invalid resolution: " << resolution << std::endl;
+            return 1;
+        }
+        for (const auto& encoding : encodings) {
+            for (const auto& compression : compressions) {
+                cases.push_back({topics, width, height, encoding, rate, duration, compression});
+            }
+        }
+    }
+
+    const std::string host = readHostModel();
+    const bool rss_reset = resetPeakRss();
+    if (!rss_reset) {
+        std::cerr << "⚠️  /proc/self/clear_refs not writable - peak RSS is process-wide" << std::endl;
+    }
+
+    std::ofstream output(output_path, std::ios::app);
+    if (!output) {
+        std::cerr << "❌ Cannot open results file: " << output_path << std::endl;
+        return 1;
+    }
+
+    boost::filesystem::create_directories(workdir);
+    int failures = 0;
+
+    for (size_t c = 0; c < cases.size(); c++) {
+        const BenchCase& bench_case = cases[c];
+        std::ostringstream case_name;
+        case_name << bench_case.encoding << "_" << bench_case.width << "x" << bench_case.height
+                  << "_" << bench_case.topics << "t_" << bench_case.compression;
+
+        std::string bag_path = workdir + "/" + case_name.str() + ".bag";
+        std::string extract_dir = workdir + "/" + case_name.str();
+
+        std::cout << "🧪 [" << (c + 1) << "/" << cases.size() << "] Generating " << bag_path << std::endl;
+        int frames_written = 0;
+        uint64_t payload_bytes = writeSyntheticBag(bench_case, bag_path, frames_written);
+        uint64_t bag_bytes = boost::filesystem::file_size(bag_path);
+        double payload_mb = payload_bytes / (1024.0 * 1024.0);
+
+        BagProcessor processor(bag_path, extract_dir);
+        bool analyze_ok = false;
+        bool extract_ok = false;
+
+        StageResult analyze = runStage([&]() { return processor.analyzeBag(); }, analyze_ok);
+        StageResult extract;
+        if (analyze_ok && processor.createOutputDirectories()) {
+            extract = runStage([&]() { return processor.extractImages(); }, extract_ok);
+        }
+
+        int extracted = 0;
+        for (const auto& count : processor.getExtractionCounts()) {
+            extracted += count.second;
+        }
+        if (!analyze_ok || !extract_ok) {
+            failures++;
+        }
+
+        std::ostringstream record;
+        record << std::fixed << std::setprecision(3)
+               << "{\"schema\":\"" << kSchema << "\""
+               << ",\"label\":\"" << jsonEscape(label) << "\""
+               << ",\"host\":\"" << jsonEscape(host) << "\""
+               << ",\"case\":\"" << case_name.str() << "\""
+               << ",\"topics\":" << bench_case.topics
+               << ",\"width\":" << bench_case.width
+               << ",\"height\":" << bench_case.height
+               << ",\"encoding\":\"" << bench_case.encoding << "\""
+               << ",\"rate_hz\":" << bench_case.rate
+               << ",\"duration_s\":" << bench_case.duration
+               << ",\"compression\":\"" << bench_case.compression << "\""
+               << ",\"frames\":" << frames_written
+               << ",\"bag_bytes\":" << bag_bytes
+               << ",\"payload_bytes\":" << payload_bytes
+               << ",\"analyze_ok\":" << (analyze_ok ? "true" : "false")
+               << ",\"analyze_s\":" << analyze.seconds
+               << ",\"analyze_fps\":" << perSecond(frames_written, analyze.seconds)
+               << ",\"analyze_mb_s\":" << perSecond(payload_mb, analyze.seconds)
+               << ",\"analyze_peak_rss_kb\":" << analyze.peak_rss_kb
+               << ",\"extract_ok\":" << (extract_ok ? "true" : "false")
+               << ",\"extract_s\":" << extract.seconds
+               << ",\"extracted_frames\":" << extracted
+               << ",\"extract_fps\":" << perSecond(extracted, extract.seconds)
+               << ",\"extract_mb_s\":" << perSecond(payload_mb, extract.seconds)
+               << ",\"extract_peak_rss_kb\":" << extract.peak_rss_kb
+               << ",\"rss_reset\":" << (rss_reset ? "true" : "false")
+               << "}";
+
+        output << record.str() << std::endl;
+        std::cout << "📊 " << record.str() << std::endl;
+
+        if (!keep) {
+            boost::filesystem::remove(bag_path);
+            boost::filesystem::remove_all(extract_dir);
+        }
+    }
+
+    std::cout << "✅ Benchmark finished: " << cases.size() << " case(s), "
+              << failures << " failure(s). Results appended to " << output_path << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,331 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <pthread.h>
+
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+
+#include "frame_format.hpp"
+
+// One output of the rendition ladder, e.g. {"720p", 720, 1500}
+struct Rendition {
+    std::string name;
+    int height;
+    int bitrate_kbps;
+};
+
+struct VideoOutputOptions {
+    enum class Mode {
+        Progressive,  // JPEG directory -> one <topic>_30fps.mp4 after extraction
+        Ladder,       // decoded frames -> N aligned renditions during extraction
+        Cmaf          // like Ladder, but each rendition is written as live CMAF segments
+    };
+
+    Mode mode = Mode::Progressive;
+    std::vector<Rendition> renditions = {
+        {"1080p", 1080, 4000},
+        {"720p", 720, 1500},
+        {"360p", 360, 400},
+    };
+    int fps = 30;
+    int gop_frames = 30;  // IDR interval, identical for every rendition
+    int segment_seconds = 1;  // CMAF target segment duration (1-2 s)
+
+    // Parses "1080:4000,720:1500,360:400" (height:kbps pairs)
+    static bool parseLadder(const std::string& spec, std::vector<Rendition>& renditions) {
+        std::vector<Rendition> parsed;
+        std::stringstream ss(spec);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            int height = 0;
+            int bitrate = 0;
+            if (sscanf(item.c_str(), "%d:%d", &height, &bitrate) != 2 || height <= 0 || bitrate <= 0) {
+                return false;
+            }
+            parsed.push_back({std::to_string(height) + "p", height, bitrate});
+        }
+        if (parsed.empty()) {
+            return false;
+        }
+        renditions = parsed;
+        return true;
+    }
+};
+
+// Blocks SIGPIPE in the calling thread while it writes to an encoder pipe, so
+// an ffmpeg that exited early shows up as EPIPE from fwrite()/pclose() instead
+// of killing the extraction. A SIGPIPE raised by those writes is discarded
+// before the old mask is restored.
+class SigpipeGuard {
+public:
+    SigpipeGuard() {
+        sigemptyset(&sigpipe_);
+        sigaddset(&sigpipe_, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &sigpipe_, &old_mask_);
+        was_pending_ = isPending();
+    }
+
+    ~SigpipeGuard() {
+        if (!was_pending_ && isPending()) {
+            struct timespec zero = {0, 0};
+            sigtimedwait(&sigpipe_, nullptr, &zero);
+        }
+        pthread_sigmask(SIG_SETMASK, &old_mask_, nullptr);
+    }
+
+    SigpipeGuard(const SigpipeGuard&) = delete;
+    SigpipeGuard& operator=(const SigpipeGuard&) = delete;
+
+private:
+    sigset_t sigpipe_;
+    sigset_t old_mask_;
+    bool was_pending_ = false;
+
+    bool isPending() const {
+        sigset_t pending;
+        sigpending(&pending);
+        return sigismember(&pending, SIGPIPE) == 1;
+    }
+};
+
+// Feeds decoded frames to a single ffmpeg process that converts them to
+// yuv420p once, downscales through a shared pyramid (each level is scaled
+// from the one above it) and encodes every rendition with forced IDRs at the
+// same frame numbers, so a player can switch renditions at any GOP boundary.
+//
+// In Cmaf mode every rendition goes to <prefix>_<name>/ as an init segment
+// (init.mp4), fragmented segments (seg_NNNNN.m4s) that each start on an IDR,
+// and an EVENT playlist (index.m3u8) that ffmpeg rewrites after every
+// segment, so the streamer can serve a topic while extraction is running.
+// <prefix>.m3u8 is the master playlist that lists the renditions.
+class LadderEncoder {
+public:
+    LadderEncoder(const VideoOutputOptions& options, const std::string& output_prefix)
+        : options_(options), output_prefix_(output_prefix) {}
+
+    ~LadderEncoder() {
+        finish();
+    }
+
+    LadderEncoder(const LadderEncoder&) = delete;
+    LadderEncoder& operator=(const LadderEncoder&) = delete;
+
+    // The first frame fixes the input size and pixel format of the pipe. Frames
+    // are converted to 8-bit gray/BGR first; ones that cannot be are left out.
+    bool addFrame(const cv::Mat& input) {
+        if (failed_ || input.empty()) {
+            return false;
+        }
+
+        const cv::Mat& frame = toDisplayable(input, displayable_);
+        if (frame.empty()) {
+            if (!warned_format_) {
+                std::cerr << "⚠️  Rendition ladder skips " << input.channels() << "-channel frames for "
+                          << output_prefix_ << std::endl;
+                warned_format_ = true;
+            }
+            return false;
+        }
+
+        if (!pipe_ && !open(frame)) {
+            failed_ = true;
+            return false;
+        }
+
+        const cv::Mat* source = &frame;
+        if (frame.channels() != input_channels_) {
+            cv::cvtColor(frame, converted_, input_channels_ == 1 ? cv::COLOR_BGR2GRAY : cv::COLOR_GRAY2BGR);
+            source = &converted_;
+        }
+        if (source->size() != input_size_) {
+            cv::resize(*source, resized_, input_size_, 0, 0, cv::INTER_AREA);
+            source = &resized_;
+        }
+
+        const size_t row_bytes = static_cast<size_t>(input_size_.width) * input_channels_;
+        SigpipeGuard guard;
+        for (int y = 0; y < input_size_.height; y++) {
+            if (fwrite(source->ptr<uint8_t>(y), 1, row_bytes, pipe_) != row_bytes) {
+                if (errno == EPIPE) {
+                    std::cerr << "❌ Rendition encoder exited early for " << output_prefix_ << std::endl;
+                } else {
+                    std::cerr << "❌ Rendition encoder pipe failed for " << output_prefix_ << ": "
+                              << strerror(errno) << std::endl;
+                }
+                failed_ = true;
+                return false;
+            }
+        }
+
+        frames_++;
+        return true;
+    }
+
+    bool finish() {
+        if (!pipe_) {
+            return false;
+        }
+
+        int result;
+        {
+            // pclose() flushes what is still buffered into the pipe
+            SigpipeGuard guard;
+            result = pclose(pipe_);
+        }
+        pipe_ = nullptr;
+
+        if (result == 0 && !failed_) {
+            std::cout << "✅ Rendition ladder written: " << output_prefix_
+                      << (options_.mode == VideoOutputOptions::Mode::Cmaf ? ".m3u8 (" : "_*.mp4 (")
+                      << frames_ << " frames, " << active_.size() << " renditions)" << std::endl;
+            return true;
+        }
+        std::cout << "❌ Rendition ladder failed for " << output_prefix_ << " (exit code: " << result << ")" << std::endl;
+        return false;
+    }
+
+private:
+    VideoOutputOptions options_;
+    std::string output_prefix_;
+    std::vector<Rendition> active_;
+    FILE* pipe_ = nullptr;
+    bool failed_ = false;
+    int frames_ = 0;
+    cv::Size input_size_;
+    int input_channels_ = 3;
+    cv::Mat displayable_;
+    cv::Mat converted_;
+    cv::Mat resized_;
+    bool warned_format_ = false;
+
+    bool open(const cv::Mat& frame) {
+        input_size_ = frame.size();
+        input_channels_ = frame.channels() == 1 ? 1 : 3;
+
+        // Tallest first, and never upscale past the source
+        active_ = options_.renditions;
+        std::sort(active_.begin(), active_.end(),
+                  [](const Rendition& a, const Rendition& b) { return a.height > b.height; });
+        active_.erase(std::remove_if(active_.begin(), active_.end(),
+                                     [&](const Rendition& r) { return r.height > input_size_.height; }),
+                      active_.end());
+        if (active_.empty()) {
+            Rendition lowest = *std::min_element(options_.renditions.begin(), options_.renditions.end(),
+                [](const Rendition& a, const Rendition& b) { return a.height < b.height; });
+            // Named after the height it really has, as the streamer reads it from the file name
+            lowest.height = input_size_.height & ~1;
+            lowest.name = std::to_string(lowest.height) + "p";
+            active_.push_back(lowest);
+        }
+
+        if (options_.mode == VideoOutputOptions::Mode::Cmaf && !prepareSegmentOutput()) {
+            return false;
+        }
+
+        std::string cmd = buildCommand();
+        std::cout << "🎬 Starting rendition ladder for " << output_prefix_ << std::endl;
+        std::cout << "Running: " << cmd << std::endl;
+
+        pipe_ = popen(cmd.c_str(), "w");
+        if (!pipe_) {
+            std::cerr << "❌ Failed to start ffmpeg for " << output_prefix_ << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Width of a rendition, keeping the source aspect ratio (even, like scale=-2)
+    int renditionWidth(const Rendition& r) const {
+        return (input_size_.width * r.height / input_size_.height + 1) & ~1;
+    }
+
+    bool prepareSegmentOutput() {
+        // Segments are cut on keyframes, so the GOP must fit inside one segment
+        int segment_frames = std::max(1, options_.segment_seconds) * options_.fps;
+        if (options_.gop_frames > segment_frames || segment_frames % options_.gop_frames != 0) {
+            options_.gop_frames = segment_frames;
+        }
+
+        std::ofstream master(output_prefix_ + ".m3u8");
+        if (!master) {
+            std::cerr << "❌ Failed to create master playlist for " << output_prefix_ << std::endl;
+            return false;
+        }
+        master << "#EXTM3U\n#EXT-X-VERSION:7\n#EXT-X-INDEPENDENT-SEGMENTS\n";
+
+        std::string base_name = boost::filesystem::path(output_prefix_).filename().string();
+        for (const auto& r : active_) {
+            boost::filesystem::create_directories(output_prefix_ + "_" + r.name);
+            master << "#EXT-X-STREAM-INF:BANDWIDTH=" << r.bitrate_kbps * 1000
+                   << ",RESOLUTION=" << renditionWidth(r) << "x" << r.height
+                   << ",FRAME-RATE=" << options_.fps << "\n"
+                   << base_name << "_" << r.name << "/index.m3u8\n";
+        }
+        return true;
+    }
+
+    std::string buildCommand() const {
+        std::ostringstream cmd;
+        cmd << "ffmpeg -y -loglevel error "
+            << "-f rawvideo "
+            << "-pix_fmt " << (input_channels_ == 1 ? "gray" : "bgr24") << " "
+            << "-s " << input_size_.width << "x" << input_size_.height << " "
+            << "-framerate " << options_.fps << " "
+            << "-i - ";
+
+        // Pyramid: convert once, then every level is scaled from the previous one
+        cmd << "-filter_complex '[0:v]format=yuv420p";
+        for (size_t i = 0; i < active_.size(); i++) {
+            cmd << (i == 0 ? "," : ";[p" + std::to_string(i - 1) + "]")
+                << "scale=-2:" << active_[i].height << ":flags=area";
+            if (i + 1 < active_.size()) {
+                cmd << ",split=2[r" << i << "][p" << i << "]";
+            } else {
+                cmd << "[r" << i << "]";
+            }
+        }
+        cmd << "' ";
+
+        for (size_t i = 0; i < active_.size(); i++) {
+            const Rendition& r = active_[i];
+            cmd << "-map '[r" << i << "]' "
+                << "-c:v libx264 -preset veryfast -profile:v baseline "
+                << "-b:v " << r.bitrate_kbps << "k "
+                << "-maxrate " << r.bitrate_kbps << "k "
+                << "-bufsize " << r.bitrate_kbps * 2 << "k "
+                // Identical, scene-cut free GOP structure in every rendition
+                << "-g " << options_.gop_frames << " "
+                << "-keyint_min " << options_.gop_frames << " "
+                << "-sc_threshold 0 "
+                << "-force_key_frames 'expr:eq(mod(n," << options_.gop_frames << "),0)' "
+                << "-r " << options_.fps << " ";
+
+            if (options_.mode == VideoOutputOptions::Mode::Cmaf) {
+                std::string dir = output_prefix_ + "_" + r.name;
+                cmd << "-f hls "
+                    << "-hls_time " << options_.segment_seconds << " "
+                    << "-hls_segment_type fmp4 "
+                    << "-hls_fmp4_init_filename init.mp4 "
+                    << "-hls_segment_filename '" << dir << "/seg_%05d.m4s' "
+                    << "-hls_playlist_type event "
+                    << "-hls_flags independent_segments+temp_file "
+                    << "'" << dir << "/index.m3u8' ";
+            } else {
+                cmd << "'" << output_prefix_ << "_" << r.name << ".mp4' ";
+            }
+        }
+
+        return cmd.str();
+    }
+};
@@ -0,0 +1,204 @@
+#include "annexb.hpp"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace annexb {
+
+const uint8_t* findZero(const uint8_t* p, const uint8_t* end) {
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    while (end - p >= 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, zero));
+        if (mask) {
+            return p + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+        p += 16;
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    while (end - p >= 16) {
+        uint8x16_t is_zero = vceqzq_u8(vld1q_u8(p));
+        if (vmaxvq_u8(is_zero)) {
+            break;  // the zero is in this block; the scalar tail finds it
+        }
+        p += 16;
+    }
+#else
+    // SWAR: (v - 0x01..) & ~v & 0x80.. is non-zero iff some byte of v is zero
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t highs = 0x8080808080808080ULL;
+    while (end - p >= 8) {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        if ((v - ones) & ~v & highs) {
+            break;
+        }
+        p += 8;
+    }
+#endif
+    while (p < end && *p != 0) {
+        p++;
+    }
+    return p;
+}
+
+const uint8_t* findStartCode(const uint8_t* p, const uint8_t* end) {
+    if (end - p < 3) {
+        return end;
+    }
+    const uint8_t* last = end - 2;  // a start code must begin before here
+    while (p < last) {
+        const uint8_t* z = findZero(p, last);
+        if (z == last) {
+            return end;
+        }
+        if (z[1] == 0x00) {
+            if (z[2] == 0x01) {
+                return z;
+            }
+            p = z + 1;  // 00 00 00 ...: the next zero may start the code
+        } else {
+            p = z + 2;  // z[1] != 0, so neither z nor z + 1 can start a code
+        }
+    }
+    return end;
+}
+
+const uint8_t* findStartCodeScalar(const uint8_t* p, const uint8_t* end) {
+    for (; end - p >= 3; p++) {
+        if (p[0] == 0x00 && p[1] == 0x00 && p[2] == 0x01) {
+            return p;
+        }
+    }
+    return end;
+}
+
+namespace {
+
+template <typename FindFn>
+void split(const uint8_t* data, size_t size, std::vector<Nal>& out, FindFn find) {
+    const uint8_t* end = data + size;
+    const uint8_t* code = find(data, end);
+
+    while (code != end) {
+        const uint8_t* nal = code + 3;
+        const uint8_t* next = find(nal, end);
+
+        // A 4-byte start code's zero_byte (and any trailing_zero_8bits) is not NAL payload
+        const uint8_t* nal_end = next;
+        while (nal_end > nal && nal_end[-1] == 0x00) {
+            nal_end--;
+        }
+        if (nal_end > nal) {
+            out.push_back({nal, static_cast<size_t>(nal_end - nal)});
+        }
+        code = next;
+    }
+}
+
+}  // namespace
+
+void splitNalUnits(const uint8_t* data, size_t size, std::vector<Nal>& out) {
+    split(data, size, out, findStartCode);
+}
+
+void splitNalUnitsScalar(const uint8_t* data, size_t size, std::vector<Nal>& out) {
+    split(data, size, out, findStartCodeScalar);
+}
+
+size_t escapeRbsp(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    size_t inserted = 0;
+    out.reserve(out.size() + size + size / 64 + 1);
+
+    while (p < end) {
+        // Next 00 00 pair; everything before it is copied in one go
+        const uint8_t* z = findZero(p, end);
+        while (z < end && (z + 1 == end || z[1] != 0x00)) {
+            z = findZero(z + 2 <= end ? z + 2 : end, end);
+        }
+        if (z == end) {
+            out.insert(out.end(), p, end);
+            break;
+        }
+
+        out.insert(out.end(), p, z + 2);
+        p = z + 2;
+        if (p == end || *p <= 0x03) {
+            out.push_back(0x03);
+            inserted++;
+        }
+    }
+    return inserted;
+}
+
+size_t escapeRbspScalar(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    size_t inserted = 0;
+    int zeros = 0;
+    out.reserve(out.size() + size + size / 64 + 1);
+
+    for (size_t i = 0; i < size; i++) {
+        if (zeros >= 2 && data[i] <= 0x03) {
+            out.push_back(0x03);
+            inserted++;
+            zeros = 0;
+        }
+        out.push_back(data[i]);
+        zeros = data[i] == 0x00 ? zeros + 1 : 0;
+    }
+    if (zeros >= 2) {
+        out.push_back(0x03);
+        inserted++;
+    }
+    return inserted;
+}
+
+size_t unescapeRbsp(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    size_t removed = 0;
+    out.reserve(out.size() + size);
+
+    while (p < end) {
+        // Next 00 00 03; everything before its 03 is copied in one go
+        const uint8_t* z = findZero(p, end);
+        while (z < end && !(end - z >= 3 && z[1] == 0x00 && z[2] == 0x03)) {
+            z = findZero(z + 1, end);
+        }
+        if (z == end) {
+            out.insert(out.end(), p, end);
+            break;
+        }
+
+        out.insert(out.end(), p, z + 2);
+        p = z + 3;
+        removed++;
+    }
+    return removed;
+}
+
+size_t unescapeRbspScalar(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    size_t removed = 0;
+    int zeros = 0;
+    out.reserve(out.size() + size);
+
+    for (size_t i = 0; i < size; i++) {
+        if (zeros >= 2 && data[i] == 0x03) {
+            removed++;
+            zeros = 0;
+            continue;
+        }
+        out.push_back(data[i]);
+        zeros = data[i] == 0x00 ? zeros + 1 : 0;
+    }
+    return removed;
+}
+
+}  // namespace annexb
@@ -0,0 +1,51 @@
+#pragma once
+
+// H.264 Annex-B byte stream helpers shared by the streamer and the bag processor.
+//
+// All hot loops are built on findZero(), which skips zero-free data 16 bytes
+// at a time with SSE2 or NEON, or 8 bytes at a time with a SWAR zero-byte test
+// elsewhere. Every function has a byte-at-a-time *Scalar() reference with the
+// same contract; annexb_bench checks the two against each other and times them.
+//
+// C++14, no dependencies, so it builds with both the ROS melodic toolchain and
+// the streaming image.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace annexb {
+
+// One NAL unit inside a caller-owned buffer, without its start code
+struct Nal {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    uint8_t type() const { return size ? (data[0] & 0x1F) : 0; }
+};
+
+// First zero byte in [p, end), or end
+const uint8_t* findZero(const uint8_t* p, const uint8_t* end);
+
+// First byte of the next 00 00 01 start code in [p, end), or end.
+// A 4-byte start code is found at its second zero; see splitNalUnits().
+const uint8_t* findStartCode(const uint8_t* p, const uint8_t* end);
+const uint8_t* findStartCodeScalar(const uint8_t* p, const uint8_t* end);
+
+// Splits an Annex-B stream into NAL units. Start codes, and the zero_byte of
+// 4-byte start codes, are not part of the returned units. Appends to out.
+void splitNalUnits(const uint8_t* data, size_t size, std::vector<Nal>& out);
+void splitNalUnitsScalar(const uint8_t* data, size_t size, std::vector<Nal>& out);
+
+// RBSP -> NAL payload: inserts emulation_prevention_three_byte (0x03) after
+// every 00 00 followed by a byte <= 03, and after a trailing 00 00
+// (H.264 7.4.1). Appends to out and returns the number of bytes inserted.
+size_t escapeRbsp(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+size_t escapeRbspScalar(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+
+// NAL payload -> RBSP: removes the 0x03 of every 00 00 03 sequence.
+// Appends to out and returns the number of bytes removed.
+size_t unescapeRbsp(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+size_t unescapeRbspScalar(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+
+}  // namespace annexb
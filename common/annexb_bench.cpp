@@ -0,0 +1,228 @@
+// Microbenchmark and cross-check for the Annex-B helpers in annexb.hpp.
+//
+// For each synthetic input (random payload, an H.264-like NAL stream and a
+// zero-heavy worst case) the vectorized functions are first checked against
+// their scalar references, then both are timed. One JSON line per input and
+// operation is appended to --output, in the same spirit as rosbag_bench.
+//
+// Usage:
+//   ./annexb_bench --size=64 --iterations=20 --label=$(git rev-parse --short HEAD)
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <functional>
+
+#include "annexb.hpp"
+
+namespace {
+
+const char* kSchema = "annexb_bench/1";
+
+struct Input {
+    std::string name;
+    std::vector<uint8_t> data;
+};
+
+// Uniform random bytes: zeros are rare, the fast path skips almost everything
+std::vector<uint8_t> makeRandom(size_t size, std::mt19937& rng) {
+    std::vector<uint8_t> data(size);
+    for (auto& b : data) {
+        b = static_cast<uint8_t>(rng());
+    }
+    return data;
+}
+
+// Start-code delimited NALs of 200 B - 40 KB with emulation-prone payload
+std::vector<uint8_t> makeNalStream(size_t size, std::mt19937& rng) {
+    std::vector<uint8_t> data;
+    data.reserve(size + 64 * 1024);
+    std::uniform_int_distribution<int> nal_size(200, 40 * 1024);
+    std::uniform_int_distribution<int> percent(0, 99);
+    while (data.size() < size) {
+        data.insert(data.end(), {0x00, 0x00, 0x00, 0x01, 0x41});
+        int n = nal_size(rng);
+        for (int i = 0; i < n; i++) {
+            // ~3% zero bytes, with the odd escaped 00 00 03
+            int roll = percent(rng);
+            if (roll < 3) {
+                data.push_back(0x00);
+            } else if (roll == 3) {
+                data.insert(data.end(), {0x00, 0x00, 0x03});
+            } else {
+                data.push_back(static_cast<uint8_t>(rng() | 0x04));
+            }
+        }
+        data.push_back(0x80);  // rbsp_stop_one_bit
+    }
+    return data;
+}
+
+// Mostly zeros: every position is a candidate, the worst case for skipping
+std::vector<uint8_t> makeZeroHeavy(size_t size, std::mt19937& rng) {
+    std::vector<uint8_t> data(size, 0x00);
+    std::uniform_int_distribution<int> percent(0, 99);
+    for (auto& b : data) {
+        int roll = percent(rng);
+        b = roll < 70 ? 0x00 : static_cast<uint8_t>(roll % 4);
+    }
+    return data;
+}
+
+double timeIt(int iterations, const std::function<void()>& fn) {
+    fn();  // warm up caches and the allocator
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        fn();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count() / iterations;
+}
+
+bool sameNals(const std::vector<annexb::Nal>& a, const std::vector<annexb::Nal>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].data != b[i].data || a[i].size != b[i].size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* simdName() {
+#if defined(__SSE2__)
+    return "sse2";
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    return "neon";
+#else
+    return "swar";
+#endif
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t size_mb = 64;
+    int iterations = 20;
+    std::string output_path = "annexb_bench.jsonl";
+    std::string label;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string key = arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+        if (key == "--size") size_mb = std::stoul(value);
+        else if (key == "--iterations") iterations = std::stoi(value);
+        else if (key == "--output") output_path = value;
+        else if (key == "--label") label = value;
+        else {
+            std::cout << "Usage: annexb_bench [--size=MB] [--iterations=N] [--output=FILE] [--label=TEXT]" << std::endl;
+            return key == "--help" ? 0 : 1;
+        }
+    }
+
+    std::mt19937 rng(42);
+    const size_t size = size_mb * 1024 * 1024;
+    std::vector<Input> inputs = {
+        {"random", makeRandom(size, rng)},
+        {"nal_stream", makeNalStream(size, rng)},
+        {"zero_heavy", makeZeroHeavy(size, rng)},
+    };
+
+    std::ofstream output(output_path, std::ios::app);
+    if (!output) {
+        std::cerr << "❌ Cannot open results file: " << output_path << std::endl;
+        return 1;
+    }
+
+    int mismatches = 0;
+    std::cout << "Annex-B scanner (" << simdName() << "), " << size_mb << " MB inputs, "
+              << iterations << " iterations" << std::endl;
+
+    for (const Input& input : inputs) {
+        const uint8_t* data = input.data.data();
+        const size_t n = input.data.size();
+        const double mb = n / (1024.0 * 1024.0);
+
+        std::vector<annexb::Nal> nals_fast, nals_scalar;
+        std::vector<uint8_t> esc_fast, esc_scalar, unesc_fast, unesc_scalar;
+
+        // Correctness first: the fast paths must match the references exactly
+        annexb::splitNalUnits(data, n, nals_fast);
+        annexb::splitNalUnitsScalar(data, n, nals_scalar);
+        annexb::escapeRbsp(data, n, esc_fast);
+        annexb::escapeRbspScalar(data, n, esc_scalar);
+        annexb::unescapeRbsp(data, n, unesc_fast);
+        annexb::unescapeRbspScalar(data, n, unesc_scalar);
+
+        struct Check { const char* op; bool ok; };
+        Check checks[] = {
+            {"split", sameNals(nals_fast, nals_scalar)},
+            {"escape", esc_fast == esc_scalar},
+            {"unescape", unesc_fast == unesc_scalar},
+        };
+        for (const Check& check : checks) {
+            if (!check.ok) {
+                std::cerr << "❌ " << input.name << ": " << check.op << " differs from scalar reference" << std::endl;
+                mismatches++;
+            }
+        }
+
+        struct Op {
+            const char* name;
+            std::function<void()> fast;
+            std::function<void()> scalar;
+        };
+        std::vector<Op> ops = {
+            {"split",
+             [&]() { nals_fast.clear(); annexb::splitNalUnits(data, n, nals_fast); },
+             [&]() { nals_scalar.clear(); annexb::splitNalUnitsScalar(data, n, nals_scalar); }},
+            {"escape",
+             [&]() { esc_fast.clear(); annexb::escapeRbsp(data, n, esc_fast); },
+             [&]() { esc_scalar.clear(); annexb::escapeRbspScalar(data, n, esc_scalar); }},
+            {"unescape",
+             [&]() { unesc_fast.clear(); annexb::unescapeRbsp(data, n, unesc_fast); },
+             [&]() { unesc_scalar.clear(); annexb::unescapeRbspScalar(data, n, unesc_scalar); }},
+        };
+
+        for (const Op& op : ops) {
+            double fast_s = timeIt(iterations, op.fast);
+            double scalar_s = timeIt(iterations, op.scalar);
+
+            std::ostringstream record;
+            record << std::fixed << std::setprecision(3)
+                   << "{\"schema\":\"" << kSchema << "\""
+                   << ",\"label\":\"" << label << "\""
+                   << ",\"simd\":\"" << simdName() << "\""
+                   << ",\"input\":\"" << input.name << "\""
+                   << ",\"op\":\"" << op.name << "\""
+                   << ",\"bytes\":" << n
+                   << ",\"fast_mb_s\":" << mb / fast_s
+                   << ",\"scalar_mb_s\":" << mb / scalar_s
+                   << ",\"speedup\":" << scalar_s / fast_s
+                   << "}";
+            output << record.str() << std::endl;
+
+            std::cout << "  " << std::left << std::setw(11) << input.name << std::setw(9) << op.name
+                      << std::right << std::fixed << std::setprecision(0)
+                      << std::setw(8) << mb / fast_s << " MB/s  (scalar " << std::setw(6) << mb / scalar_s
+                      << " MB/s, " << std::setprecision(1) << scalar_s / fast_s << "x)" << std::endl;
+        }
+    }
+
+    if (mismatches) {
+        std::cerr << "❌ " << mismatches << " mismatch(es) against the scalar reference" << std::endl;
+        return 1;
+    }
+    std::cout << "✅ All fast paths match the scalar reference. Results appended to " << output_path << std::endl;
+    return 0;
+}
@@ -0,0 +1,468 @@
+#include "log.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace logging {
+
+namespace {
+
+using Clock = std::chrono::system_clock;
+
+// Per-thread buffer size; at ~100 bytes a record this holds several hundred
+// records between drains
+constexpr size_t kRingBytes = 64 * 1024;
+constexpr std::chrono::milliseconds kDrainPeriod{5};
+
+struct RecordHeader {
+    const Site* site;
+    const char* format;
+    int64_t wall_ns;
+    uint32_t arg_bytes;
+};
+
+// Single-producer (the owning thread) / single-consumer (whoever holds the
+// drain lock) byte ring. head_ and tail_ only grow; their difference is the
+// number of bytes in use.
+class Ring {
+public:
+    explicit Ring(uint32_t thread_id) : thread_id_(thread_id), bytes_(new uint8_t[kRingBytes]) {}
+
+    // Returns false (and counts a drop) if the record does not fit
+    bool push(const RecordHeader& header, const uint8_t* args, bool& half_full) {
+        size_t size = sizeof(header) + header.arg_bytes;
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        uint64_t tail = tail_.load(std::memory_order_acquire);
+        if (kRingBytes - (head - tail) < size) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            half_full = true;
+            return false;
+        }
+        copyIn(head, &header, sizeof(header));
+        copyIn(head + sizeof(header), args, header.arg_bytes);
+        head_.store(head + size, std::memory_order_release);
+        half_full = head + size - tail > kRingBytes / 2;
+        return true;
+    }
+
+    // Consumer side; `fn(header, args)` is called for every complete record
+    template <typename Fn>
+    void drain(std::vector<uint8_t>& scratch, Fn fn) {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        uint64_t head = head_.load(std::memory_order_acquire);
+        while (tail < head) {
+            RecordHeader header;
+            copyOut(tail, &header, sizeof(header));
+            scratch.resize(header.arg_bytes);
+            copyOut(tail + sizeof(header), scratch.data(), header.arg_bytes);
+            tail += sizeof(header) + header.arg_bytes;
+            fn(header, scratch);
+        }
+        tail_.store(tail, std::memory_order_release);
+    }
+
+    bool empty() const {
+        return tail_.load(std::memory_order_acquire) == head_.load(std::memory_order_acquire);
+    }
+
+    uint64_t takeDropped() { return dropped_.exchange(0, std::memory_order_relaxed); }
+
+    uint32_t threadId() const { return thread_id_; }
+
+    std::atomic<bool> closed{false};
+
+private:
+    void copyIn(uint64_t position, const void* data, size_t size) {
+        size_t offset = position % kRingBytes;
+        size_t first = std::min(size, kRingBytes - offset);
+        std::memcpy(bytes_.get() + offset, data, first);
+        std::memcpy(bytes_.get(), static_cast<const uint8_t*>(data) + first, size - first);
+    }
+
+    void copyOut(uint64_t position, void* data, size_t size) const {
+        size_t offset = position % kRingBytes;
+        size_t first = std::min(size, kRingBytes - offset);
+        std::memcpy(data, bytes_.get() + offset, first);
+        std::memcpy(static_cast<uint8_t*>(data) + first, bytes_.get(), size - first);
+    }
+
+    const uint32_t thread_id_;
+    std::unique_ptr<uint8_t[]> bytes_;
+    alignas(64) std::atomic<uint64_t> head_{0};
+    alignas(64) std::atomic<uint64_t> tail_{0};
+    std::atomic<uint64_t> dropped_{0};
+};
+
+// One record pulled out of a ring, waiting to be ordered and formatted
+struct Entry {
+    int64_t wall_ns;
+    uint32_t thread_id;
+    const Site* site;
+    const char* format;
+    std::string args;
+};
+
+void appendf(std::string& out, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+void appendf(std::string& out, const char* fmt, ...) {
+    char buffer[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = std::vsnprintf(buffer, sizeof(buffer), fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        out.append(buffer, std::min<size_t>(static_cast<size_t>(n), sizeof(buffer) - 1));
+    }
+}
+
+// Appends the next encoded argument; false once the arguments run out
+bool appendArg(std::string& out, const uint8_t*& p, const uint8_t* end) {
+    if (p >= end) {
+        return false;
+    }
+    auto tag = static_cast<detail::Tag>(*p++);
+    switch (tag) {
+        case detail::Tag::Int: {
+            int64_t v;
+            std::memcpy(&v, p, sizeof(v));
+            p += sizeof(v);
+            appendf(out, "%lld", static_cast<long long>(v));
+            return true;
+        }
+        case detail::Tag::Uint: {
+            uint64_t v;
+            std::memcpy(&v, p, sizeof(v));
+            p += sizeof(v);
+            appendf(out, "%llu", static_cast<unsigned long long>(v));
+            return true;
+        }
+        case detail::Tag::Double: {
+            double v;
+            std::memcpy(&v, p, sizeof(v));
+            p += sizeof(v);
+            appendf(out, "%g", v);
+            return true;
+        }
+        case detail::Tag::Bool:
+            out += *p++ ? "true" : "false";
+            return true;
+        case detail::Tag::Char:
+            out += static_cast<char>(*p++);
+            return true;
+        case detail::Tag::String: {
+            uint16_t size;
+            std::memcpy(&size, p, sizeof(size));
+            p += sizeof(size);
+            out.append(reinterpret_cast<const char*>(p), size);
+            p += size;
+            return true;
+        }
+        case detail::Tag::Pointer: {
+            uint64_t v;
+            std::memcpy(&v, p, sizeof(v));
+            p += sizeof(v);
+            appendf(out, "0x%llx", static_cast<unsigned long long>(v));
+            return true;
+        }
+    }
+    p = end;
+    return false;
+}
+
+std::string formatMessage(const char* format, const std::string& args) {
+    std::string out;
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(args.data());
+    const uint8_t* end = p + args.size();
+    for (const char* f = format; *f; f++) {
+        if (f[0] == '{' && f[1] == '}') {
+            if (!appendArg(out, p, end)) {
+                out += "{}";
+            }
+            f++;
+        } else {
+            out += *f;
+        }
+    }
+    return out;
+}
+
+void appendJsonString(std::string& out, const std::string& text) {
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    appendf(out, "\\u%04x", static_cast<unsigned>(c));
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+const char* baseName(const char* path) {
+    const char* slash = std::strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+int initialLevel() {
+    Level level = Level::Info;
+    if (const char* env = std::getenv("LOG_LEVEL")) {
+        if (!parseLevel(env, level)) {
+            std::fprintf(stderr, "⚠️  Unknown LOG_LEVEL '%s', using info\n", env);
+        }
+    }
+    return static_cast<int>(level);
+}
+
+class Logger {
+public:
+    // Never destroyed, so threads that log during static destruction still
+    // find it; the drain thread is stopped from an atexit handler instead
+    static Logger& instance() {
+        static Logger* logger = new Logger();
+        return *logger;
+    }
+
+    std::shared_ptr<Ring> registerThread() {
+        std::lock_guard<std::mutex> lock(registry_mutex_);
+        auto ring = std::make_shared<Ring>(next_thread_id_++);
+        rings_.push_back(ring);
+        return ring;
+    }
+
+    void wake() { wake_cv_.notify_one(); }
+
+    bool stopped() const { return stopped_.load(std::memory_order_acquire); }
+
+    void flush() {
+        std::lock_guard<std::mutex> lock(drain_mutex_);
+        drain();
+    }
+
+private:
+    Logger() {
+        const char* format = std::getenv("LOG_FORMAT");
+        json_ = format && std::strcmp(format, "json") == 0;
+        thread_ = std::thread([this] { run(); });
+        std::atexit([] { instance().shutdown(); });
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        while (!stopping_) {
+            wake_cv_.wait_for(lock, kDrainPeriod);
+            lock.unlock();
+            flush();
+            lock.lock();
+        }
+    }
+
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            stopping_ = true;
+        }
+        wake_cv_.notify_one();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        // From here on every record is written synchronously by its producer
+        stopped_.store(true, std::memory_order_release);
+        flush();
+    }
+
+    // Caller holds drain_mutex_
+    void drain() {
+        std::vector<std::shared_ptr<Ring>> rings;
+        {
+            std::lock_guard<std::mutex> lock(registry_mutex_);
+            // A finished thread's ring goes once it has been emptied
+            rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+                                        [](const std::shared_ptr<Ring>& ring) {
+                                            return ring->closed && ring->empty();
+                                        }),
+                         rings_.end());
+            rings = rings_;
+        }
+
+        entries_.clear();
+        std::string out;
+        for (const auto& ring : rings) {
+            ring->drain(scratch_, [&](const RecordHeader& header, const std::vector<uint8_t>& args) {
+                entries_.push_back({header.wall_ns, ring->threadId(), header.site, header.format,
+                                    std::string(args.begin(), args.end())});
+            });
+            if (uint64_t dropped = ring->takeDropped()) {
+                appendf(out, "⚠️  Log buffer full: dropped %llu record(s) from thread %u\n",
+                        static_cast<unsigned long long>(dropped), ring->threadId());
+            }
+        }
+        if (entries_.empty() && out.empty()) {
+            return;
+        }
+
+        // Each ring is already in order; merge them into one timeline
+        std::stable_sort(entries_.begin(), entries_.end(),
+                         [](const Entry& a, const Entry& b) { return a.wall_ns < b.wall_ns; });
+        for (const Entry& entry : entries_) {
+            appendEntry(out, entry);
+        }
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        std::fflush(stdout);
+    }
+
+    void appendEntry(std::string& out, const Entry& entry) const {
+        std::string message = formatMessage(entry.format, entry.args);
+        time_t seconds = static_cast<time_t>(entry.wall_ns / 1000000000);
+        int millis = static_cast<int>(entry.wall_ns / 1000000 % 1000);
+
+        if (json_) {
+            appendf(out, "{\"ts_ms\":%lld,\"level\":\"%s\",\"thread\":%u,\"file\":\"%s\",\"line\":%d,\"msg\":",
+                    static_cast<long long>(entry.wall_ns / 1000000), toString(entry.site->level),
+                    entry.thread_id, baseName(entry.site->file), entry.site->line);
+            appendJsonString(out, message);
+            out += "}\n";
+            return;
+        }
+
+        struct tm local;
+        localtime_r(&seconds, &local);
+        appendf(out, "[%02d:%02d:%02d.%03d] ", local.tm_hour, local.tm_min, local.tm_sec, millis);
+        out += message;
+        out += '\n';
+    }
+
+    std::mutex registry_mutex_;
+    std::vector<std::shared_ptr<Ring>> rings_;
+    uint32_t next_thread_id_ = 1;
+
+    std::mutex drain_mutex_;
+    std::vector<Entry> entries_;       // guarded by drain_mutex_
+    std::vector<uint8_t> scratch_;     // guarded by drain_mutex_
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    bool stopping_ = false;
+    std::atomic<bool> stopped_{false};
+
+    bool json_ = false;
+    std::thread thread_;
+};
+
+struct ThreadState {
+    std::shared_ptr<Ring> ring;
+    uint8_t staging[detail::kMaxArgBytes];
+
+    ~ThreadState() {
+        if (ring) {
+            ring->closed = true;
+        }
+    }
+};
+
+thread_local ThreadState t_state;
+
+}  // namespace
+
+namespace detail {
+
+std::atomic<int> g_level{initialLevel()};
+
+Writer staging() {
+    return Writer{t_state.staging, t_state.staging + kMaxArgBytes};
+}
+
+void commit(const Site& site, const char* format, const Writer& writer) {
+    Logger& logger = Logger::instance();
+    if (!t_state.ring) {
+        t_state.ring = logger.registerThread();
+    }
+
+    RecordHeader header;
+    header.site = &site;
+    header.format = format;
+    header.wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    header.arg_bytes = static_cast<uint32_t>(writer.p - t_state.staging);
+
+    bool half_full = false;
+    t_state.ring->push(header, t_state.staging, half_full);
+    if (logger.stopped()) {
+        logger.flush();
+    } else if (half_full || site.level >= Level::Warn) {
+        logger.wake();
+    }
+}
+
+bool rateAllows(std::atomic<int64_t>& last, int64_t interval_ms) {
+    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t previous = last.load(std::memory_order_relaxed);
+    if (previous != 0 && now - previous < interval_ms) {
+        return false;
+    }
+    return last.compare_exchange_strong(previous, now, std::memory_order_relaxed);
+}
+
+}  // namespace detail
+
+bool parseLevel(const std::string& text, Level& level) {
+    std::string lower;
+    for (char c : text) {
+        lower += static_cast<char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+    }
+    if (lower == "debug") {
+        level = Level::Debug;
+    } else if (lower == "info") {
+        level = Level::Info;
+    } else if (lower == "warn" || lower == "warning") {
+        level = Level::Warn;
+    } else if (lower == "error") {
+        level = Level::Error;
+    } else if (lower == "off" || lower == "none") {
+        level = Level::Off;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* toString(Level level) {
+    switch (level) {
+        case Level::Debug: return "debug";
+        case Level::Info: return "info";
+        case Level::Warn: return "warn";
+        case Level::Error: return "error";
+        case Level::Off: return "off";
+    }
+    return "unknown";
+}
+
+void setLevel(Level level) {
+    detail::g_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+Level level() {
+    return static_cast<Level>(detail::g_level.load(std::memory_order_relaxed));
+}
+
+void flush() {
+    Logger::instance().flush();
+}
+
+}  // namespace logging
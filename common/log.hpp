@@ -0,0 +1,223 @@
+#pragma once
+
+// Asynchronous logging shared by the streamer and the bag processor.
+//
+// A log statement copies its arguments, in binary, into a lock-free ring
+// owned by the calling thread; one background thread formats the records,
+// merges the rings in timestamp order and writes them to stdout in batches
+// with a single flush. Nothing on the calling thread formats text, takes a
+// lock or touches stdout, and a statement below the active level is one
+// relaxed load and a branch.
+//
+//   LOG_INFO("📤 Sent access unit {} ({} NALs)", index, nals.size());
+//   LOG_EVERY_N(logging::Level::Debug, 30, "unit {}", index);   // 1 in 30
+//   LOG_EVERY_MS(logging::Level::Warn, 1000, "send failed");    // at most 1/s
+//
+// Placeholders are "{}". Arguments may be integers, floating point, bool,
+// char, enums, pointers, C strings and std::string (strings are copied and
+// truncated to fit a record). The format must be a string literal.
+//
+// Levels: LOG_COMPILE_LEVEL (a LOG_LEVEL_* value) removes statements below it
+// at compile time; $LOG_LEVEL (debug, info, warn, error, off) or setLevel()
+// filters at runtime. $LOG_FORMAT=json writes one JSON object per line.
+//
+// If a thread's ring is full the record is dropped and counted, never
+// blocked on. C++14, no dependencies.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_OFF 4
+
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+namespace logging {
+
+enum class Level : int {
+    Debug = LOG_LEVEL_DEBUG,
+    Info = LOG_LEVEL_INFO,
+    Warn = LOG_LEVEL_WARN,
+    Error = LOG_LEVEL_ERROR,
+    Off = LOG_LEVEL_OFF
+};
+
+// Parses "debug" / "info" / "warn" / "error" / "off" (case-insensitive)
+bool parseLevel(const std::string& text, Level& level);
+const char* toString(Level level);
+
+void setLevel(Level level);
+Level level();
+
+// Writes out everything logged so far, from the calling thread
+void flush();
+
+// Static part of a log statement, one per call site
+struct Site {
+    Level level;
+    const char* file;
+    int line;
+};
+
+namespace detail {
+
+extern std::atomic<int> g_level;  // initialised from $LOG_LEVEL
+
+inline bool enabled(Level level) {
+    return static_cast<int>(level) >= g_level.load(std::memory_order_relaxed);
+}
+
+enum class Tag : uint8_t { Int, Uint, Double, Bool, Char, String, Pointer };
+
+// Largest encoded argument list of one record; longer strings are truncated
+constexpr size_t kMaxArgBytes = 1024;
+
+// Argument encoder over the calling thread's staging buffer
+struct Writer {
+    uint8_t* p;
+    uint8_t* end;
+
+    void put(Tag tag, const void* data, size_t size) {
+        if (end - p < static_cast<ptrdiff_t>(1 + size)) {
+            return;
+        }
+        *p++ = static_cast<uint8_t>(tag);
+        std::memcpy(p, data, size);
+        p += size;
+    }
+
+    void putString(const char* text, size_t length) {
+        if (end - p < 3) {
+            return;
+        }
+        length = std::min<size_t>(length, static_cast<size_t>(end - p) - 3);
+        uint16_t size = static_cast<uint16_t>(length);
+        *p++ = static_cast<uint8_t>(Tag::String);
+        std::memcpy(p, &size, sizeof(size));
+        p += sizeof(size);
+        std::memcpy(p, text, length);
+        p += length;
+    }
+};
+
+Writer staging();
+void commit(const Site& site, const char* format, const Writer& writer);
+
+// True at most once per interval across all threads sharing `last`
+bool rateAllows(std::atomic<int64_t>& last, int64_t interval_ms);
+
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value && !std::is_same<T, char>::value>::type
+encode(Writer& w, T value) {
+    int64_t v = value;
+    w.put(Tag::Int, &v, sizeof(v));
+}
+
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value && !std::is_same<T, bool>::value>::type
+encode(Writer& w, T value) {
+    uint64_t v = value;
+    w.put(Tag::Uint, &v, sizeof(v));
+}
+
+template <typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type encode(Writer& w, T value) {
+    double v = value;
+    w.put(Tag::Double, &v, sizeof(v));
+}
+
+template <typename T>
+typename std::enable_if<std::is_enum<T>::value>::type encode(Writer& w, T value) {
+    int64_t v = static_cast<int64_t>(value);
+    w.put(Tag::Int, &v, sizeof(v));
+}
+
+inline void encode(Writer& w, bool value) {
+    uint8_t v = value ? 1 : 0;
+    w.put(Tag::Bool, &v, sizeof(v));
+}
+
+inline void encode(Writer& w, char value) {
+    w.put(Tag::Char, &value, sizeof(value));
+}
+
+inline void encode(Writer& w, const char* text) {
+    if (!text) {
+        text = "(null)";
+    }
+    w.putString(text, std::strlen(text));
+}
+
+inline void encode(Writer& w, char* text) {
+    encode(w, static_cast<const char*>(text));
+}
+
+inline void encode(Writer& w, const std::string& text) {
+    w.putString(text.data(), text.size());
+}
+
+template <typename T>
+void encode(Writer& w, T* pointer) {
+    uint64_t v = reinterpret_cast<uintptr_t>(pointer);
+    w.put(Tag::Pointer, &v, sizeof(v));
+}
+
+}  // namespace detail
+
+template <size_t N, typename... Args>
+void write(const Site& site, const char (&format)[N], const Args&... args) {
+    detail::Writer writer = detail::staging();
+    int expand[] = {0, (detail::encode(writer, args), 0)...};
+    (void)expand;
+    detail::commit(site, format, writer);
+}
+
+}  // namespace logging
+
+#define LOG_ENABLED(lvl) \
+    (static_cast<int>(lvl) >= LOG_COMPILE_LEVEL && ::logging::detail::enabled(lvl))
+
+#define LOG_AT(lvl, ...)                                                          \
+    do {                                                                          \
+        if (LOG_ENABLED(lvl)) {                                                   \
+            static const ::logging::Site log_site_{(lvl), __FILE__, __LINE__};    \
+            ::logging::write(log_site_, __VA_ARGS__);                             \
+        }                                                                         \
+    } while (0)
+
+#define LOG_DEBUG(...) LOG_AT(::logging::Level::Debug, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(::logging::Level::Info, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(::logging::Level::Warn, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(::logging::Level::Error, __VA_ARGS__)
+
+// First of every n executions of this statement
+#define LOG_EVERY_N(lvl, n, ...)                                                     \
+    do {                                                                             \
+        if (LOG_ENABLED(lvl)) {                                                      \
+            static std::atomic<uint64_t> log_count_{0};                              \
+            if (log_count_.fetch_add(1, std::memory_order_relaxed) % (n) == 0) {     \
+                LOG_AT(lvl, __VA_ARGS__);                                            \
+            }                                                                        \
+        }                                                                            \
+    } while (0)
+
+// At most once per ms milliseconds for this statement
+#define LOG_EVERY_MS(lvl, ms, ...)                                                   \
+    do {                                                                             \
+        if (LOG_ENABLED(lvl)) {                                                      \
+            static std::atomic<int64_t> log_last_{0};                                \
+            if (::logging::detail::rateAllows(log_last_, (ms))) {                    \
+                LOG_AT(lvl, __VA_ARGS__);                                            \
+            }                                                                        \
+        }                                                                            \
+    } while (0)
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "annexb.hpp"
+
+// Non-owning view of one NAL unit (no start code or length prefix). The bytes
+// belong to a MediaSource, which outlives every cursor that hands out views.
+using NalView = annexb::Nal;
+
+// One access unit in decode order. Timestamps are in the source timescale;
+// pts = dts + composition offset.
+struct AccessUnit {
+    size_t index = 0;
+    int64_t dts = 0;
+    int64_t pts = 0;
+    bool keyframe = false;
+    std::vector<NalView> nal_units;
+};
+
+// Finds access-unit boundaries in a stream of Annex-B NAL units
+// (H.264 7.4.1.2.3). A new access unit starts when, after a slice of the
+// current one, the stream has either a non-VCL NAL that may only precede
+// the primary coded picture (AUD, SPS, PPS, SEI, 14-18) or a slice whose
+// first_mb_in_slice is 0.
+class AccessUnitGrouper {
+public:
+    // True if nal begins a new access unit; call once per NAL in stream order
+    bool startsNewAccessUnit(const NalView& nal) {
+        const uint8_t type = nal.type();
+        const bool vcl = type >= 1 && type <= 5;
+        bool boundary = false;
+
+        if (seen_vcl_) {
+            if (vcl) {
+                // first_mb_in_slice is the first ue(v) of the slice header; 0 encodes as a single 1 bit
+                boundary = nal.size > 1 && (nal.data[1] & 0x80) != 0;
+            } else {
+                boundary = type == 6 || type == 7 || type == 8 || type == 9 || (type >= 14 && type <= 18);
+            }
+        }
+
+        if (boundary) {
+            seen_vcl_ = false;
+        }
+        if (vcl) {
+            seen_vcl_ = true;
+        }
+        return boundary;
+    }
+
+    void reset() { seen_vcl_ = false; }
+
+private:
+    bool seen_vcl_ = false;
+};
@@ -0,0 +1,240 @@
+#include "broadcast_source.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+bool parseFastStart(const std::string& text, FastStart& mode) {
+    std::string lower = text;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    if (lower == "off" || lower == "none" || lower == "0") {
+        mode = FastStart::Off;
+    } else if (lower == "keyframe" || lower.empty()) {
+        mode = FastStart::Keyframe;
+    } else if (lower == "gop") {
+        mode = FastStart::Gop;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* toString(FastStart mode) {
+    switch (mode) {
+        case FastStart::Off: return "off";
+        case FastStart::Keyframe: return "keyframe";
+        case FastStart::Gop: return "gop";
+    }
+    return "unknown";
+}
+
+FastStart defaultFastStart() {
+    FastStart mode = FastStart::Keyframe;
+    const char* env = std::getenv("STREAM_FAST_START");
+    if (env && !parseFastStart(env, mode)) {
+        std::cout << "⚠️  Ignoring unknown STREAM_FAST_START value: " << env << std::endl;
+    }
+    return mode;
+}
+
+void KeyframeCache::add(const SharedAccessUnitPtr& unit) {
+    if (mode_ == FastStart::Off) {
+        return;
+    }
+    size_t size = 0;
+    bool has_parameter_sets = false;
+    for (const NalView& nal : unit->au.nal_units) {
+        size += nal.size;
+        if (nal.type() == 7) {
+            sps_.assign(nal.data, nal.data + nal.size);
+            has_parameter_sets = true;
+        } else if (nal.type() == 8) {
+            pps_.assign(nal.data, nal.data + nal.size);
+        }
+    }
+
+    if (unit->au.keyframe) {
+        gop_.assign(1, has_parameter_sets ? unit : withParameterSets(unit));
+        gop_bytes_ = size;
+        complete_ = mode_ == FastStart::Gop;
+        return;
+    }
+    if (!complete_) {
+        return;
+    }
+    if (gop_bytes_ + size > kMaxGopBytes) {
+        // Too much to replay; keep just the keyframe until the next one
+        gop_.resize(1);
+        complete_ = false;
+        return;
+    }
+    gop_.push_back(unit);
+    gop_bytes_ += size;
+}
+
+SharedAccessUnitPtr KeyframeCache::withParameterSets(const SharedAccessUnitPtr& keyframe) const {
+    if (sps_.empty() || pps_.empty()) {
+        return keyframe;
+    }
+    auto unit = std::make_shared<SharedAccessUnit>();
+    unit->au.index = keyframe->au.index;
+    unit->au.dts = keyframe->au.dts;
+    unit->au.pts = keyframe->au.pts;
+    unit->au.keyframe = true;
+    unit->pts_seconds = keyframe->pts_seconds;
+    unit->capture_ms = keyframe->capture_ms;
+
+    // SPS and PPS live in storage; the keyframe's own NALs stay where they are
+    unit->storage.reserve(sps_.size() + pps_.size());
+    unit->storage.insert(unit->storage.end(), sps_.begin(), sps_.end());
+    unit->storage.insert(unit->storage.end(), pps_.begin(), pps_.end());
+    unit->au.nal_units.push_back({unit->storage.data(), sps_.size()});
+    unit->au.nal_units.push_back({unit->storage.data() + sps_.size(), pps_.size()});
+    unit->au.nal_units.insert(unit->au.nal_units.end(), keyframe->au.nal_units.begin(),
+                              keyframe->au.nal_units.end());
+    unit->owner = keyframe;
+    return unit;
+}
+
+BroadcastSource::BroadcastSource(std::string name, FastStart fast_start)
+    : name_(std::move(name)), fast_start_(fast_start), cache_(fast_start) {}
+
+void BroadcastSource::close() {
+    finished_ = true;
+    std::cout << "📡 Broadcast " << name_ << " ended after " << published_units_ << " access units" << std::endl;
+}
+
+void BroadcastSource::subscribe(const std::string& id, Sink sink) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Subscription& subscription = subscribers_[id];
+    subscription.sink = std::move(sink);
+    subscription.synced = false;
+    subscription.primed = false;
+    had_subscribers_ = true;
+
+    // A replayable GOP makes a fresh keyframe unnecessary for this joiner; a
+    // request raised by an earlier one (shown a still, waiting for an IDR) stands
+    bool replay = fast_start_ == FastStart::Gop && cache_.complete();
+    if (!replay) {
+        keyframe_requested_ = true;
+    }
+    bool cached = fast_start_ != FastStart::Off && cache_.keyframe();
+    std::cout << "📡 " << id << " joined broadcast " << name_ << " (" << subscribers_.size() << " viewer(s)), "
+              << (replay ? "replaying the current GOP" : cached ? "starting from the cached keyframe"
+                                                                : "waiting for the next keyframe")
+              << std::endl;
+}
+
+void BroadcastSource::unsubscribe(const std::string& id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (subscribers_.erase(id)) {
+        std::cout << "📡 " << id << " left broadcast " << name_ << " (" << subscribers_.size()
+                  << " viewer(s))" << std::endl;
+    }
+}
+
+size_t BroadcastSource::subscriberCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return subscribers_.size();
+}
+
+bool BroadcastSource::running() const {
+    if (stop_requested_) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !had_subscribers_ || !subscribers_.empty();
+}
+
+void BroadcastSource::publish(const AccessUnit& au, double pts_seconds, int64_t capture_ms,
+                              std::shared_ptr<const void> owner) {
+    auto unit = std::make_shared<SharedAccessUnit>();
+    unit->au.index = au.index;
+    unit->au.dts = au.dts;
+    unit->au.pts = au.pts;
+    unit->au.keyframe = au.keyframe;
+    unit->pts_seconds = pts_seconds;
+    unit->capture_ms = capture_ms;
+
+    if (owner) {
+        unit->owner = std::move(owner);
+        unit->au.nal_units = au.nal_units;
+    } else {
+        // One copy per access unit, however many peers receive it
+        size_t total = 0;
+        for (const NalView& nal : au.nal_units) {
+            total += nal.size;
+        }
+        unit->storage.reserve(total);
+        for (const NalView& nal : au.nal_units) {
+            unit->storage.insert(unit->storage.end(), nal.data, nal.data + nal.size);
+        }
+        const uint8_t* p = unit->storage.data();
+        unit->au.nal_units.reserve(au.nal_units.size());
+        for (const NalView& nal : au.nal_units) {
+            unit->au.nal_units.push_back({p, nal.size});
+            p += nal.size;
+        }
+    }
+    published_units_++;
+
+    SharedAccessUnitPtr shared = std::move(unit);
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = subscribers_.begin(); it != subscribers_.end();) {
+        Subscription& subscription = it->second;
+        if (!subscription.synced) {
+            if (shared->au.keyframe) {
+                subscription.synced = true;
+                if (!subscription.primed) {
+                    subscription.first_pts = pts_seconds;
+                }
+                std::cout << "🔑 " << it->first << " synced to " << name_ << " at unit " << au.index << std::endl;
+            } else if (!subscription.primed && fast_start_ != FastStart::Off && cache_.keyframe()) {
+                if (!fastStart(it->first, subscription, pts_seconds)) {
+                    std::cout << "📡 Dropping " << it->first << " from broadcast " << name_ << std::endl;
+                    it = subscribers_.erase(it);
+                    continue;
+                }
+            }
+            if (!subscription.synced) {
+                ++it;
+                continue;
+            }
+        }
+        if (!subscription.sink(shared, pts_seconds - subscription.first_pts)) {
+            std::cout << "📡 Dropping " << it->first << " from broadcast " << name_ << std::endl;
+            it = subscribers_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    cache_.add(shared);
+}
+
+bool BroadcastSource::fastStart(const std::string& id, Subscription& subscription, double pts_seconds) {
+    if (fast_start_ == FastStart::Gop && cache_.complete()) {
+        // The whole chain up to this unit, stamped just ahead of it so the
+        // receiver decodes it at once and shows the current picture
+        const std::vector<SharedAccessUnitPtr>& gop = cache_.gop();
+        subscription.first_pts = pts_seconds - gop.size() * kReplaySpacing;
+        for (size_t i = 0; i < gop.size(); i++) {
+            if (!subscription.sink(gop[i], i * kReplaySpacing)) {
+                return false;
+            }
+        }
+        subscription.synced = true;
+        std::cout << "⚡ " << id << " fast-started on " << name_ << " with " << gop.size()
+                  << " cached access unit(s)" << std::endl;
+        return true;
+    }
+
+    // The last keyframe as a still; the picture moves from the next keyframe on,
+    // which keeps this unit's pts so the RTP clock only goes forward
+    subscription.first_pts = pts_seconds;
+    subscription.primed = true;
+    if (!subscription.sink(cache_.keyframe(), 0.0)) {
+        return false;
+    }
+    std::cout << "⚡ " << id << " shown the cached keyframe of " << name_ << ", live from the next one" << std::endl;
+    return true;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "access_unit.hpp"
+#include "video_streams.hpp"
+
+// One access unit as produced by a broadcast source, shared read-only by
+// every subscriber. NAL views point either into `storage` or into memory kept
+// alive by `owner` (e.g. the mapped file of a MediaSource).
+struct SharedAccessUnit {
+    AccessUnit au;
+    double pts_seconds = 0.0;  // source media time
+    int64_t capture_ms = 0;    // capture time (Unix ms) if known, else 0
+    std::vector<uint8_t> storage;
+    std::shared_ptr<const void> owner;
+};
+using SharedAccessUnitPtr = std::shared_ptr<const SharedAccessUnit>;
+
+// What a subscriber that joins mid-GOP gets before the next keyframe
+enum class FastStart {
+    Off,       // nothing: it waits for the next keyframe
+    Keyframe,  // the last keyframe at once, as a still, then live from the next keyframe
+    Gop        // the last keyframe and every unit since, as a burst, then live right away
+};
+
+// Parses "off" / "keyframe" / "gop" (case-insensitive)
+bool parseFastStart(const std::string& text, FastStart& mode);
+const char* toString(FastStart mode);
+
+// $STREAM_FAST_START, else Keyframe
+FastStart defaultFastStart();
+
+// Parameter sets and the latest keyframe of one source, plus (in Gop mode)
+// the units published after it, so a new subscriber can decode at once.
+// Not thread-safe; BroadcastSource uses it under its lock.
+class KeyframeCache {
+public:
+    // A burst larger than this would stall a cellular uplink for longer than waiting
+    static constexpr size_t kMaxGopBytes = 1 << 20;
+
+    explicit KeyframeCache(FastStart mode) : mode_(mode) {}
+
+    // Every published unit, in decode order
+    void add(const SharedAccessUnitPtr& unit);
+
+    // Latest keyframe, with the current SPS/PPS in front if it had none; null before the first
+    SharedAccessUnitPtr keyframe() const { return gop_.empty() ? nullptr : gop_.front(); }
+
+    // Keyframe and every unit since, if the whole chain is held (Gop mode, within kMaxGopBytes)
+    bool complete() const { return complete_ && !gop_.empty(); }
+    const std::vector<SharedAccessUnitPtr>& gop() const { return gop_; }
+
+private:
+    const FastStart mode_;
+    std::vector<uint8_t> sps_;
+    std::vector<uint8_t> pps_;
+    std::vector<SharedAccessUnitPtr> gop_;
+    size_t gop_bytes_ = 0;
+    bool complete_ = false;
+
+    SharedAccessUnitPtr withParameterSets(const SharedAccessUnitPtr& keyframe) const;
+};
+
+// A single producer (file reader or live encoder) whose access units are
+// fanned out to any number of peers, so the Nth viewer costs one packetizer
+// pass rather than another decode/encode pipeline.
+//
+// The producer is an ordinary scheduled stream (FileStream, ImageStream)
+// whose output is this source; it publishes each unit through send().
+// A subscriber's pts starts at 0 with the first keyframe it receives, so its
+// RTP clock starts with the IDR. Joining mid-GOP, it is fast-started from the
+// keyframe cache on the next publish (see FastStart); otherwise, or before the
+// first keyframe, it only receives units from the next keyframe. Joining
+// raises a keyframe request that live producers should honour via
+// takeKeyframeRequest(), unless the cache can replay the whole GOP.
+class BroadcastSource : public AccessUnitOutput {
+public:
+    // Returns false to unsubscribe (e.g. the peer's track closed)
+    using Sink = std::function<bool(const SharedAccessUnitPtr& unit, double pts_seconds)>;
+
+    explicit BroadcastSource(std::string name, FastStart fast_start = defaultFastStart());
+
+    BroadcastSource(const BroadcastSource&) = delete;
+    BroadcastSource& operator=(const BroadcastSource&) = delete;
+
+    const std::string& name() const { return name_; }
+
+    // Ends the broadcast; the producer sees active() turn false on its next step
+    void stop() { stop_requested_ = true; }
+
+    void subscribe(const std::string& id, Sink sink);
+    void unsubscribe(const std::string& id);
+    size_t subscriberCount() const;
+
+    // For producers: keep going while this is true. It turns false on stop()
+    // or once the last subscriber has left.
+    bool running() const;
+    bool finished() const { return finished_; }
+
+    // AccessUnitOutput, for the producing stream
+    bool active() override { return running(); }
+    void send(const AccessUnit& au, double pts_seconds, int64_t capture_ms,
+              const std::shared_ptr<const void>& owner) override {
+        publish(au, pts_seconds, capture_ms, owner);
+    }
+    bool takeKeyframeRequest() override { return keyframe_requested_.exchange(false); }
+    void close() override;
+
+    // For producers: shares au with all subscribers. If owner is null the NAL
+    // bytes are copied once; otherwise owner must keep them alive.
+    void publish(const AccessUnit& au, double pts_seconds, int64_t capture_ms = 0,
+                 std::shared_ptr<const void> owner = nullptr);
+
+    void requestKeyframe() { keyframe_requested_ = true; }
+
+    uint64_t publishedUnits() const { return published_units_; }
+
+private:
+    // Spacing of replayed units' timestamps: they are due at once, in decode order
+    static constexpr double kReplaySpacing = 0.001;
+
+    struct Subscription {
+        Sink sink;
+        bool synced = false;
+        bool primed = false;  // got the cached keyframe as a still; waits for the next one
+        double first_pts = 0.0;
+    };
+
+    const std::string name_;
+    const FastStart fast_start_;
+    mutable std::mutex mutex_;
+    std::map<std::string, Subscription> subscribers_;
+    KeyframeCache cache_;
+    bool had_subscribers_ = false;
+    std::atomic<bool> stop_requested_{false};
+    std::atomic<bool> finished_{false};
+    std::atomic<bool> keyframe_requested_{false};
+    std::atomic<uint64_t> published_units_{0};
+
+    // Caller holds mutex_; false if the subscriber is gone
+    bool fastStart(const std::string& id, Subscription& subscription, double pts_seconds);
+};
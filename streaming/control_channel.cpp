@@ -0,0 +1,165 @@
+#include "control_channel.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+uint32_t readBig(const uint8_t* p, size_t size) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < size; i++) {
+        value = value << 8 | p[i];
+    }
+    return value;
+}
+
+// Rounds and saturates v into an unsigned field of `bytes` bytes
+uint32_t clampField(double v, size_t bytes) {
+    double max = bytes >= 4 ? 4294967295.0 : static_cast<double>((1u << (8 * bytes)) - 1);
+    return static_cast<uint32_t>(std::min(max, std::max(0.0, std::round(v))));
+}
+
+void put(std::vector<uint8_t>& message, ControlTag tag, uint32_t value, size_t bytes) {
+    message.push_back(static_cast<uint8_t>(tag));
+    message.push_back(static_cast<uint8_t>(bytes));
+    for (size_t i = bytes; i-- > 0;) {
+        message.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+// Value size of each command record; -1 for tags a command never carries
+int commandLength(ControlTag tag) {
+    switch (tag) {
+        case ControlTag::Seek: return 4;
+        case ControlTag::Pause: return 1;
+        case ControlTag::Rate: return 2;
+        case ControlTag::Loop: return 1;
+        case ControlTag::Keyframe: return 0;
+        case ControlTag::Quality: return 2;
+        case ControlTag::TelemetryInterval: return 2;
+        case ControlTag::Camera: return 1;
+        case ControlTag::ActiveCameras: return 1;
+        default: return -1;
+    }
+}
+
+}  // namespace
+
+bool decodeControlCommand(const uint8_t* data, size_t size, ControlCommand& command) {
+    size_t offset = 0;
+    while (offset < size) {
+        if (size - offset < 2) {
+            return false;
+        }
+        ControlTag tag = static_cast<ControlTag>(data[offset]);
+        size_t length = data[offset + 1];
+        const uint8_t* value = data + offset + 2;
+        offset += 2 + length;
+        if (offset > size) {
+            return false;
+        }
+
+        int expected = commandLength(tag);
+        if (expected < 0) {
+            continue;  // newer client, or a telemetry tag echoed back
+        }
+        if (length != static_cast<size_t>(expected)) {
+            return false;
+        }
+        uint32_t v = readBig(value, length);
+        switch (tag) {
+            case ControlTag::Seek: command.seek_seconds = v / 1000.0; break;
+            case ControlTag::Pause: command.pause = v != 0; break;
+            case ControlTag::Rate: command.rate = v / 100.0; break;
+            case ControlTag::Loop: command.loop = v != 0; break;
+            case ControlTag::Keyframe: command.keyframe = true; break;
+            case ControlTag::Quality: command.quality = static_cast<int>(v); break;
+            case ControlTag::TelemetryInterval: command.telemetry_interval_ms = static_cast<int>(v); break;
+            case ControlTag::Camera: command.camera = v; break;
+            case ControlTag::ActiveCameras: command.active_cameras = v; break;
+            default: break;
+        }
+    }
+    return true;
+}
+
+void encodeControlTelemetry(const ControlTelemetry& telemetry, std::vector<uint8_t>& message) {
+    message.clear();
+    if (telemetry.result) {
+        put(message, ControlTag::Result, static_cast<uint8_t>(*telemetry.result), 1);
+    }
+    put(message, ControlTag::CameraIndex, clampField(static_cast<double>(telemetry.camera), 1), 1);
+    put(message, ControlTag::CamerasActive, telemetry.active_cameras & 0xff, 1);
+    put(message, ControlTag::Position, clampField(telemetry.position * 1000.0, 4), 4);
+    put(message, ControlTag::Duration, clampField(telemetry.duration * 1000.0, 4), 4);
+    put(message, ControlTag::PlaybackRate, clampField(telemetry.rate * 100.0, 2), 2);
+    put(message, ControlTag::Flags, telemetry.flags, 1);
+    put(message, ControlTag::CurrentQuality, clampField(telemetry.quality, 2), 2);
+    put(message, ControlTag::Bitrate, clampField(telemetry.bitrate_kbps, 4), 4);
+    put(message, ControlTag::Rtt, telemetry.rtt_ms < 0.0 ? 0xffff : clampField(telemetry.rtt_ms, 2), 2);
+    put(message, ControlTag::Loss, clampField(telemetry.fraction_lost * 256.0, 1), 1);
+    put(message, ControlTag::Jitter, clampField(telemetry.jitter_ms, 2), 2);
+    put(message, ControlTag::FramesSent, static_cast<uint32_t>(telemetry.frames_sent), 4);
+    put(message, ControlTag::SendBuffer, clampField(static_cast<double>(telemetry.send_buffer_bytes), 4), 4);
+}
+
+ControlCommand controlCommandFromJson(const Json::Value& json) {
+    ControlCommand command;
+    if (json["seek"].isNumeric()) {
+        command.seek_seconds = json["seek"].asDouble();
+    }
+    if (json["pause"].isBool()) {
+        command.pause = json["pause"].asBool();
+    }
+    if (json["rate"].isNumeric()) {
+        command.rate = json["rate"].asDouble();
+    }
+    if (json["loop"].isBool()) {
+        command.loop = json["loop"].asBool();
+    }
+    command.keyframe = json["keyframe"].isBool() && json["keyframe"].asBool();
+    if (json["quality"].isIntegral()) {
+        command.quality = json["quality"].asInt();
+    }
+    if (json["camera"].isUInt()) {
+        command.camera = json["camera"].asUInt();
+    }
+    if (json["cameras"].isArray()) {
+        uint32_t mask = 0;
+        for (const Json::Value& camera : json["cameras"]) {
+            if (camera.isUInt() && camera.asUInt() < kMaxCameras) {
+                mask |= 1u << camera.asUInt();
+            }
+        }
+        command.active_cameras = mask;
+    }
+    return command;
+}
+
+Json::Value toJson(const ControlTelemetry& telemetry) {
+    static const char* const kResults[] = {"ok", "rejected", "unavailable"};
+    Json::Value json;
+    if (telemetry.result) {
+        json["result"] = kResults[static_cast<size_t>(*telemetry.result)];
+    }
+    json["camera"] = static_cast<Json::UInt>(telemetry.camera);
+    Json::Value& cameras = json["cameras"] = Json::Value(Json::arrayValue);
+    for (size_t i = 0; i < kMaxCameras; i++) {
+        if (telemetry.active_cameras & (1u << i)) {
+            cameras.append(static_cast<Json::UInt>(i));
+        }
+    }
+    json["position"] = telemetry.position;
+    json["duration"] = telemetry.duration;
+    json["rate"] = telemetry.rate;
+    json["paused"] = (telemetry.flags & kTelemetryPaused) != 0;
+    json["loop"] = (telemetry.flags & kTelemetryLoop) != 0;
+    json["controllable"] = (telemetry.flags & kTelemetryControllable) != 0;
+    json["quality"] = telemetry.quality;
+    json["bitrate_kbps"] = telemetry.bitrate_kbps;
+    json["rtt_ms"] = telemetry.rtt_ms;
+    json["fraction_lost"] = telemetry.fraction_lost;
+    json["jitter_ms"] = telemetry.jitter_ms;
+    json["frames_sent"] = static_cast<Json::UInt64>(telemetry.frames_sent);
+    return json;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include <json/json.h>
+
+// Wire format of the per-peer "control" DataChannel (negotiated, SCTP stream 1).
+//
+// A message is a sequence of TLV records: a tag byte, a length byte and that
+// many value bytes, integers big-endian. Records with unknown tags are skipped,
+// so either side can add fields without breaking the other. Tags below 0x80
+// are commands from the client, tags from 0x80 up are telemetry from the
+// streamer.
+enum class ControlTag : uint8_t {
+    // Client -> streamer
+    Seek = 0x01,               // u32 milliseconds from the start of the file
+    Pause = 0x02,              // u8: 1 pauses, 0 resumes
+    Rate = 0x03,               // u16 hundredths (100 = real time)
+    Loop = 0x04,               // u8: 1 on, 0 off
+    Keyframe = 0x05,           // empty: send a keyframe as soon as possible
+    Quality = 0x06,            // u16 lines: switch to the file's "_<lines>p" sibling, 0 = original or tallest
+    TelemetryInterval = 0x07,  // u16 milliseconds, 0 stops periodic telemetry
+    Camera = 0x08,             // u8: camera the other records apply to, default 0
+    ActiveCameras = 0x09,      // u8 bitmask: cameras to stream; the others stop, tracks stay negotiated
+
+    // Streamer -> client
+    Result = 0x80,             // u8 ControlResult, only in the reply to a command
+    Position = 0x81,           // u32 milliseconds
+    Duration = 0x82,           // u32 milliseconds
+    PlaybackRate = 0x83,       // u16 hundredths
+    Flags = 0x84,              // u8, kTelemetry* bits
+    CurrentQuality = 0x85,     // u16 lines, 0 = original
+    Bitrate = 0x86,            // u32 kbit/s
+    Rtt = 0x87,                // u16 milliseconds, 0xffff while unknown
+    Loss = 0x88,               // u8 fraction lost in 1/256 (as in RTCP)
+    Jitter = 0x89,             // u16 milliseconds
+    FramesSent = 0x8a,         // u32, wraps
+    SendBuffer = 0x8b,         // u32 bytes queued in the track
+    CameraIndex = 0x8c,        // u8: camera the figures are about
+    CamerasActive = 0x8d,      // u8 bitmask of the cameras being streamed
+};
+
+enum class ControlResult : uint8_t {
+    Ok = 0,
+    Rejected = 1,     // nothing to apply it to, e.g. seeking a live stream or an unknown camera
+    Unavailable = 2,  // e.g. no file for the requested quality
+};
+
+constexpr uint8_t kTelemetryPaused = 0x01;
+constexpr uint8_t kTelemetryLoop = 0x02;
+constexpr uint8_t kTelemetryControllable = 0x04;  // the camera plays a file of its own
+
+// Cameras per session, as many as an ActiveCameras mask can name
+constexpr size_t kMaxCameras = 8;
+
+// One control message; any combination of fields may be set
+struct ControlCommand {
+    std::optional<double> seek_seconds;
+    std::optional<bool> pause;
+    std::optional<double> rate;
+    std::optional<bool> loop;
+    bool keyframe = false;
+    std::optional<int> quality;
+    std::optional<int> telemetry_interval_ms;
+    std::optional<size_t> camera;
+    std::optional<uint32_t> active_cameras;
+};
+
+// What the streamer reports about one camera of a peer, periodically and after each command
+struct ControlTelemetry {
+    std::optional<ControlResult> result;
+    size_t camera = 0;
+    uint32_t active_cameras = 0;
+    double position = 0.0;   // seconds
+    double duration = 0.0;
+    double rate = 1.0;
+    uint8_t flags = 0;
+    int quality = 0;
+    double bitrate_kbps = 0.0;
+    double rtt_ms = -1.0;    // negative while unknown
+    double fraction_lost = 0.0;
+    double jitter_ms = 0.0;
+    uint64_t frames_sent = 0;
+    uint64_t send_buffer_bytes = 0;
+};
+
+// False if the message is truncated or a known record has the wrong length
+bool decodeControlCommand(const uint8_t* data, size_t size, ControlCommand& command);
+void encodeControlTelemetry(const ControlTelemetry& telemetry, std::vector<uint8_t>& message);
+
+// The same command as JSON, for the MQTT control topic:
+// {"camera": 1, "seek": 12.5, "pause": true, "rate": 2, "loop": true, "keyframe": true,
+//  "quality": 480, "cameras": [0, 1]}
+ControlCommand controlCommandFromJson(const Json::Value& json);
+Json::Value toJson(const ControlTelemetry& telemetry);
@@ -20,7 +20,7 @@ echo "✅ Executable found: ./mqtt_client"
 echo ""
 echo "🔍 Checking embedded video files..."
 echo "Contents of /workspace/videos:"
-ls -lh /workspace/videos/*.mp4 2>/dev/null || echo "No video files found"
+ls -lh /workspace/videos/*.mp4 /workspace/videos/*.h264 2>/dev/null | grep . || echo "No video files found"
 echo ""
 
 echo ""
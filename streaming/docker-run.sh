@@ -29,6 +29,17 @@ docker run \
     --network host \
     --platform linux/$(uname -m | sed 's/x86_64/amd64/') \
     --name mqtt-streaming-client \
+    -e SEI_TIMESTAMP=${SEI_TIMESTAMP:-off} \
+    -e H264_BITRATE_KBPS=${H264_BITRATE_KBPS:-1000} \
+    -e H264_GOP=${H264_GOP:-60} \
+    -e STREAM_BROADCAST=${STREAM_BROADCAST:-0} \
+    -e STREAM_SCHEDULER_THREADS=${STREAM_SCHEDULER_THREADS:-0} \
+    -e TRICKLE_ICE=${TRICKLE_ICE:-0} \
+    -e LOG_LEVEL=${LOG_LEVEL:-info} \
+    -e LOG_FORMAT=${LOG_FORMAT:-text} \
+    -e METRICS_PORT=${METRICS_PORT:-9102} \
+    -e STREAM_LOOP=${STREAM_LOOP:-0} \
+    -e STREAM_FAST_START=${STREAM_FAST_START:-keyframe} \
     mqtt-streaming:latest
 
 if [ $? -eq 0 ]; then
@@ -0,0 +1,145 @@
+#include "frame_prefetcher.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include <opencv2/imgcodecs.hpp>
+
+DecodePool::DecodePool(size_t threads) {
+    for (size_t i = 0; i < threads; i++) {
+        threads_.emplace_back([this]() { run(); });
+    }
+}
+
+DecodePool::~DecodePool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+size_t DecodePool::defaultThreadCount() {
+    return std::max<size_t>(2, std::thread::hardware_concurrency() / 2);
+}
+
+void DecodePool::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back(std::move(job));
+    }
+    wake_.notify_one();
+}
+
+size_t DecodePool::queueDepth() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return jobs_.size();
+}
+
+void DecodePool::run() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+            if (jobs_.empty()) {
+                return;  // stopping and drained
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        job();
+    }
+}
+
+FramePrefetcher::FramePrefetcher(std::vector<std::string> files, DecodePool& pool, size_t depth)
+    : files_(std::move(files)), pool_(pool), slots_(std::max<size_t>(depth, 1)) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    refill();
+}
+
+FramePrefetcher::~FramePrefetcher() {
+    // Queued jobs still reference this ring; let them finish (cancelled ones skip the decode)
+    std::unique_lock<std::mutex> lock(mutex_);
+    cancelled_ = true;
+    ready_.wait(lock, [this]() { return in_flight_ == 0; });
+}
+
+void FramePrefetcher::refill() {
+    while (!cancelled_ && next_submit_ < files_.size() && next_submit_ - next_pop_ < slots_.size()) {
+        size_t index = next_submit_++;
+        in_flight_++;
+        pool_.submit([this, index]() { decode(index); });
+    }
+}
+
+void FramePrefetcher::decode(size_t index) {
+    bool skip;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        skip = cancelled_;
+    }
+
+    cv::Mat image;
+    if (!skip) {
+        image = cv::imread(files_[index], cv::IMREAD_COLOR);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Slot& slot = slots_[index % slots_.size()];
+        slot.image = image;
+        slot.ready = true;
+        in_flight_--;
+        // Notified under the lock: once in_flight_ hits 0 the destructor may free ready_
+        ready_.notify_all();
+    }
+}
+
+FramePrefetcher::PopResult FramePrefetcher::tryPop(PrefetchedFrame& frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (next_pop_ < files_.size()) {
+        Slot& slot = slots_[next_pop_ % slots_.size()];
+        if (!slot.ready) {
+            if (!waiting_) {
+                stats_.underruns++;
+                waiting_ = true;
+                wait_start_ = std::chrono::steady_clock::now();
+            }
+            return PopResult::Pending;
+        }
+        if (waiting_) {
+            stats_.wait_ms += std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - wait_start_).count();
+            waiting_ = false;
+        }
+
+        size_t index = next_pop_++;
+        cv::Mat image = std::move(slot.image);
+        slot.image = cv::Mat();
+        slot.ready = false;
+        refill();
+
+        if (image.empty()) {
+            stats_.failed++;
+            std::cout << "⚠️  Failed to load image: " << files_[index] << std::endl;
+            continue;
+        }
+
+        stats_.frames++;
+        frame.index = index;
+        frame.path = files_[index];
+        frame.image = std::move(image);
+        return PopResult::Frame;
+    }
+    return PopResult::End;
+}
+
+PrefetchStats FramePrefetcher::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+// Small fixed pool of image decode threads shared by every image stream
+class DecodePool {
+public:
+    explicit DecodePool(size_t threads = defaultThreadCount());
+    ~DecodePool();
+
+    DecodePool(const DecodePool&) = delete;
+    DecodePool& operator=(const DecodePool&) = delete;
+
+    void submit(std::function<void()> job);
+
+    // Jobs waiting for a thread
+    size_t queueDepth();
+
+    // Half the cores, at least 2: decoding must not starve the encoders
+    static size_t defaultThreadCount();
+
+private:
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::function<void()>> jobs_;
+    std::vector<std::thread> threads_;
+    bool stopping_ = false;
+
+    void run();
+};
+
+struct PrefetchedFrame {
+    size_t index = 0;  // position in the file list
+    std::string path;
+    cv::Mat image;
+};
+
+struct PrefetchStats {
+    uint64_t frames = 0;     // frames handed to the sender
+    uint64_t underruns = 0;  // pops that had to wait for a decode
+    uint64_t failed = 0;     // files that could not be decoded
+    double wait_ms = 0.0;    // total time the sender spent waiting
+};
+
+// Bounded ring of decoded frames kept ahead of one image stream.
+//
+// Up to `depth` files are decoded on the shared pool in parallel; the sender
+// pops them strictly in file order without blocking. A frame that is not
+// decoded by the time the sender wants it is an underrun: storage or CPU is
+// not keeping up with the stream.
+class FramePrefetcher {
+public:
+    FramePrefetcher(std::vector<std::string> files, DecodePool& pool, size_t depth = 8);
+    ~FramePrefetcher();
+
+    FramePrefetcher(const FramePrefetcher&) = delete;
+    FramePrefetcher& operator=(const FramePrefetcher&) = delete;
+
+    enum class PopResult { Frame, Pending, End };
+
+    // Next decodable frame in order, Pending if it is still being decoded
+    // (retry shortly), End once the list is exhausted
+    PopResult tryPop(PrefetchedFrame& frame);
+
+    PrefetchStats stats() const;
+
+private:
+    struct Slot {
+        bool ready = false;
+        cv::Mat image;
+    };
+
+    const std::vector<std::string> files_;
+    DecodePool& pool_;
+    std::vector<Slot> slots_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;
+    size_t next_submit_ = 0;
+    size_t next_pop_ = 0;
+    size_t in_flight_ = 0;
+    bool cancelled_ = false;
+    bool waiting_ = false;  // the sender found next_pop_ undecoded
+    std::chrono::steady_clock::time_point wait_start_;
+    PrefetchStats stats_;
+
+    void refill();  // with mutex_ held
+    void decode(size_t index);
+};
@@ -0,0 +1,155 @@
+#include "h264_encoder.hpp"
+
+#include <cstdlib>
+#include <iostream>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/opt.h>
+#include <libswscale/swscale.h>
+}
+
+#include "annexb.hpp"
+
+namespace {
+
+int envInt(const char* name, int fallback) {
+    const char* value = std::getenv(name);
+    if (!value) {
+        return fallback;
+    }
+    int parsed = std::atoi(value);
+    return parsed > 0 ? parsed : fallback;
+}
+
+}  // namespace
+
+H264EncoderConfig H264EncoderConfig::fromEnvironment() {
+    H264EncoderConfig config;
+    config.bitrate_kbps = envInt("H264_BITRATE_KBPS", config.bitrate_kbps);
+    config.gop = envInt("H264_GOP", config.gop);
+    return config;
+}
+
+H264Encoder::H264Encoder(const H264EncoderConfig& config) : config_(config) {}
+
+H264Encoder::~H264Encoder() {
+    sws_freeContext(scaler_);
+    av_packet_free(&packet_);
+    av_frame_free(&frame_);
+    avcodec_free_context(&context_);
+}
+
+bool H264Encoder::open() {
+    const AVCodec* codec = avcodec_find_encoder_by_name("libx264");
+    if (!codec) {
+        std::cerr << "❌ libx264 encoder not available in libavcodec" << std::endl;
+        return false;
+    }
+
+    context_ = avcodec_alloc_context3(codec);
+    frame_ = av_frame_alloc();
+    packet_ = av_packet_alloc();
+    if (!context_ || !frame_ || !packet_) {
+        std::cerr << "❌ Failed to allocate H.264 encoder" << std::endl;
+        return false;
+    }
+
+    context_->width = config_.width;
+    context_->height = config_.height;
+    context_->pix_fmt = AV_PIX_FMT_YUV420P;
+    context_->time_base = AVRational{1, config_.fps};
+    context_->framerate = AVRational{config_.fps, 1};
+    context_->bit_rate = static_cast<int64_t>(config_.bitrate_kbps) * 1000;
+    context_->rc_max_rate = context_->bit_rate;
+    context_->rc_buffer_size = static_cast<int>(context_->bit_rate / config_.fps * 2);  // ~2 frames of VBV
+    context_->gop_size = config_.gop;
+    context_->max_b_frames = 0;
+    // No AV_CODEC_FLAG_GLOBAL_HEADER: SPS/PPS are repeated in-band before every IDR
+
+    av_opt_set(context_->priv_data, "preset", "ultrafast", 0);
+    av_opt_set(context_->priv_data, "tune", "zerolatency", 0);
+    av_opt_set(context_->priv_data, "profile", "baseline", 0);  // matches profile-level-id 42e01f
+    av_opt_set(context_->priv_data, "forced-idr", "1", 0);  // pict_type I means IDR, not just I
+
+    int ret = avcodec_open2(context_, codec, nullptr);
+    if (ret < 0) {
+        std::cerr << "❌ Failed to open libx264 (" << ret << ")" << std::endl;
+        return false;
+    }
+
+    frame_->format = context_->pix_fmt;
+    frame_->width = context_->width;
+    frame_->height = context_->height;
+    if (av_frame_get_buffer(frame_, 0) < 0) {
+        std::cerr << "❌ Failed to allocate encoder picture" << std::endl;
+        return false;
+    }
+
+    std::cout << "🎛️  H.264 encoder ready: " << config_.width << "x" << config_.height << " @ " << config_.fps
+              << " fps, " << config_.bitrate_kbps << " kbps, GOP " << config_.gop << std::endl;
+    return true;
+}
+
+bool H264Encoder::convert(const cv::Mat& image) {
+    AVPixelFormat src_format;
+    if (image.type() == CV_8UC3) {
+        src_format = AV_PIX_FMT_BGR24;
+    } else if (image.type() == CV_8UC1) {
+        src_format = AV_PIX_FMT_GRAY8;
+    } else {
+        std::cerr << "❌ Unsupported frame type for H.264 encoding: " << image.type() << std::endl;
+        return false;
+    }
+
+    // Cached: only rebuilt if the input geometry or format changes
+    scaler_ = sws_getCachedContext(scaler_, image.cols, image.rows, src_format,
+                                   config_.width, config_.height, AV_PIX_FMT_YUV420P,
+                                   SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!scaler_) {
+        std::cerr << "❌ Failed to create frame scaler" << std::endl;
+        return false;
+    }
+
+    // The encoder may still reference the previous picture
+    if (av_frame_make_writable(frame_) < 0) {
+        return false;
+    }
+
+    const uint8_t* src_data[1] = {image.data};
+    const int src_stride[1] = {static_cast<int>(image.step[0])};
+    sws_scale(scaler_, src_data, src_stride, 0, image.rows, frame_->data, frame_->linesize);
+    return true;
+}
+
+bool H264Encoder::encode(const cv::Mat& image, int64_t pts, AccessUnit& au) {
+    if (!context_ || image.empty() || !convert(image)) {
+        return false;
+    }
+
+    frame_->pts = pts;
+    frame_->pict_type = keyframe_requested_.exchange(false) ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+
+    av_packet_unref(packet_);  // releases the previous access unit's bytes
+    if (avcodec_send_frame(context_, frame_) < 0) {
+        std::cerr << "❌ Failed to submit frame " << pts << " to the encoder" << std::endl;
+        return false;
+    }
+    int ret = avcodec_receive_packet(context_, packet_);
+    if (ret < 0) {
+        // zerolatency has no lookahead, so EAGAIN only happens on misconfiguration
+        if (ret != AVERROR(EAGAIN)) {
+            std::cerr << "❌ Encoder error on frame " << pts << " (" << ret << ")" << std::endl;
+        }
+        return false;
+    }
+
+    au.nal_units.clear();
+    annexb::splitNalUnits(packet_->data, static_cast<size_t>(packet_->size), au.nal_units);
+
+    au.index = static_cast<size_t>(pts);
+    au.dts = packet_->dts;
+    au.pts = packet_->pts;
+    au.keyframe = (packet_->flags & AV_PKT_FLAG_KEY) != 0;
+    return !au.nal_units.empty();
+}
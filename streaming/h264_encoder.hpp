@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+#include "access_unit.hpp"
+
+struct AVCodecContext;
+struct AVFrame;
+struct AVPacket;
+struct SwsContext;
+
+// Settings of one live encoder session. Defaults suit the 640x480 robot
+// camera preview; H264_BITRATE_KBPS and H264_GOP override them.
+struct H264EncoderConfig {
+    int width = 640;
+    int height = 480;
+    int fps = 30;
+    int bitrate_kbps = 1000;
+    int gop = 60;  // frames between IDRs; a PLI forces one sooner
+
+    static H264EncoderConfig fromEnvironment();
+};
+
+// In-process low-latency H.264 encoder (libavcodec + libx264): ultrafast
+// preset, zerolatency tune, constrained baseline, no B-frames, so every
+// input frame comes straight back out as one Annex-B access unit with
+// in-band SPS/PPS on each IDR.
+//
+// The YUV picture and the scaler are allocated once and reused; input frames
+// of any size or channel count are converted into them.
+class H264Encoder {
+public:
+    explicit H264Encoder(const H264EncoderConfig& config);
+    ~H264Encoder();
+
+    H264Encoder(const H264Encoder&) = delete;
+    H264Encoder& operator=(const H264Encoder&) = delete;
+
+    // False if libx264 is unavailable or rejects the configuration
+    bool open();
+
+    // Encodes one 8-bit BGR or grayscale frame. On success au holds views into
+    // the encoder's output, valid until the next encode() call; pts is in
+    // frames and is used for au.dts/au.pts.
+    bool encode(const cv::Mat& image, int64_t pts, AccessUnit& au);
+
+    // Makes the next encoded frame an IDR (thread-safe, e.g. from a PLI)
+    void requestKeyframe() { keyframe_requested_ = true; }
+
+    const H264EncoderConfig& config() const { return config_; }
+
+private:
+    H264EncoderConfig config_;
+    AVCodecContext* context_ = nullptr;
+    AVFrame* frame_ = nullptr;
+    AVPacket* packet_ = nullptr;
+    SwsContext* scaler_ = nullptr;
+    std::atomic<bool> keyframe_requested_{false};
+
+    bool convert(const cv::Mat& image);
+};
@@ -0,0 +1,241 @@
+#include "media_source.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "❌ Failed to open video file: " << path << std::endl;
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        std::cerr << "❌ Empty or unreadable video file: " << path << std::endl;
+        ::close(fd);
+        return nullptr;
+    }
+
+    void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        std::cerr << "❌ Failed to map video file: " << path << std::endl;
+        return nullptr;
+    }
+
+    std::shared_ptr<MappedFile> file(new MappedFile());
+    file->data_ = static_cast<const uint8_t*>(addr);
+    file->size_ = static_cast<size_t>(st.st_size);
+    return file;
+}
+
+MappedFile::~MappedFile() {
+    if (data_) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+}
+
+std::shared_ptr<const MediaSource> MediaSource::load(const std::string& path) {
+    auto file = MappedFile::open(path);
+    if (!file) {
+        return nullptr;
+    }
+
+    auto source = std::make_shared<MediaSource>();
+    source->path_ = path;
+    source->file_ = file;
+
+    if (Mp4Demuxer::looksLikeMp4(file->data(), file->size())) {
+        source->format_ = Format::Mp4;
+        if (!source->demuxer_.parse(file->data(), file->size()) || source->demuxer_.sampleCount() == 0) {
+            std::cerr << "❌ Failed to demux MP4 file: " << path << std::endl;
+            return nullptr;
+        }
+    } else {
+        source->format_ = Format::AnnexB;
+        annexb::splitNalUnits(file->data(), file->size(), source->annexb_nals_);
+        if (source->annexb_nals_.empty()) {
+            std::cerr << "⚠️  No NAL units found in video file: " << path << std::endl;
+            return nullptr;
+        }
+
+        AccessUnitGrouper grouper;
+        for (size_t i = 0; i < source->annexb_nals_.size(); i++) {
+            if (i == 0 || grouper.startsNewAccessUnit(source->annexb_nals_[i])) {
+                source->annexb_units_.push_back(i);
+            }
+        }
+    }
+
+    source->buildKeyframeIndex();
+
+    std::cout << "📁 Mapped video file " << path << " (" << file->size() << " bytes, "
+              << source->unitCount() << " access units, " << source->keyframes_.size()
+              << " keyframes)" << std::endl;
+    return source;
+}
+
+void MediaSource::buildKeyframeIndex() {
+    if (format_ == Format::Mp4) {
+        // From the sample table (stss); no sample data is touched
+        const auto& samples = demuxer_.samples();
+        for (size_t i = 0; i < samples.size(); i++) {
+            if (samples[i].keyframe) {
+                keyframes_.push_back(i);
+            }
+        }
+        return;
+    }
+    for (size_t unit = 0; unit < annexb_units_.size(); unit++) {
+        size_t last = unit + 1 < annexb_units_.size() ? annexb_units_[unit + 1] : annexb_nals_.size();
+        for (size_t i = annexb_units_[unit]; i < last; i++) {
+            if (annexb_nals_[i].type() == 5) {
+                keyframes_.push_back(unit);
+                break;
+            }
+        }
+    }
+}
+
+size_t MediaSource::unitCount() const {
+    return format_ == Format::Mp4 ? demuxer_.sampleCount() : annexb_units_.size();
+}
+
+uint32_t MediaSource::timescale() const {
+    return format_ == Format::Mp4 ? demuxer_.timescale() : kAnnexBTimescale;
+}
+
+bool MediaSource::accessUnit(size_t index, AccessUnit& au) const {
+    if (format_ == Format::Mp4) {
+        return demuxer_.readAccessUnit(index, au);
+    }
+
+    if (index >= annexb_units_.size()) {
+        return false;
+    }
+    size_t first = annexb_units_[index];
+    size_t last = index + 1 < annexb_units_.size() ? annexb_units_[index + 1] : annexb_nals_.size();
+
+    au.index = index;
+    au.dts = static_cast<int64_t>(index) * kAnnexBFrameTicks;
+    au.pts = au.dts;
+    au.keyframe = false;
+    au.nal_units.assign(annexb_nals_.begin() + first, annexb_nals_.begin() + last);
+    for (const auto& nal : au.nal_units) {
+        au.keyframe = au.keyframe || nal.type() == 5;
+    }
+    return true;
+}
+
+int64_t MediaSource::unitDts(size_t index) const {
+    if (format_ == Format::Mp4) {
+        const auto& samples = demuxer_.samples();
+        return index < samples.size() ? samples[index].dts : 0;
+    }
+    return static_cast<int64_t>(index) * kAnnexBFrameTicks;
+}
+
+size_t MediaSource::keyframeAtOrBefore(size_t index) const {
+    auto it = std::upper_bound(keyframes_.begin(), keyframes_.end(), index);
+    return it == keyframes_.begin() ? 0 : *(it - 1);
+}
+
+size_t MediaSource::keyframeAtOrAfter(size_t index) const {
+    auto it = std::lower_bound(keyframes_.begin(), keyframes_.end(), index);
+    return it == keyframes_.end() ? unitCount() : *it;
+}
+
+size_t MediaSource::unitAtTime(double seconds) const {
+    size_t count = unitCount();
+    if (count == 0) {
+        return 0;
+    }
+    int64_t target = unitDts(0) + static_cast<int64_t>(seconds * timescale());
+    // DTS is non-decreasing in decode order
+    size_t lo = 0;
+    size_t hi = count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (unitDts(mid) <= target) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+double MediaSource::frameInterval() const {
+    size_t count = unitCount();
+    if (count < 2) {
+        return 1.0 / 30.0;
+    }
+    return toSeconds(unitDts(count - 1) - unitDts(0)) / (count - 1);
+}
+
+double MediaSource::duration() const {
+    size_t count = unitCount();
+    return count ? toSeconds(unitDts(count - 1) - unitDts(0)) + frameInterval() : 0.0;
+}
+
+std::shared_ptr<const MediaSource> MediaSourceCache::acquire(const std::string& path) {
+    std::promise<std::shared_ptr<const MediaSource>> promise;
+    std::shared_future<std::shared_ptr<const MediaSource>> loading;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry& entry = sources_[path];
+        if (auto source = entry.source.lock()) {
+            std::cout << "♻️  Reusing mapped video file " << path << std::endl;
+            return source;
+        }
+        if (entry.loading.valid()) {
+            loading = entry.loading;
+        } else {
+            // This caller loads it; others asking meanwhile wait on the future
+            entry.loading = promise.get_future().share();
+        }
+    }
+    if (loading.valid()) {
+        return loading.get();
+    }
+
+    std::shared_ptr<const MediaSource> source;
+    try {
+        source = MediaSource::load(path);
+    } catch (...) {
+        source = nullptr;
+        std::cerr << "❌ Failed to load video file: " << path << std::endl;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry& entry = sources_[path];
+        entry.source = source;
+        entry.loading = {};
+        if (!source) {
+            sources_.erase(path);
+        }
+    }
+    promise.set_value(source);
+    return source;
+}
+
+size_t MediaSourceCache::activeSources() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t active = 0;
+    for (auto it = sources_.begin(); it != sources_.end();) {
+        if (it->second.loading.valid()) {
+            ++it;  // not mapped yet
+        } else if (it->second.source.expired()) {
+            it = sources_.erase(it);
+        } else {
+            active++;
+            ++it;
+        }
+    }
+    return active;
+}
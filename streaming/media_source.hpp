@@ -0,0 +1,142 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+#include "access_unit.hpp"
+#include "mp4_demuxer.hpp"
+
+// Read-only mmap of a whole file. Pages are faulted in on access and shared
+// by every reader through the page cache.
+class MappedFile {
+public:
+    static std::shared_ptr<MappedFile> open(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    MappedFile() = default;
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// A video file mapped and indexed once. MP4 files are indexed through their
+// sample tables; raw Annex-B files through a start-code scan whose NAL units are
+// grouped into access units. A keyframe (GOP) index built at load time lets
+// players seek to the sync sample in front of any time. Immutable after
+// load(), so any number of cursors can read it at once.
+class MediaSource {
+public:
+    enum class Format { Mp4, AnnexB };
+
+    static std::shared_ptr<const MediaSource> load(const std::string& path);
+
+    const std::string& path() const { return path_; }
+    Format format() const { return format_; }
+    size_t unitCount() const;
+    uint32_t timescale() const;
+    size_t mappedBytes() const { return file_->size(); }
+
+    double toSeconds(int64_t ticks) const {
+        return static_cast<double>(ticks) / timescale();
+    }
+
+    // Fills au with views into the mapped file; no sample data is copied
+    bool accessUnit(size_t index, AccessUnit& au) const;
+
+    // Decode time of a unit, in timescale ticks
+    int64_t unitDts(size_t index) const;
+
+    // Units a decoder can start from (IDR / MP4 sync samples), ascending
+    const std::vector<size_t>& keyframes() const { return keyframes_; }
+
+    // Last keyframe at or before index; 0 if there is none
+    size_t keyframeAtOrBefore(size_t index) const;
+    // First keyframe at or after index; unitCount() if there is none
+    size_t keyframeAtOrAfter(size_t index) const;
+
+    // Last unit whose DTS is at or before `seconds` from the first unit
+    size_t unitAtTime(double seconds) const;
+
+    // Average spacing of units, and the playing time of the whole file
+    double frameInterval() const;
+    double duration() const;
+
+private:
+    // Annex-B input carries no timestamps; access units are spaced at 30 fps
+    static constexpr uint32_t kAnnexBTimescale = 90000;
+    static constexpr int64_t kAnnexBFrameTicks = 3000;
+
+    std::string path_;
+    Format format_ = Format::AnnexB;
+    std::shared_ptr<MappedFile> file_;
+    Mp4Demuxer demuxer_;
+    std::vector<NalView> annexb_nals_;
+    std::vector<size_t> annexb_units_;  // index of the first NAL of each access unit
+    std::vector<size_t> keyframes_;
+
+    void buildKeyframeIndex();
+};
+
+// Per-peer read position in a shared MediaSource. Copying a cursor copies a
+// pointer and an index, never media data.
+class MediaCursor {
+public:
+    explicit MediaCursor(std::shared_ptr<const MediaSource> source)
+        : source_(std::move(source)) {}
+
+    // Reads the next access unit; false at the end of the source
+    bool next(AccessUnit& au) {
+        while (position_ < source_->unitCount()) {
+            if (source_->accessUnit(position_++, au)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool atEnd() const { return position_ >= source_->unitCount(); }
+    size_t position() const { return position_; }
+    void seek(size_t index) { position_ = index; }
+    const MediaSource& source() const { return *source_; }
+
+private:
+    std::shared_ptr<const MediaSource> source_;
+    size_t position_ = 0;
+};
+
+// Maps each file at most once while any peer still streams it. Entries are
+// weak, so a file is unmapped as soon as its last cursor goes away.
+//
+// Files are mapped and indexed outside the lock: a caller asking for a file
+// that is still loading waits for that load, callers asking for other files
+// do not wait at all.
+class MediaSourceCache {
+public:
+    // Blocks while the file is mapped and indexed; null if it cannot be loaded
+    std::shared_ptr<const MediaSource> acquire(const std::string& path);
+
+    // Sources that are currently mapped (for logging)
+    size_t activeSources();
+
+private:
+    struct Entry {
+        std::weak_ptr<const MediaSource> source;
+        std::shared_future<std::shared_ptr<const MediaSource>> loading;  // valid while a load runs
+    };
+
+    std::mutex mutex_;
+    std::map<std::string, Entry> sources_;
+};
@@ -0,0 +1,353 @@
+#include "metrics_server.hpp"
+
+#include <cstdlib>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <unistd.h>
+
+#include "mongoose.h"
+
+namespace {
+
+constexpr int kPollMillis = 100;
+constexpr const char* kDefaultPort = "9102";
+
+// Prometheus label value: backslash, quote and newline are escaped
+std::string labelValue(const std::string& value) {
+    std::string out;
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            out += '\\';
+            out += c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+// One metric family: "# HELP", "# TYPE", then a sample per peer
+class PrometheusWriter {
+public:
+    void family(const char* name, const char* type, const char* help) {
+        out_ << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+        name_ = name;
+    }
+
+    // suffix is appended to the family name, e.g. "_sum" for a summary
+    void sample(double value, const std::string& labels = "", const char* suffix = "") {
+        out_ << name_ << suffix;
+        if (!labels.empty()) {
+            out_ << "{" << labels << "}";
+        }
+        out_ << " ";
+        // Counters as exact integers, everything else at full precision, so
+        // rate() never sees the steps of a 6-digit "1.23457e+06"
+        if (value == std::floor(value) && std::fabs(value) < 9007199254740992.0) {
+            out_ << static_cast<int64_t>(value);
+        } else {
+            out_ << std::setprecision(std::numeric_limits<double>::max_digits10) << value;
+        }
+        out_ << "\n";
+    }
+
+    template <typename Fn>
+    void perPeer(const char* name, const char* type, const char* help,
+                 const std::vector<PeerMetrics>& peers, Fn value) {
+        family(name, type, help);
+        for (const PeerMetrics& peer : peers) {
+            sample(value(peer), peerLabel(peer));
+        }
+    }
+
+    static std::string peerLabel(const PeerMetrics& peer) {
+        return "peer=\"" + labelValue(peer.peer_id) + "\",camera=\"" + labelValue(peer.camera) + "\"";
+    }
+
+    std::string str() const { return out_.str(); }
+
+private:
+    std::ostringstream out_;
+    const char* name_ = "";
+};
+
+Json::Value pacingJson(const PacingStats& stats) {
+    Json::Value pacing;
+    pacing["units"] = Json::UInt64(stats.units);
+    pacing["rebases"] = Json::UInt64(stats.rebases);
+    pacing["mean_late_ms"] = stats.mean_late_ms;
+    pacing["p50_late_ms"] = stats.p50_late_ms;
+    pacing["p95_late_ms"] = stats.p95_late_ms;
+    pacing["p99_late_ms"] = stats.p99_late_ms;
+    pacing["max_late_ms"] = stats.max_late_ms;
+    return pacing;
+}
+
+}  // namespace
+
+ProcessMetrics readProcessMetrics() {
+    ProcessMetrics metrics;
+    const double ticks = static_cast<double>(sysconf(_SC_CLK_TCK));
+
+    // Fields after the parenthesised command name, which may contain spaces
+    std::ifstream stat("/proc/self/stat");
+    std::string line;
+    if (std::getline(stat, line)) {
+        size_t close = line.rfind(')');
+        if (close != std::string::npos) {
+            std::istringstream fields(line.substr(close + 2));
+            std::vector<std::string> values;
+            std::string value;
+            while (fields >> value) {
+                values.push_back(value);
+            }
+            // values[0] is field 3 (state): utime 14, stime 15, num_threads 20, starttime 22
+            if (values.size() > 19) {
+                metrics.cpu_seconds = (std::stod(values[11]) + std::stod(values[12])) / ticks;
+                metrics.threads = std::stoull(values[17]);
+                double system_uptime = 0.0;
+                std::ifstream uptime("/proc/uptime");
+                if (uptime >> system_uptime) {
+                    metrics.uptime_seconds = system_uptime - std::stod(values[19]) / ticks;
+                }
+            }
+        }
+    }
+
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size_pages = 0;
+    uint64_t resident_pages = 0;
+    if (statm >> size_pages >> resident_pages) {
+        metrics.rss_bytes = resident_pages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    }
+    return metrics;
+}
+
+MetricsServer::MetricsServer(Collector collect) : collect_(std::move(collect)) {}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+std::string MetricsServer::defaultListenUrl() {
+    const char* env = std::getenv("METRICS_PORT");
+    std::string port = env && *env ? env : kDefaultPort;
+    if (port == "0") {
+        return "";
+    }
+    return "http://0.0.0.0:" + port;
+}
+
+bool MetricsServer::start(const std::string& listen_url) {
+    if (running_) {
+        return true;
+    }
+    mg_log_set(MG_LL_ERROR);
+    auto mgr = std::make_shared<mg_mgr>();
+    mg_mgr_init(mgr.get());
+    if (!mg_http_listen(mgr.get(), listen_url.c_str(), handleEvent, this)) {
+        std::cerr << "❌ Metrics endpoint could not listen on " << listen_url << std::endl;
+        mg_mgr_free(mgr.get());
+        return false;
+    }
+
+    running_ = true;
+    thread_ = std::thread([this, mgr]() {
+        while (running_) {
+            mg_mgr_poll(mgr.get(), kPollMillis);
+        }
+        mg_mgr_free(mgr.get());
+    });
+    std::cout << "📈 Metrics on " << listen_url << "/metrics and /stats.json" << std::endl;
+    return true;
+}
+
+void MetricsServer::stop() {
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void MetricsServer::handleEvent(mg_connection* c, int ev, void* ev_data) {
+    if (ev != MG_EV_HTTP_MSG) {
+        return;
+    }
+    auto* server = static_cast<MetricsServer*>(c->fn_data);
+    auto* hm = static_cast<mg_http_message*>(ev_data);
+    if (mg_match(hm->uri, mg_str("/metrics"), nullptr)) {
+        server->handleRequest(c, true);
+    } else if (mg_match(hm->uri, mg_str("/stats.json"), nullptr)) {
+        server->handleRequest(c, false);
+    } else {
+        mg_http_reply(c, 404, "Content-Type: text/plain\r\n", "Try /metrics or /stats.json\n");
+    }
+}
+
+void MetricsServer::handleRequest(mg_connection* c, bool prometheus) {
+    StreamingMetrics metrics;
+    if (collect_) {
+        metrics = collect_();
+    }
+    ProcessMetrics process = readProcessMetrics();
+    double wall = process.uptime_seconds - last_uptime_seconds_;
+    if (last_uptime_seconds_ > 0.0 && wall > 0.0) {
+        process.cpu_percent = (process.cpu_seconds - last_cpu_seconds_) * 100.0 / wall;
+    }
+    last_cpu_seconds_ = process.cpu_seconds;
+    last_uptime_seconds_ = process.uptime_seconds;
+
+    if (prometheus) {
+        std::string body = toPrometheus(metrics, process);
+        mg_http_reply(c, 200, "Content-Type: text/plain; version=0.0.4\r\n", "%s", body.c_str());
+    } else {
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "  ";
+        builder["precision"] = 6;
+        std::string body = Json::writeString(builder, toJson(metrics, process)) + "\n";
+        mg_http_reply(c, 200, "Content-Type: application/json\r\n", "%s", body.c_str());
+    }
+}
+
+std::string MetricsServer::toPrometheus(const StreamingMetrics& metrics, const ProcessMetrics& process) {
+    const std::vector<PeerMetrics>& peers = metrics.peers;
+    PrometheusWriter w;
+
+    // One entry per camera track; a session with several cameras has several
+    std::set<std::string> sessions;
+    for (const PeerMetrics& p : peers) {
+        sessions.insert(p.peer_id);
+    }
+    w.family("webrtc_peers", "gauge", "Peer sessions in the registry");
+    w.sample(static_cast<double>(sessions.size()));
+    w.perPeer("webrtc_peer_connected", "gauge", "1 while the peer connection is connected", peers,
+              [](const PeerMetrics& p) { return p.state == "connected" ? 1.0 : 0.0; });
+    w.perPeer("webrtc_peer_camera_active", "gauge", "1 while the client has the camera switched on", peers,
+              [](const PeerMetrics& p) { return p.active ? 1.0 : 0.0; });
+    w.perPeer("webrtc_peer_bitrate_kbps", "gauge", "RTP send rate over the last second", peers,
+              [](const PeerMetrics& p) { return p.bitrate_kbps; });
+    w.perPeer("webrtc_peer_frames_sent_total", "counter", "Access units sent", peers,
+              [](const PeerMetrics& p) { return static_cast<double>(p.frames_sent); });
+    w.perPeer("webrtc_peer_send_failures_total", "counter", "Access units the track refused", peers,
+              [](const PeerMetrics& p) { return static_cast<double>(p.send_failures); });
+    w.perPeer("webrtc_peer_rtp_packets_total", "counter", "RTP packets sent", peers,
+              [](const PeerMetrics& p) { return static_cast<double>(p.rtp_packets); });
+    w.perPeer("webrtc_peer_rtp_bytes_total", "counter", "RTP bytes sent, headers included", peers,
+              [](const PeerMetrics& p) { return static_cast<double>(p.rtp_bytes); });
+    w.perPeer("webrtc_peer_send_buffer_bytes", "gauge", "Bytes queued in the track", peers,
+              [](const PeerMetrics& p) { return static_cast<double>(p.send_buffer_bytes); });
+
+    w.family("webrtc_peer_pacing_late_ms", "summary", "Send-time lateness of the peer's own stream");
+    for (const PeerMetrics& p : peers) {
+        if (!p.has_pacing) {
+            continue;
+        }
+        std::string label = PrometheusWriter::peerLabel(p);
+        w.sample(p.pacing.p50_late_ms, label + ",quantile=\"0.5\"");
+        w.sample(p.pacing.p95_late_ms, label + ",quantile=\"0.95\"");
+        w.sample(p.pacing.p99_late_ms, label + ",quantile=\"0.99\"");
+        w.sample(p.pacing.max_late_ms, label + ",quantile=\"1\"");
+        w.sample(p.pacing.mean_late_ms * static_cast<double>(p.pacing.units), label, "_sum");
+        w.sample(static_cast<double>(p.pacing.units), label, "_count");
+    }
+
+    w.family("webrtc_peer_rtt_ms", "gauge", "Round-trip time from RTCP receiver reports");
+    for (const PeerMetrics& p : peers) {
+        if (p.rtt_ms >= 0.0) {
+            w.sample(p.rtt_ms, PrometheusWriter::peerLabel(p));
+        }
+    }
+    w.perPeer("webrtc_peer_nack_requests_total", "counter", "RTCP NACK messages received", peers,
+              [](const PeerMetrics& p) { return static_cast<double>(p.nack_requests); });
+    w.perPeer("webrtc_peer_nacked_packets_total", "counter", "Packets requested again by NACK", peers,
+              [](const PeerMetrics& p) { return static_cast<double>(p.nacked_packets); });
+    w.perPeer("webrtc_peer_pli_requests_total", "counter", "RTCP picture loss indications received", peers,
+              [](const PeerMetrics& p) { return static_cast<double>(p.pli_requests); });
+    w.perPeer("webrtc_peer_fraction_lost", "gauge", "Loss fraction in the last receiver report", peers,
+              [](const PeerMetrics& p) { return p.fraction_lost; });
+    w.perPeer("webrtc_peer_packets_lost", "gauge", "Cumulative packets lost, as reported by the receiver", peers,
+              [](const PeerMetrics& p) { return static_cast<double>(p.packets_lost); });
+    w.perPeer("webrtc_peer_jitter_ms", "gauge", "Interarrival jitter reported by the receiver", peers,
+              [](const PeerMetrics& p) { return p.jitter_ms; });
+
+    w.family("stream_scheduler_streams", "gauge", "Streams on the scheduler");
+    w.sample(static_cast<double>(metrics.scheduled_streams));
+    w.family("stream_scheduler_threads", "gauge", "Scheduler worker threads");
+    w.sample(static_cast<double>(metrics.scheduler_threads));
+    w.family("decode_queue_depth", "gauge", "Image decodes waiting for a pool thread");
+    w.sample(static_cast<double>(metrics.decode_queue));
+    w.family("broadcasts", "gauge", "Running broadcast producers");
+    w.sample(static_cast<double>(metrics.broadcasts));
+    w.family("webrtc_early_candidate_peers", "gauge", "Peers with ICE candidates waiting for their offer");
+    w.sample(static_cast<double>(metrics.early_candidate_peers));
+
+    w.family("process_cpu_seconds_total", "counter", "User and system CPU time");
+    w.sample(process.cpu_seconds);
+    w.family("process_resident_memory_bytes", "gauge", "Resident set size");
+    w.sample(static_cast<double>(process.rss_bytes));
+    w.family("process_threads", "gauge", "Threads in the process");
+    w.sample(static_cast<double>(process.threads));
+    w.family("process_uptime_seconds", "gauge", "Time since the process started");
+    w.sample(process.uptime_seconds);
+    return w.str();
+}
+
+Json::Value MetricsServer::toJson(const StreamingMetrics& metrics, const ProcessMetrics& process) {
+    Json::Value root;
+    Json::Value& peers = root["peers"] = Json::Value(Json::arrayValue);
+    for (const PeerMetrics& p : metrics.peers) {
+        Json::Value peer;
+        peer["peer_id"] = p.peer_id;
+        peer["camera"] = p.camera;
+        peer["active"] = p.active;
+        peer["state"] = p.state;
+        if (!p.broadcast.empty()) {
+            peer["broadcast"] = p.broadcast;
+        }
+        peer["bitrate_kbps"] = p.bitrate_kbps;
+        peer["frames_sent"] = Json::UInt64(p.frames_sent);
+        peer["send_failures"] = Json::UInt64(p.send_failures);
+        peer["rtp_packets"] = Json::UInt64(p.rtp_packets);
+        peer["rtp_bytes"] = Json::UInt64(p.rtp_bytes);
+        peer["send_buffer_bytes"] = Json::UInt64(p.send_buffer_bytes);
+        if (p.has_pacing) {
+            peer["pacing"] = pacingJson(p.pacing);
+        }
+        Json::Value& rtcp = peer["rtcp"];
+        rtcp["rtt_ms"] = p.rtt_ms >= 0.0 ? Json::Value(p.rtt_ms) : Json::Value();
+        rtcp["nack_requests"] = Json::UInt64(p.nack_requests);
+        rtcp["nacked_packets"] = Json::UInt64(p.nacked_packets);
+        rtcp["pli_requests"] = Json::UInt64(p.pli_requests);
+        rtcp["fraction_lost"] = p.fraction_lost;
+        rtcp["packets_lost"] = Json::Int64(p.packets_lost);
+        rtcp["jitter_ms"] = p.jitter_ms;
+        peers.append(peer);
+    }
+
+    Json::Value& queues = root["queues"];
+    queues["scheduled_streams"] = Json::UInt64(metrics.scheduled_streams);
+    queues["scheduler_threads"] = Json::UInt64(metrics.scheduler_threads);
+    queues["decode_queue"] = Json::UInt64(metrics.decode_queue);
+    queues["broadcasts"] = Json::UInt64(metrics.broadcasts);
+    queues["early_candidate_peers"] = Json::UInt64(metrics.early_candidate_peers);
+
+    if (!metrics.setup_timeline.isNull()) {
+        root["setup_timeline"] = metrics.setup_timeline;
+    }
+
+    Json::Value& proc = root["process"];
+    proc["cpu_seconds"] = process.cpu_seconds;
+    proc["cpu_percent"] = process.cpu_percent;
+    proc["rss_bytes"] = Json::UInt64(process.rss_bytes);
+    proc["threads"] = Json::UInt64(process.threads);
+    proc["uptime_seconds"] = process.uptime_seconds;
+    return root;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <json/json.h>
+
+#include "pacing.hpp"
+
+struct mg_connection;
+
+// Figures of one camera track of a peer at the time of a scrape
+struct PeerMetrics {
+    std::string peer_id;
+    std::string camera;            // media id of the track, e.g. "video0"
+    bool active = true;            // the client has the camera switched on
+    std::string state;             // peer connection state
+    std::string broadcast;         // broadcast the camera shows, if any
+    uint64_t frames_sent = 0;      // access units accepted by the track
+    uint64_t send_failures = 0;
+    uint64_t rtp_packets = 0;
+    uint64_t rtp_bytes = 0;
+    double bitrate_kbps = 0.0;
+    uint64_t send_buffer_bytes = 0;  // queued in the track, not yet on the wire
+    bool has_pacing = false;       // own file/image stream, not a broadcast
+    PacingStats pacing;
+    double rtt_ms = -1.0;          // negative while unknown
+    uint64_t nack_requests = 0;
+    uint64_t nacked_packets = 0;
+    uint64_t pli_requests = 0;
+    double fraction_lost = 0.0;
+    int64_t packets_lost = 0;
+    double jitter_ms = 0.0;
+};
+
+// Everything the streamer reports, collected on demand
+struct StreamingMetrics {
+    std::vector<PeerMetrics> peers;
+    size_t scheduled_streams = 0;
+    size_t scheduler_threads = 0;
+    size_t decode_queue = 0;       // image decodes waiting for a pool thread
+    size_t broadcasts = 0;
+    size_t early_candidate_peers = 0;  // peers with ICE candidates held for their offer
+    Json::Value setup_timeline;    // TimelineStats::toJson()
+};
+
+struct ProcessMetrics {
+    double cpu_seconds = 0.0;      // user + system
+    double cpu_percent = 0.0;      // since the previous scrape, of one core
+    uint64_t rss_bytes = 0;
+    uint64_t threads = 0;
+    double uptime_seconds = 0.0;
+};
+
+// Reads /proc/self; cpu_percent is left at 0
+ProcessMetrics readProcessMetrics();
+
+// Embedded HTTP endpoint (mongoose) for monitoring scrapes:
+//
+//   GET /metrics     Prometheus text exposition format
+//   GET /stats.json  the same figures as one JSON document
+//
+// Runs its own poll thread; each request calls the collector on that thread.
+// METRICS_PORT selects the port (default 9102, 0 disables the endpoint).
+class MetricsServer {
+public:
+    using Collector = std::function<StreamingMetrics()>;
+
+    explicit MetricsServer(Collector collect);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // listen_url like "http://0.0.0.0:9102"; false if the port cannot be bound
+    bool start(const std::string& listen_url);
+    void stop();
+
+    // "" when disabled
+    static std::string defaultListenUrl();
+
+    static std::string toPrometheus(const StreamingMetrics& metrics, const ProcessMetrics& process);
+    static Json::Value toJson(const StreamingMetrics& metrics, const ProcessMetrics& process);
+
+private:
+    Collector collect_;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+
+    // Previous CPU sample, for cpu_percent; poll thread only
+    double last_cpu_seconds_ = 0.0;
+    double last_uptime_seconds_ = 0.0;
+
+    static void handleEvent(mg_connection* c, int ev, void* ev_data);
+    void handleRequest(mg_connection* c, bool prometheus);
+};
@@ -0,0 +1,393 @@
+#include "mp4_demuxer.hpp"
+
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+
+uint16_t readU16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint32_t readU32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+uint64_t readU64(const uint8_t* p) {
+    return (static_cast<uint64_t>(readU32(p)) << 32) | readU32(p + 4);
+}
+
+// Iterates the child boxes of an in-memory container box
+class BoxIterator {
+public:
+    BoxIterator(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    bool next() {
+        pos_ = next_;
+        if (pos_ + 8 > size_) {
+            return false;
+        }
+        uint64_t box_size = readU32(data_ + pos_);
+        std::memcpy(type_, data_ + pos_ + 4, 4);
+        size_t header = 8;
+        if (box_size == 1) {
+            if (pos_ + 16 > size_) {
+                return false;
+            }
+            box_size = readU64(data_ + pos_ + 8);
+            header = 16;
+        } else if (box_size == 0) {
+            box_size = size_ - pos_;
+        }
+        if (box_size < header || box_size > size_ - pos_) {
+            return false;
+        }
+        payload_ = data_ + pos_ + header;
+        payload_size_ = static_cast<size_t>(box_size - header);
+        next_ = pos_ + static_cast<size_t>(box_size);
+        return true;
+    }
+
+    bool is(const char* type) const { return std::memcmp(type_, type, 4) == 0; }
+    const uint8_t* payload() const { return payload_; }
+    size_t payloadSize() const { return payload_size_; }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_ = 0;
+    size_t next_ = 0;
+    char type_[4] = {0, 0, 0, 0};
+    const uint8_t* payload_ = nullptr;
+    size_t payload_size_ = 0;
+};
+
+// Full boxes start with version (1 byte) + flags (3 bytes) followed by an entry count
+bool readEntryCount(const uint8_t* data, size_t size, size_t entry_bytes, uint32_t& count) {
+    if (size < 8) {
+        return false;
+    }
+    count = readU32(data + 4);
+    return entry_bytes == 0 || count <= (size - 8) / entry_bytes;
+}
+
+}  // namespace
+
+bool Mp4Demuxer::looksLikeMp4(const uint8_t* data, size_t size) {
+    return size >= 8 && (std::memcmp(data + 4, "ftyp", 4) == 0 || std::memcmp(data + 4, "moov", 4) == 0);
+}
+
+bool Mp4Demuxer::parse(const uint8_t* data, size_t size) {
+    data_ = data;
+    size_ = size;
+    samples_.clear();
+
+    // Top-level boxes: only moov is parsed, mdat is addressed through the sample table
+    BoxIterator top(data, size);
+    while (top.next()) {
+        if (!top.is("moov")) {
+            continue;
+        }
+        if (!parseMoov(top.payload(), top.payloadSize())) {
+            std::cerr << "❌ Failed to parse moov box" << std::endl;
+            return false;
+        }
+        std::cout << "🎞️  MP4 track: " << width_ << "x" << height_ << ", " << samples_.size()
+                  << " samples, timescale " << timescale_ << ", " << sps_.size() << " SPS / "
+                  << pps_.size() << " PPS" << std::endl;
+        return true;
+    }
+
+    std::cerr << "❌ No moov box found" << std::endl;
+    return false;
+}
+
+bool Mp4Demuxer::parseMoov(const uint8_t* data, size_t size) {
+    BoxIterator it(data, size);
+    while (it.next()) {
+        if (!it.is("trak")) {
+            continue;
+        }
+        TrackTables track;
+        if (parseTrak(it.payload(), it.payloadSize(), track) && track.is_video && track.has_avcc) {
+            return buildSampleTable(track);
+        }
+    }
+    std::cerr << "❌ No H.264 (avc1/avcC) video track found" << std::endl;
+    return false;
+}
+
+bool Mp4Demuxer::parseTrak(const uint8_t* data, size_t size, TrackTables& track) {
+    BoxIterator trak(data, size);
+    while (trak.next()) {
+        if (!trak.is("mdia")) {
+            continue;
+        }
+        BoxIterator mdia(trak.payload(), trak.payloadSize());
+        while (mdia.next()) {
+            const uint8_t* p = mdia.payload();
+            size_t n = mdia.payloadSize();
+
+            if (mdia.is("mdhd")) {
+                // version 1 uses 64-bit creation/modification times
+                size_t timescale_at = (n > 0 && p[0] == 1) ? 20 : 12;
+                if (n < timescale_at + 4) {
+                    return false;
+                }
+                track.timescale = readU32(p + timescale_at);
+            } else if (mdia.is("hdlr")) {
+                track.is_video = n >= 12 && std::memcmp(p + 8, "vide", 4) == 0;
+            } else if (mdia.is("minf")) {
+                BoxIterator minf(p, n);
+                while (minf.next()) {
+                    if (!minf.is("stbl")) {
+                        continue;
+                    }
+                    BoxIterator stbl(minf.payload(), minf.payloadSize());
+                    while (stbl.next()) {
+                        const uint8_t* b = stbl.payload();
+                        size_t bn = stbl.payloadSize();
+                        uint32_t count = 0;
+
+                        if (stbl.is("stsd")) {
+                            if (!parseStsd(b, bn, track)) {
+                                return false;
+                            }
+                        } else if (stbl.is("stts")) {
+                            if (!readEntryCount(b, bn, 8, count)) return false;
+                            for (uint32_t i = 0; i < count; i++) {
+                                track.stts.emplace_back(readU32(b + 8 + i * 8), readU32(b + 12 + i * 8));
+                            }
+                        } else if (stbl.is("ctts")) {
+                            // version 0 offsets are unsigned, version 1 signed; both fit int32 in practice
+                            if (!readEntryCount(b, bn, 8, count)) return false;
+                            for (uint32_t i = 0; i < count; i++) {
+                                track.ctts.emplace_back(readU32(b + 8 + i * 8),
+                                                        static_cast<int32_t>(readU32(b + 12 + i * 8)));
+                            }
+                        } else if (stbl.is("stsc")) {
+                            if (!readEntryCount(b, bn, 12, count)) return false;
+                            for (uint32_t i = 0; i < count; i++) {
+                                track.stsc_first_chunk.push_back(readU32(b + 8 + i * 12));
+                                track.stsc_samples_per_chunk.push_back(readU32(b + 12 + i * 12));
+                            }
+                        } else if (stbl.is("stsz")) {
+                            if (bn < 12) return false;
+                            track.stsz_default = readU32(b + 4);
+                            track.stsz_count = readU32(b + 8);
+                            if (track.stsz_default == 0) {
+                                if (track.stsz_count > (bn - 12) / 4) return false;
+                                track.stsz.reserve(track.stsz_count);
+                                for (uint32_t i = 0; i < track.stsz_count; i++) {
+                                    track.stsz.push_back(readU32(b + 12 + i * 4));
+                                }
+                            }
+                        } else if (stbl.is("stco")) {
+                            if (!readEntryCount(b, bn, 4, count)) return false;
+                            for (uint32_t i = 0; i < count; i++) {
+                                track.chunk_offsets.push_back(readU32(b + 8 + i * 4));
+                            }
+                        } else if (stbl.is("co64")) {
+                            if (!readEntryCount(b, bn, 8, count)) return false;
+                            for (uint32_t i = 0; i < count; i++) {
+                                track.chunk_offsets.push_back(readU64(b + 8 + i * 8));
+                            }
+                        } else if (stbl.is("stss")) {
+                            if (!readEntryCount(b, bn, 4, count)) return false;
+                            track.has_stss = true;
+                            for (uint32_t i = 0; i < count; i++) {
+                                track.stss.push_back(readU32(b + 8 + i * 4));
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool Mp4Demuxer::parseStsd(const uint8_t* data, size_t size, TrackTables& track) {
+    uint32_t count = 0;
+    if (!readEntryCount(data, size, 0, count)) {
+        return false;
+    }
+
+    BoxIterator entries(data + 8, size - 8);
+    while (entries.next()) {
+        if (!entries.is("avc1") && !entries.is("avc3")) {
+            continue;
+        }
+        // VisualSampleEntry: 78 bytes of fixed fields before the child boxes
+        const uint8_t* p = entries.payload();
+        size_t n = entries.payloadSize();
+        if (n < 78) {
+            return false;
+        }
+        track.width = readU16(p + 24);
+        track.height = readU16(p + 26);
+
+        BoxIterator children(p + 78, n - 78);
+        while (children.next()) {
+            if (children.is("avcC")) {
+                return parseAvcC(children.payload(), children.payloadSize(), track);
+            }
+        }
+    }
+    return true;
+}
+
+bool Mp4Demuxer::parseAvcC(const uint8_t* data, size_t size, TrackTables& track) {
+    if (size < 7) {
+        return false;
+    }
+    track.length_size = (data[4] & 0x03) + 1;
+
+    size_t pos = 5;
+    for (int list = 0; list < 2; list++) {
+        if (pos >= size) {
+            return false;
+        }
+        int count = list == 0 ? (data[pos] & 0x1F) : data[pos];
+        pos++;
+        auto& target = list == 0 ? track.sps : track.pps;
+        for (int i = 0; i < count; i++) {
+            if (pos + 2 > size) {
+                return false;
+            }
+            size_t length = readU16(data + pos);
+            pos += 2;
+            if (pos + length > size) {
+                return false;
+            }
+            target.emplace_back(data + pos, data + pos + length);
+            pos += length;
+        }
+    }
+
+    track.has_avcc = true;
+    return true;
+}
+
+bool Mp4Demuxer::buildSampleTable(const TrackTables& track) {
+    const size_t count = track.stsz_count;
+    if (count == 0 || track.chunk_offsets.empty() || track.stsc_first_chunk.empty()) {
+        std::cerr << "❌ Track has no samples in moov (fragmented MP4 is not supported)" << std::endl;
+        return false;
+    }
+
+    samples_.assign(count, Sample{0, 0, 0, 0, !track.has_stss});
+
+    // Sizes
+    for (size_t i = 0; i < count; i++) {
+        samples_[i].size = track.stsz_default ? track.stsz_default : track.stsz[i];
+    }
+
+    // Offsets: walk chunks, using the stsc run that covers each chunk
+    size_t sample = 0;
+    size_t run = 0;
+    for (size_t chunk = 0; chunk < track.chunk_offsets.size() && sample < count; chunk++) {
+        while (run + 1 < track.stsc_first_chunk.size() && chunk + 1 >= track.stsc_first_chunk[run + 1]) {
+            run++;
+        }
+        uint64_t offset = track.chunk_offsets[chunk];
+        for (uint32_t s = 0; s < track.stsc_samples_per_chunk[run] && sample < count; s++, sample++) {
+            samples_[sample].offset = offset;
+            offset += samples_[sample].size;
+        }
+    }
+    if (sample != count) {
+        std::cerr << "❌ Chunk table covers " << sample << " of " << count << " samples" << std::endl;
+        return false;
+    }
+
+    // Decode timestamps
+    int64_t dts = 0;
+    sample = 0;
+    for (const auto& entry : track.stts) {
+        for (uint32_t i = 0; i < entry.first && sample < count; i++, sample++) {
+            samples_[sample].dts = dts;
+            dts += entry.second;
+        }
+    }
+    for (; sample < count; sample++) {
+        samples_[sample].dts = dts;
+    }
+
+    // Composition offsets
+    sample = 0;
+    for (const auto& entry : track.ctts) {
+        for (uint32_t i = 0; i < entry.first && sample < count; i++, sample++) {
+            samples_[sample].composition_offset = entry.second;
+        }
+    }
+
+    // Sync samples
+    for (uint32_t number : track.stss) {
+        if (number >= 1 && number <= count) {
+            samples_[number - 1].keyframe = true;
+        }
+    }
+
+    for (const auto& s : samples_) {
+        if (s.offset > size_ || s.size > size_ - s.offset) {
+            std::cerr << "❌ Sample data extends past end of file" << std::endl;
+            samples_.clear();
+            return false;
+        }
+    }
+
+    timescale_ = track.timescale ? track.timescale : 90000;
+    width_ = track.width;
+    height_ = track.height;
+    length_size_ = track.length_size;
+    sps_ = track.sps;
+    pps_ = track.pps;
+    return true;
+}
+
+bool Mp4Demuxer::readAccessUnit(size_t index, AccessUnit& au) const {
+    if (index >= samples_.size()) {
+        return false;
+    }
+
+    const Sample& sample = samples_[index];
+    au.index = index;
+    au.dts = sample.dts;
+    au.pts = sample.dts + sample.composition_offset;
+    au.keyframe = sample.keyframe;
+    au.nal_units.clear();
+
+    if (sample.keyframe) {
+        for (const auto& ps : sps_) au.nal_units.push_back({ps.data(), ps.size()});
+        for (const auto& ps : pps_) au.nal_units.push_back({ps.data(), ps.size()});
+    }
+
+    // Split on the avcC length prefixes
+    const uint8_t* p = data_ + sample.offset;
+    const size_t size = sample.size;
+    size_t pos = 0;
+    while (pos + length_size_ <= size) {
+        size_t length = 0;
+        for (int i = 0; i < length_size_; i++) {
+            length = (length << 8) | p[pos + i];
+        }
+        pos += length_size_;
+        if (length == 0 || length > size - pos) {
+            std::cerr << "⚠️ Corrupt NAL length in sample " << index << std::endl;
+            break;
+        }
+
+        uint8_t nal_type = p[pos] & 0x1F;
+        // Keyframes already carry the avcC parameter sets; skip in-band (avc3) copies
+        bool duplicate = sample.keyframe && (nal_type == 7 || nal_type == 8) && !sps_.empty();
+        if (!duplicate) {
+            au.nal_units.push_back({p + pos, length});
+        }
+        pos += length;
+    }
+
+    return !au.nal_units.empty();
+}
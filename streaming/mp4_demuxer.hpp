@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "access_unit.hpp"
+
+// Minimal ISO-BMFF (MP4) demuxer for the first H.264 video track.
+//
+// parse() walks the top-level boxes of an in-memory (mapped) file and builds a
+// sample table from moov: stsd/avcC, stts, ctts, stsc, stsz, stco/co64 and
+// stss. readAccessUnit() only touches the bytes of one sample and returns views
+// split on the avcC length prefixes, so with a mapped file only the pages that
+// are actually streamed get faulted in. SPS/PPS from avcC are prepended to
+// every keyframe so a receiver can start decoding at any sync sample.
+//
+// After parse() the demuxer is immutable and safe to read from many threads.
+class Mp4Demuxer {
+public:
+    struct Sample {
+        uint64_t offset;
+        uint32_t size;
+        int64_t dts;
+        int32_t composition_offset;
+        bool keyframe;
+    };
+
+    // Cheap check of the first box type; used to pick the MP4 or Annex-B path
+    static bool looksLikeMp4(const uint8_t* data, size_t size);
+
+    bool parse(const uint8_t* data, size_t size);
+
+    bool readAccessUnit(size_t index, AccessUnit& au) const;
+
+    size_t sampleCount() const { return samples_.size(); }
+    const std::vector<Sample>& samples() const { return samples_; }
+    uint32_t timescale() const { return timescale_; }
+    int width() const { return width_; }
+    int height() const { return height_; }
+    const std::vector<std::vector<uint8_t>>& sps() const { return sps_; }
+    const std::vector<std::vector<uint8_t>>& pps() const { return pps_; }
+
+    double toSeconds(int64_t ticks) const {
+        return timescale_ ? static_cast<double>(ticks) / timescale_ : 0.0;
+    }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+
+    uint32_t timescale_ = 0;
+    int width_ = 0;
+    int height_ = 0;
+    int length_size_ = 4;
+    std::vector<std::vector<uint8_t>> sps_;
+    std::vector<std::vector<uint8_t>> pps_;
+    std::vector<Sample> samples_;
+
+    // Raw sample tables of the selected track, resolved into samples_ by buildSampleTable()
+    struct TrackTables {
+        uint32_t timescale = 0;
+        bool is_video = false;
+        bool has_avcc = false;
+        int width = 0;
+        int height = 0;
+        int length_size = 4;
+        std::vector<std::vector<uint8_t>> sps;
+        std::vector<std::vector<uint8_t>> pps;
+        std::vector<std::pair<uint32_t, uint32_t>> stts;   // sample_count, sample_delta
+        std::vector<std::pair<uint32_t, int32_t>> ctts;    // sample_count, sample_offset
+        std::vector<uint32_t> stsc_first_chunk;
+        std::vector<uint32_t> stsc_samples_per_chunk;
+        uint32_t stsz_default = 0;
+        uint32_t stsz_count = 0;
+        std::vector<uint32_t> stsz;
+        std::vector<uint64_t> chunk_offsets;
+        std::vector<uint32_t> stss;                        // 1-based sync sample numbers
+        bool has_stss = false;
+    };
+
+    bool parseMoov(const uint8_t* data, size_t size);
+    bool parseTrak(const uint8_t* data, size_t size, TrackTables& track);
+    bool parseStsd(const uint8_t* data, size_t size, TrackTables& track);
+    bool parseAvcC(const uint8_t* data, size_t size, TrackTables& track);
+    bool buildSampleTable(const TrackTables& track);
+};
@@ -13,6 +13,8 @@
 #include <json/json.h>
 #endif
 
+#include "log.hpp"
+#include "metrics_server.hpp"
 #include "webrtc_manager.hpp"
 
 // Global variables for signal handling
@@ -31,6 +33,7 @@ private:
     int port;
     std::string robot_control_topic;
     std::string candidate_topic;
+    std::string control_topic;
     std::string thing_name;
     
 #ifdef WEBRTC_ENABLED
@@ -39,6 +42,9 @@ private:
     std::unique_ptr<MockWebRTCManager> webrtc_manager;
 #endif
     
+    // HTTP /metrics and /stats.json; stopped before the manager it reads from
+    std::unique_ptr<MetricsServer> metrics_server;
+    
     static void on_connect_callback(struct mosquitto *mosq, void *userdata, int result) {
         MQTTClient *client = static_cast<MQTTClient*>(userdata);
         client->on_connect(result);
@@ -81,16 +87,14 @@ private:
     
     // Generic method to publish MQTT messages
     void publish_message(const std::string& topic, const std::string& message) {
-        std::cout << "📡 Publishing to topic: " << topic << std::endl;
-        
         int ret = mosquitto_publish(mosq, nullptr, topic.c_str(), 
                                   message.length(), message.c_str(), 
                                   0, false);
         
         if (ret == MOSQ_ERR_SUCCESS) {
-            std::cout << "✅ Message published successfully" << std::endl;
+            LOG_INFO("📡 Published {} bytes to topic: {}", message.length(), topic);
         } else {
-            std::cerr << "❌ Failed to publish message. Error: " << ret << " (" << mosquitto_strerror(ret) << ")" << std::endl;
+            LOG_ERROR("❌ Failed to publish to {}. Error: {} ({})", topic, ret, mosquitto_strerror(ret));
         }
     }
     
@@ -122,6 +126,14 @@ private:
             } else {
                 std::cerr << "Failed to subscribe to candidate topic. Error: " << ret2 << " (" << mosquitto_strerror(ret2) << ")" << std::endl;
             }
+            
+            // Subscribe to playback control topic (seek / loop / rate of file streams)
+            int ret3 = mosquitto_subscribe(mosq, nullptr, control_topic.c_str(), 0);
+            if (ret3 == MOSQ_ERR_SUCCESS) {
+                std::cout << "Subscribed to control topic: " << control_topic << std::endl;
+            } else {
+                std::cerr << "Failed to subscribe to control topic. Error: " << ret3 << " (" << mosquitto_strerror(ret3) << ")" << std::endl;
+            }
         } else {
             std::cerr << "Failed to connect to MQTT broker. Return code: " << result << std::endl;
         }
@@ -129,25 +141,21 @@ private:
     }
     
     void on_message(const struct mosquitto_message *message) {
-        std::cout.flush();
-        
-        auto now = std::chrono::system_clock::now();
-        auto time_t = std::chrono::system_clock::to_time_t(now);
         std::string topic_str = message->topic;
         
-        std::cout << "[" << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S")
-                  << "] Received message on '" << topic_str << "':" << std::endl;
+        LOG_INFO("📨 Received message on '{}' ({} bytes)", topic_str, message->payloadlen);
         
         // Check if this is a robot-control offer topic and extract peerId
         if (topic_str.find("/robot-control/") != std::string::npos && topic_str.find("/offer") != std::string::npos) {
             std::string peer_id = extract_peer_id(topic_str);
             if (!peer_id.empty()) {
-                std::cout << "🤖 ROBOT-CONTROL OFFER - Extracted peerId: " << peer_id << std::endl;
+                LOG_INFO("🤖 ROBOT-CONTROL OFFER - Extracted peerId: {}", peer_id);
                 
                 // Parse the offer payload (supports both JSON and raw SDP)
                 if (message->payload && message->payloadlen > 0) {
                     std::string payload(static_cast<char*>(message->payload), message->payloadlen);
                     std::string offer_sdp;
+                    SeiTimestampMode sei_mode = defaultSeiTimestampMode();
                     
                     try {
                         // Check if payload is JSON or raw SDP
@@ -160,56 +168,63 @@ private:
                             if (reader.parse(payload, root)) {
                                 if (root.isMember("sdp")) {
                                     offer_sdp = root["sdp"].asString();
-                                    std::cout << "📥 Received JSON SDP offer for peer " << peer_id << std::endl;
+                                    LOG_INFO("📥 Received JSON SDP offer for peer {}", peer_id);
+                                    
+                                    // Optional per-peer latency probe: "off", "wallclock" or "capture"
+                                    if (root.isMember("seiTimestamp") &&
+                                        !parseSeiTimestampMode(root["seiTimestamp"].asString(), sei_mode)) {
+                                        LOG_WARN("⚠️  Unknown seiTimestamp mode: {}",
+                                                 root["seiTimestamp"].asString());
+                                    }
                                 } else {
-                                    std::cout << "⚠️  No SDP found in JSON payload" << std::endl;
+                                    LOG_WARN("⚠️  No SDP found in JSON payload");
                                     publish_answer(peer_id);
                                     return;
                                 }
                             } else {
-                                std::cout << "⚠️  Invalid JSON in offer payload" << std::endl;
+                                LOG_WARN("⚠️  Invalid JSON in offer payload");
                                 publish_answer(peer_id);
                                 return;
                             }
 #else
-                            std::cout << "⚠️  JSON parsing disabled - treating as raw SDP" << std::endl;
+                            LOG_WARN("⚠️  JSON parsing disabled - treating as raw SDP");
                             offer_sdp = payload;
 #endif
                         } else {
                             // Treat as raw SDP (like in response.md)
                             offer_sdp = payload;
-                            std::cout << "📥 Received raw SDP offer for peer " << peer_id << std::endl;
+                            LOG_INFO("📥 Received raw SDP offer for peer {}", peer_id);
                         }
                         
                         // Use WebRTC manager to handle the offer
-                        if (webrtc_manager && webrtc_manager->handleOffer(peer_id, offer_sdp)) {
-                            std::cout << "✅ WebRTC offer handled successfully for " << peer_id << std::endl;
-                            std::cout << "⏳ Video streaming will start automatically when connection is established" << std::endl;
+                        if (webrtc_manager && webrtc_manager->handleOffer(peer_id, offer_sdp, sei_mode)) {
+                            LOG_INFO("✅ WebRTC offer handled successfully for {}", peer_id);
+                            LOG_INFO("⏳ Video streaming will start automatically when connection is established");
                         } else {
-                            std::cout << "⚠️  WebRTC offer handling failed for " << peer_id << std::endl;
+                            LOG_WARN("⚠️  WebRTC offer handling failed for {}", peer_id);
                             // Fallback to simple answer
                             publish_answer(peer_id);
                         }
                         
                     } catch (const std::exception& e) {
-                        std::cerr << "❌ Error parsing offer: " << e.what() << std::endl;
+                        LOG_ERROR("❌ Error parsing offer: {}", e.what());
                         // Fallback to simple answer
                         publish_answer(peer_id);
                     }
                 } else {
-                    std::cout << "⚠️  Empty offer payload" << std::endl;
+                    LOG_WARN("⚠️  Empty offer payload");
                     // Fallback to simple answer
                     publish_answer(peer_id);
                 }
             } else {
-                std::cout << "⚠️  Could not extract peerId from topic" << std::endl;
+                LOG_WARN("⚠️  Could not extract peerId from topic");
             }
         }
         // Check if this is a candidate/robot topic for ICE candidates
         else if (topic_str.find("/robot-control/") != std::string::npos && topic_str.find("/candidate/robot") != std::string::npos) {
             std::string peer_id = extract_peer_id(topic_str);
             if (!peer_id.empty()) {
-                std::cout << "🧊 ICE CANDIDATES - Received for peerId: " << peer_id << std::endl;
+                LOG_INFO("🧊 ICE CANDIDATES - Received for peerId: {}", peer_id);
                 
                 // Parse the ICE candidates JSON array
                 if (message->payload && message->payloadlen > 0) {
@@ -221,40 +236,52 @@ private:
                         Json::Reader reader;
                         
                         if (reader.parse(payload, candidates) && candidates.isArray()) {
-                            std::cout << "📥 Received " << candidates.size() << " ICE candidates for peer " << peer_id << std::endl;
+                            LOG_INFO("📥 Received {} ICE candidates for peer {}", candidates.size(), peer_id);
                             
                             // Pass candidates to WebRTC manager
                             if (webrtc_manager && webrtc_manager->handleCandidates(peer_id, candidates)) {
-                                std::cout << "✅ ICE candidates handled successfully for " << peer_id << std::endl;
+                                LOG_INFO("✅ ICE candidates handled successfully for {}", peer_id);
                             } else {
-                                std::cout << "⚠️  ICE candidates handling failed for " << peer_id << std::endl;
+                                LOG_WARN("⚠️  ICE candidates handling failed for {}", peer_id);
                             }
                         } else {
-                            std::cout << "⚠️  Invalid JSON array in candidates payload" << std::endl;
+                            LOG_WARN("⚠️  Invalid JSON array in candidates payload");
                         }
 #else
-                        std::cout << "⚠️  JSON parsing disabled - cannot handle ICE candidates" << std::endl;
+                        LOG_WARN("⚠️  JSON parsing disabled - cannot handle ICE candidates");
 #endif
                     } catch (const std::exception& e) {
-                        std::cerr << "❌ Error parsing ICE candidates: " << e.what() << std::endl;
+                        LOG_ERROR("❌ Error parsing ICE candidates: {}", e.what());
                     }
                 } else {
-                    std::cout << "⚠️  Empty candidates payload" << std::endl;
+                    LOG_WARN("⚠️  Empty candidates payload");
                 }
             } else {
-                std::cout << "⚠️  Could not extract peerId from candidate topic" << std::endl;
+                LOG_WARN("⚠️  Could not extract peerId from candidate topic");
+            }
+        }
+        // Check if this is a playback control topic: {"seek": s, "loop": b, "rate": x}
+        else if (topic_str.find("/robot-control/") != std::string::npos &&
+                 topic_str.size() > 8 && topic_str.compare(topic_str.size() - 8, 8, "/control") == 0) {
+            std::string peer_id = extract_peer_id(topic_str);
+            if (!peer_id.empty() && message->payload && message->payloadlen > 0) {
+                std::string payload(static_cast<char*>(message->payload), message->payloadlen);
+                Json::Value command;
+                Json::Reader reader;
+                if (reader.parse(payload, command) && command.isObject()) {
+                    webrtc_manager->handlePlaybackControl(peer_id, command);
+                } else {
+                    LOG_WARN("⚠️  Invalid JSON in playback control for {}", peer_id);
+                }
+            } else {
+                LOG_WARN("⚠️  Empty or unaddressed playback control message");
             }
         }
         
+        // Offers carry a whole SDP; the dump is debug-only and truncated to one log record
         if (message->payload && message->payloadlen > 0) {
-            std::string payload(static_cast<char*>(message->payload), message->payloadlen);
-            std::cout << "Payload: " << payload << std::endl;
-        } else {
-            std::cout << "No payload or empty payload" << std::endl;
+            LOG_DEBUG("Payload: {}", std::string(static_cast<char*>(message->payload), message->payloadlen));
         }
-        
-        std::cout << std::string(50, '-') << std::endl;
-        std::cout.flush();
     }
     
     void on_subscribe(int mid, int qos_count, const int *granted_qos) {
@@ -274,6 +301,7 @@ public:
         : host(host), port(port), 
           robot_control_topic("vnext-test_b6239876-943a-4d6f-a7ef-f1440d5c58af/robot-control/+/offer"),
           candidate_topic("vnext-test_b6239876-943a-4d6f-a7ef-f1440d5c58af/robot-control/+/candidate/robot"),
+          control_topic("vnext-test_b6239876-943a-4d6f-a7ef-f1440d5c58af/robot-control/+/control"),
           thing_name("vnext-test_b6239876-943a-4d6f-a7ef-f1440d5c58af") {
         mosquitto_lib_init();
         mosq = mosquitto_new("m2m-robot-001", true, this);
@@ -303,6 +331,16 @@ public:
 #else
         webrtc_manager = std::make_unique<MockWebRTCManager>(thing_name, publish_cb);
 #endif
+        
+        std::string metrics_url = MetricsServer::defaultListenUrl();
+        if (!metrics_url.empty()) {
+#ifdef WEBRTC_ENABLED
+            metrics_server = std::make_unique<MetricsServer>([this]() { return webrtc_manager->collectMetrics(); });
+#else
+            metrics_server = std::make_unique<MetricsServer>(nullptr);  // process figures only
+#endif
+            metrics_server->start(metrics_url);
+        }
     }
     
     ~MQTTClient() {
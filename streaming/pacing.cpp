@@ -0,0 +1,109 @@
+#include "pacing.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+void logPacingStats(const std::string& label, const PacingStats& stats) {
+    std::cout << "⏱️  Pacing " << label << ": " << stats.units << " units, late p50 "
+              << stats.p50_late_ms << " ms, p95 " << stats.p95_late_ms << " ms, p99 "
+              << stats.p99_late_ms << " ms, max " << stats.max_late_ms << " ms, oversleep "
+              << stats.oversleep_ms << " ms, " << stats.rebases << " rebase(s)" << std::endl;
+}
+
+void PacingScheduler::waitUntil(double media_seconds) {
+    Clock::time_point deadline = schedule(media_seconds);
+    Clock::time_point now = Clock::now();
+
+    if (!rebase_pending_ && deadline > now) {
+        // Sleep short of the deadline by the typical overshoot, then yield the rest
+        Clock::time_point target = deadline - std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(oversleep_.load()));
+        if (target > now) {
+            std::this_thread::sleep_until(target);
+            double overshoot = std::chrono::duration<double>(Clock::now() - target).count();
+            oversleep_ = 0.9 * oversleep_.load() + 0.1 * std::max(0.0, overshoot);
+        }
+        while (Clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+    }
+
+    released(deadline);
+}
+
+PacingScheduler::Clock::time_point PacingScheduler::schedule(double media_seconds) {
+    Clock::time_point now = Clock::now();
+    if (!anchored_) {
+        anchor_time_ = now;
+        anchor_media_ = media_seconds;
+        anchored_ = true;
+    }
+
+    Clock::time_point deadline = anchor_time_ + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(media_seconds - anchor_media_));
+
+    if (now - deadline > kMaxLag) {
+        anchor_time_ = now;
+        anchor_media_ = media_seconds;
+        rebase_pending_ = true;
+        return now;
+    }
+    return deadline;
+}
+
+void PacingScheduler::released(Clock::time_point deadline) {
+    if (rebase_pending_) {
+        rebase_pending_ = false;
+        record(0.0, true);
+        return;
+    }
+    record(std::chrono::duration<double>(Clock::now() - deadline).count(), false);
+}
+
+void PacingScheduler::reset() {
+    anchored_ = false;
+}
+
+void PacingScheduler::record(double late_seconds, bool rebased) {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    if (rebased) {
+        rebases_++;
+    }
+    late_seconds = std::max(0.0, late_seconds);
+    int bucket = static_cast<int>(late_seconds * 1e6 / kBucketMicros);
+    histogram_[std::min(bucket, kBuckets)]++;
+    units_++;
+    late_sum_ += late_seconds;
+    late_max_ = std::max(late_max_, late_seconds);
+}
+
+double PacingScheduler::percentile(double fraction) const {
+    if (units_ == 0) {
+        return 0.0;
+    }
+    uint64_t rank = static_cast<uint64_t>(fraction * (units_ - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i <= kBuckets; i++) {
+        seen += histogram_[i];
+        if (seen >= rank) {
+            // Upper edge of the bucket, in milliseconds
+            return i < kBuckets ? (i + 1) * kBucketMicros / 1000.0 : late_max_ * 1000.0;
+        }
+    }
+    return late_max_ * 1000.0;
+}
+
+PacingStats PacingScheduler::stats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    PacingStats stats;
+    stats.units = units_;
+    stats.rebases = rebases_;
+    stats.mean_late_ms = units_ ? late_sum_ * 1000.0 / units_ : 0.0;
+    stats.p50_late_ms = percentile(0.50);
+    stats.p95_late_ms = percentile(0.95);
+    stats.p99_late_ms = percentile(0.99);
+    stats.max_late_ms = late_max_ * 1000.0;
+    stats.oversleep_ms = oversleep_.load() * 1000.0;
+    return stats;
+}
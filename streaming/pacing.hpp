@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// Send-time statistics of one paced stream. "Late" is how far after its
+// deadline an access unit was released; it is the jitter the receiver sees
+// on top of network jitter.
+struct PacingStats {
+    uint64_t units = 0;
+    uint64_t rebases = 0;
+    double mean_late_ms = 0.0;
+    double p50_late_ms = 0.0;
+    double p95_late_ms = 0.0;
+    double p99_late_ms = 0.0;
+    double max_late_ms = 0.0;
+    double oversleep_ms = 0.0;  // current sleep overshoot estimate
+};
+
+// One-line summary for the logs
+void logPacingStats(const std::string& label, const PacingStats& stats);
+
+// Releases access units on absolute steady_clock deadlines derived from their
+// media timestamps, so per-unit send time never accumulates into drift.
+//
+// Blocking senders call waitUntil(). Event-loop senders call schedule() for a
+// unit's deadline, arm a timer on it, and call released() when it fires.
+//
+// The first waitUntil() call anchors media time to the clock. Later calls
+// sleep until anchor + (t - t0), waking early by the measured average
+// oversleep and yielding for the last fraction. A stream that falls more than
+// kMaxLag behind (stall, debugger, suspended track) is re-anchored instead of
+// bursting out the backlog.
+class PacingScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr std::chrono::milliseconds kMaxLag{500};
+
+    // Blocks until media time media_seconds is due
+    void waitUntil(double media_seconds);
+    
+    // Non-blocking form: deadline of media_seconds, anchoring or re-anchoring
+    // exactly as waitUntil() would, and the matching release notification
+    Clock::time_point schedule(double media_seconds);
+    void released(Clock::time_point deadline);
+
+    // Forget the anchor, e.g. after a seek; statistics are kept
+    void reset();
+
+    PacingStats stats() const;
+
+private:
+    // Lateness histogram: 100 us buckets up to 50 ms, last bucket is overflow
+    static constexpr int kBucketMicros = 100;
+    static constexpr int kBuckets = 500;
+
+    bool anchored_ = false;
+    Clock::time_point anchor_time_;
+    double anchor_media_ = 0.0;
+    std::atomic<double> oversleep_{0.0};  // seconds, EWMA; read by stats()
+    bool rebase_pending_ = false;         // schedule() re-anchored; released() records it
+
+    mutable std::mutex stats_mutex_;
+    std::array<uint64_t, kBuckets + 1> histogram_{};
+    uint64_t units_ = 0;
+    uint64_t rebases_ = 0;
+    double late_sum_ = 0.0;
+    double late_max_ = 0.0;
+
+    void record(double late_seconds, bool rebased);
+    double percentile(double fraction) const;
+};
@@ -0,0 +1,59 @@
+#include "peer_registry.hpp"
+
+#include <functional>
+
+const PeerRegistry::Shard& PeerRegistry::shardFor(const std::string& peer_id) const {
+    return shards_[std::hash<std::string>{}(peer_id) % kShards];
+}
+
+PeerRegistry::Shard& PeerRegistry::shardFor(const std::string& peer_id) {
+    return shards_[std::hash<std::string>{}(peer_id) % kShards];
+}
+
+PeerSessionPtr PeerRegistry::find(const std::string& peer_id) const {
+    const Shard& shard = shardFor(peer_id);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.sessions.find(peer_id);
+    return it != shard.sessions.end() ? it->second : nullptr;
+}
+
+PeerSessionPtr PeerRegistry::insert(PeerSessionPtr session) {
+    Shard& shard = shardFor(session->peer_id);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    PeerSessionPtr& slot = shard.sessions[session->peer_id];
+    PeerSessionPtr previous = std::move(slot);
+    slot = std::move(session);
+    return previous;
+}
+
+PeerSessionPtr PeerRegistry::remove(const std::string& peer_id) {
+    Shard& shard = shardFor(peer_id);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.sessions.find(peer_id);
+    if (it == shard.sessions.end()) {
+        return nullptr;
+    }
+    PeerSessionPtr session = std::move(it->second);
+    shard.sessions.erase(it);
+    return session;
+}
+
+std::vector<PeerSessionPtr> PeerRegistry::snapshot() const {
+    std::vector<PeerSessionPtr> sessions;
+    for (const Shard& shard : shards_) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        for (const auto& entry : shard.sessions) {
+            sessions.push_back(entry.second);
+        }
+    }
+    return sessions;
+}
+
+size_t PeerRegistry::size() const {
+    size_t count = 0;
+    for (const Shard& shard : shards_) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        count += shard.sessions.size();
+    }
+    return count;
+}
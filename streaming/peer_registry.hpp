@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <rtc/rtc.hpp>
+#include <json/json.h>
+
+#include "access_unit.hpp"
+#include "pacing.hpp"
+#include "rtcp_stats.hpp"
+#include "sei_timestamp.hpp"
+#include "session_timeline.hpp"
+#include "stream_scheduler.hpp"
+
+class PlaybackControl;
+
+// RTP state of a peer's video track (libdatachannel media handler chain).
+//
+// Streams on different scheduler workers can send on the same track for a
+// moment while one replaces the other, so sendAccessUnit() holds `mutex`
+// for the whole unit: the scratch buffers, the RTP clock below and
+// rtp_config's timestamp are only used under it.
+struct VideoSender {
+    std::shared_ptr<rtc::RtpPacketizationConfig> rtp_config;
+    SeiTimestampMode sei_mode = SeiTimestampMode::Off;
+    std::mutex mutex;
+    rtc::binary buffer;  // length-prefixed NALs of the access unit being sent
+    std::vector<uint8_t> sei;     // timestamp SEI of the access unit being sent
+    std::vector<NalView> nals;    // access unit with the SEI spliced in
+    std::atomic<bool> keyframe_requested{false};  // PLI from the receiver, for live encoders
+    std::shared_ptr<SessionTimeline> timeline;    // marked on the first packet sent
+    std::shared_ptr<RtcpStatsHandler> rtcp_stats; // RTP sent, sender reports, RTCP received
+
+    std::atomic<uint64_t> frames_sent{0};
+    std::atomic<uint64_t> send_failures{0};
+
+    // Every stream that starts on the track takes a new generation. Its first
+    // unit is rebased one frame after the last unit the track sent, so RTP
+    // timestamps keep increasing on the SSRC however often the stream is
+    // replaced; units a replaced stream still had in flight are dropped.
+    std::atomic<uint64_t> generation{0};
+    uint64_t beginStream() { return ++generation; }
+
+    // RTP clock, guarded by `mutex`
+    uint64_t clock_generation = 0;
+    double clock_offset = 0.0;        // seconds added to the current stream's pts
+    double last_clock = -1.0;         // latest track time sent, seconds; negative before the first unit
+    double frame_step = 1.0 / 30.0;   // spacing of the last two units sent
+};
+
+// One camera of a session: its own video track, RTP sender and stream.
+//
+// index, mid, track, sender and source are set up by handleOffer() and never
+// reassigned. The streaming state below them is guarded by the owning
+// session's `mutex`.
+struct CameraTrack {
+    CameraTrack(size_t i, std::string media_id) : index(i), mid(std::move(media_id)) {}
+
+    const size_t index;                       // position in the session, 0 = primary camera
+    const std::string mid;                    // the offer's media id for it, e.g. "video1"
+    std::shared_ptr<rtc::Track> track;
+    std::shared_ptr<VideoSender> sender;
+    std::string source;                       // file it plays when activated; "" for a test pattern
+
+    bool active = true;                       // the client wants this camera streamed
+    StreamScheduler::StreamId stream = 0;     // current stream or pending start
+    std::shared_ptr<PacingScheduler> pacer;   // of the current file/image stream
+    std::shared_ptr<PlaybackControl> playback;  // seek/loop/rate of the current file stream
+    std::string file_path;                    // file of the current file stream
+    std::string broadcast_key;                // broadcast the camera shows, if any
+};
+using CameraTrackPtr = std::shared_ptr<CameraTrack>;
+
+// Everything known about one remote peer.
+//
+// pc, cameras, control_channel and timeline are filled in by handleOffer() before the
+// session is inserted into the registry and are never reassigned, so any
+// thread holding the session reads them without locking. The streaming and
+// ICE state below them changes at runtime and is guarded by `mutex`.
+struct PeerSession {
+    explicit PeerSession(std::string id) : peer_id(std::move(id)) {}
+
+    // Null for an index the session has no track for
+    CameraTrackPtr camera(size_t index) const { return index < cameras.size() ? cameras[index] : nullptr; }
+
+    const std::string peer_id;
+    std::shared_ptr<rtc::PeerConnection> pc;
+    std::vector<CameraTrackPtr> cameras;      // one video track each, bundled on pc's transport
+    std::shared_ptr<rtc::DataChannel> control_channel;  // null if the offer has no data section
+    std::shared_ptr<SessionTimeline> timeline;
+
+    std::mutex mutex;
+    StreamScheduler::StreamId telemetry = 0;  // periodic telemetry on the control channel
+    Json::Value local_candidates{Json::arrayValue};  // gathered, not yet published
+    bool candidate_flush_pending = false;     // a trickle publish is scheduled
+    std::string offer_origin;                 // sess-id of the offer's o= line
+    uint64_t offer_version = 0;               // sess-version of the applied offer
+    std::string remote_ufrag;                 // ICE ufrag of the applied offer
+};
+using PeerSessionPtr = std::shared_ptr<PeerSession>;
+
+// Peer sessions keyed by peer ID, shared by the MQTT thread, libdatachannel
+// callbacks and the stream scheduler.
+//
+// The map is split into shards, each behind its own reader-writer lock, so
+// lookups only take a shared lock on one shard and never wait for signaling
+// on other peers. Callers get a shared_ptr: a session stays valid for as
+// long as someone uses it, even after it was removed or replaced.
+class PeerRegistry {
+public:
+    PeerSessionPtr find(const std::string& peer_id) const;
+
+    // Inserts or replaces; returns the session it replaced, if any
+    PeerSessionPtr insert(PeerSessionPtr session);
+
+    // Returns the removed session, if any
+    PeerSessionPtr remove(const std::string& peer_id);
+
+    std::vector<PeerSessionPtr> snapshot() const;
+    size_t size() const;
+
+private:
+    static constexpr size_t kShards = 16;
+
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<std::string, PeerSessionPtr> sessions;
+    };
+    std::array<Shard, kShards> shards_;
+
+    const Shard& shardFor(const std::string& peer_id) const;
+    Shard& shardFor(const std::string& peer_id);
+};
@@ -22,10 +22,13 @@ cp -v "$LATEST_DIR"/*.mp4 ./videos/ 2>/dev/null || {
     echo "⚠️ No MP4 files found in $LATEST_DIR"
 }
 
+# Raw H.264 streams written by the bag processor's passthrough mode
+cp -v "$LATEST_DIR"/*.h264 ./videos/ 2>/dev/null || true
+
 # List copied files
 echo ""
 echo "✅ Video files ready for Docker build:"
-ls -lh ./videos/*.mp4 2>/dev/null || echo "No video files found"
+ls -lh ./videos/*.mp4 ./videos/*.h264 2>/dev/null | grep . || echo "No video files found"
 
 echo ""
 echo "Ready to build Docker image with embedded videos!"
\ No newline at end of file
@@ -0,0 +1,237 @@
+#include "rtcp_stats.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr uint8_t kSenderReport = 200;
+constexpr uint8_t kReceiverReport = 201;
+constexpr uint8_t kSourceDescription = 202;
+constexpr uint8_t kTransportFeedback = 205;  // RTPFB, FMT 1 = generic NACK
+constexpr uint8_t kPayloadFeedback = 206;    // PSFB, FMT 1 = PLI
+constexpr size_t kReportBlockSize = 24;
+
+uint16_t read16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] << 8 | p[1]);
+}
+
+uint32_t read32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 |
+           static_cast<uint32_t>(p[2]) << 8 | p[3];
+}
+
+// RTCP and RTP share the transport; RTCP packet types sit in 192..223 (RFC 5761)
+bool isRtcp(const rtc::Message& message) {
+    if (message.size() < 8) {
+        return false;
+    }
+    uint8_t type = std::to_integer<uint8_t>(message[1]);
+    return type >= 192 && type <= 223;
+}
+
+// Calls fn(type, count, packet, size) for each packet of a compound RTCP message
+template <typename Fn>
+void forEachRtcp(const rtc::Message& message, Fn fn) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(message.data());
+    const uint8_t* end = p + message.size();
+    while (end - p >= 4) {
+        if ((p[0] >> 6) != 2) {
+            return;
+        }
+        size_t size = (static_cast<size_t>(read16(p + 2)) + 1) * 4;
+        if (size > static_cast<size_t>(end - p)) {
+            return;
+        }
+        fn(p[1], p[0] & 0x1f, p, size);
+        p += size;
+    }
+}
+
+void write16(uint8_t* p, uint32_t value) {
+    p[0] = static_cast<uint8_t>(value >> 8);
+    p[1] = static_cast<uint8_t>(value);
+}
+
+void write32(uint8_t* p, uint32_t value) {
+    write16(p, value >> 16);
+    write16(p + 2, value);
+}
+
+// Payload bytes of an RTP packet: without header, CSRCs, extension and padding
+size_t rtpPayloadSize(const uint8_t* p, size_t size) {
+    size_t header = 12 + 4 * (p[0] & 0x0f);
+    if ((p[0] & 0x10) && header + 4 <= size) {
+        header += 4 + 4 * static_cast<size_t>(read16(p + header + 2));
+    }
+    size_t padding = (p[0] & 0x20) ? p[size - 1] : 0;
+    return size > header + padding ? size - header - padding : 0;
+}
+
+}  // namespace
+
+RtcpStatsHandler::RtcpStatsHandler(uint32_t ssrc, uint32_t clock_rate, std::string cname)
+    : ssrc_(ssrc), clock_rate_(clock_rate), cname_(std::move(cname)), window_start_(Clock::now()) {}
+
+void RtcpStatsHandler::requestReport() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    report_requested_ = true;
+}
+
+uint32_t RtcpStatsHandler::lastReportedTimestamp() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_report_rtp_;
+}
+
+void RtcpStatsHandler::outgoing(rtc::message_vector& messages, const rtc::message_callback& send) {
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool have_rtp = false;
+    uint32_t rtp_timestamp = 0;
+    for (const rtc::message_ptr& message : messages) {
+        if (!message || message->size() < 12 || isRtcp(*message)) {
+            continue;
+        }
+        const uint8_t* packet = reinterpret_cast<const uint8_t*>(message->data());
+        stats_.rtp_packets++;
+        stats_.rtp_bytes += message->size();
+        payload_octets_ += rtpPayloadSize(packet, message->size());
+        window_bytes_ += message->size();
+        rtp_timestamp = read32(packet + 4);
+        have_rtp = true;
+    }
+
+    // The SR maps the RTP time of the unit going out now to the wall clock
+    if (report_requested_ && have_rtp) {
+        report_requested_ = false;
+        last_report_rtp_ = rtp_timestamp;
+        send(makeSenderReport(rtp_timestamp, now));
+    }
+
+    double elapsed = std::chrono::duration<double>(now - window_start_).count();
+    if (elapsed >= 1.0) {
+        stats_.bitrate_kbps = window_bytes_ * 8.0 / elapsed / 1000.0;
+        window_bytes_ = 0;
+        window_start_ = now;
+    }
+}
+
+rtc::message_ptr RtcpStatsHandler::makeSenderReport(uint32_t rtp_timestamp, Clock::time_point now) {
+    // NTP time: seconds since 1900 and a 32-bit binary fraction
+    constexpr uint64_t kNtpUnixOffset = 2208988800ull;
+    auto since_epoch = std::chrono::system_clock::now().time_since_epoch();
+    uint64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(since_epoch).count();
+    uint32_t ntp_seconds = static_cast<uint32_t>(micros / 1000000 + kNtpUnixOffset);
+    uint32_t ntp_fraction = static_cast<uint32_t>(((micros % 1000000) << 32) / 1000000);
+
+    // SR without report blocks, then SDES with one CNAME chunk (RFC 3550 6.4.1, 6.5)
+    const size_t cname_size = std::min<size_t>(cname_.size(), 255);
+    const size_t sr_size = 28;
+    const size_t sdes_size = (8 + 2 + cname_size + 1 + 3) / 4 * 4;  // null-terminated, 32-bit aligned
+    auto message = rtc::make_message(sr_size + sdes_size, rtc::Message::Control);
+    uint8_t* p = reinterpret_cast<uint8_t*>(message->data());
+    std::memset(p, 0, message->size());
+
+    p[0] = 0x80;
+    p[1] = kSenderReport;
+    write16(p + 2, sr_size / 4 - 1);
+    write32(p + 4, ssrc_);
+    write32(p + 8, ntp_seconds);
+    write32(p + 12, ntp_fraction);
+    write32(p + 16, rtp_timestamp);
+    write32(p + 20, static_cast<uint32_t>(stats_.rtp_packets));
+    write32(p + 24, static_cast<uint32_t>(payload_octets_));
+
+    uint8_t* sdes = p + sr_size;
+    sdes[0] = 0x81;
+    sdes[1] = kSourceDescription;
+    write16(sdes + 2, sdes_size / 4 - 1);
+    write32(sdes + 4, ssrc_);
+    sdes[8] = 1;  // CNAME
+    sdes[9] = static_cast<uint8_t>(cname_size);
+    std::memcpy(sdes + 10, cname_.data(), cname_size);
+
+    // Receivers echo the middle 32 bits of the NTP timestamp as LSR
+    sent_reports_[next_report_++ % kSentReports] = {ntp_seconds << 16 | ntp_fraction >> 16, now};
+    return message;
+}
+
+void RtcpStatsHandler::incoming(rtc::message_vector& messages, const rtc::message_callback& /*send*/) {
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const rtc::message_ptr& message : messages) {
+        if (!message || !isRtcp(*message)) {
+            continue;
+        }
+        forEachRtcp(*message, [&](uint8_t type, int, const uint8_t* packet, size_t size) {
+            if (type == kSenderReport || type == kReceiverReport) {
+                onReport(packet, size, now);
+            } else if (type == kTransportFeedback || type == kPayloadFeedback) {
+                onFeedback(packet, size);
+            }
+        });
+    }
+}
+
+void RtcpStatsHandler::onReport(const uint8_t* packet, size_t size, Clock::time_point now) {
+    // SR: header, SSRC, 20 bytes of sender info, then report blocks; RR: no sender info
+    size_t offset = packet[1] == kSenderReport ? 28 : 8;
+    int blocks = packet[0] & 0x1f;
+    stats_.receiver_reports++;
+    for (int i = 0; i < blocks && offset + kReportBlockSize <= size; i++, offset += kReportBlockSize) {
+        if (read32(packet + offset) == ssrc_) {
+            onReportBlock(packet + offset, now);
+        }
+    }
+}
+
+void RtcpStatsHandler::onReportBlock(const uint8_t* block, Clock::time_point now) {
+    stats_.fraction_lost = block[4] / 256.0;
+    int32_t lost = static_cast<int32_t>(read32(block + 4) & 0x00ffffff);
+    if (lost & 0x00800000) {
+        lost -= 0x01000000;  // 24-bit signed
+    }
+    stats_.packets_lost = lost;
+    stats_.jitter_ms = read32(block + 12) * 1000.0 / clock_rate_;
+
+    uint32_t lsr = read32(block + 16);
+    uint32_t dlsr = read32(block + 20);
+    if (lsr == 0) {
+        return;  // no SR received yet
+    }
+    for (const SentReport& report : sent_reports_) {
+        if (report.ntp_middle == lsr && report.sent != Clock::time_point()) {
+            double rtt = std::chrono::duration<double>(now - report.sent).count() - dlsr / 65536.0;
+            if (rtt >= 0.0) {
+                stats_.rtt_ms = rtt * 1000.0;
+            }
+            return;
+        }
+    }
+}
+
+void RtcpStatsHandler::onFeedback(const uint8_t* packet, size_t size) {
+    // Header, sender SSRC, media SSRC, then the feedback control information
+    if (size < 12 || read32(packet + 8) != ssrc_) {
+        return;
+    }
+    int format = packet[0] & 0x1f;
+    if (packet[1] == kPayloadFeedback && format == 1) {
+        stats_.pli_requests++;
+    } else if (packet[1] == kTransportFeedback && format == 1) {
+        stats_.nack_requests++;
+        for (size_t offset = 12; offset + 4 <= size; offset += 4) {
+            // PID plus a bitmask of the 16 packets after it
+            stats_.nacked_packets += 1 + __builtin_popcount(read16(packet + offset + 2));
+        }
+    }
+}
+
+RtcpStats RtcpStatsHandler::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    RtcpStats stats = stats_;
+    if (Clock::now() - window_start_ > std::chrono::seconds(2)) {
+        stats.bitrate_kbps = 0.0;  // nothing sent for a while
+    }
+    return stats;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include <rtc/rtc.hpp>
+
+// Transport figures of one outgoing video track
+struct RtcpStats {
+    uint64_t rtp_packets = 0;     // RTP packets handed to the transport
+    uint64_t rtp_bytes = 0;       // including RTP headers
+    double bitrate_kbps = 0.0;    // over the last full second, 0 once sending stalls
+    uint64_t receiver_reports = 0;
+    uint64_t nack_requests = 0;   // generic NACK feedback messages
+    uint64_t nacked_packets = 0;  // packets those messages asked for again
+    uint64_t pli_requests = 0;
+    double rtt_ms = -1.0;         // negative until a report echoes one of our SRs
+    double fraction_lost = 0.0;   // 0..1, from the last receiver report
+    int64_t packets_lost = 0;     // cumulative, as reported by the receiver
+    double jitter_ms = 0.0;       // interarrival jitter seen by the receiver
+};
+
+// Last link of a track's media handler chain: counts the RTP it sends, sends
+// the track's RTCP sender reports and reads the receiver's RTCP (reports,
+// NACK, PLI) without consuming it.
+//
+// RTT comes from the LSR/DLSR fields of receiver reports, matched against
+// the sender reports this handler sent. It builds those itself: an SR sent
+// through the chain's send callback (as rtc::RtcpSrReporter does) goes
+// straight to the transport, so no handler would ever see it go out.
+class RtcpStatsHandler : public rtc::MediaHandler {
+public:
+    RtcpStatsHandler(uint32_t ssrc, uint32_t clock_rate, std::string cname);
+
+    void incoming(rtc::message_vector& messages, const rtc::message_callback& send) override;
+    void outgoing(rtc::message_vector& messages, const rtc::message_callback& send) override;
+
+    // Sends a sender report (with an SDES CNAME) along with the next RTP packets
+    void requestReport();
+    // RTP timestamp of the last sender report, 0 before the first
+    uint32_t lastReportedTimestamp() const;
+
+    RtcpStats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Middle 32 bits of a sent SR's NTP timestamp, and when it left
+    struct SentReport {
+        uint32_t ntp_middle = 0;
+        Clock::time_point sent;
+    };
+    static constexpr size_t kSentReports = 8;
+
+    const uint32_t ssrc_;
+    const uint32_t clock_rate_;
+    const std::string cname_;
+
+    mutable std::mutex mutex_;
+    RtcpStats stats_;
+    uint64_t payload_octets_ = 0;  // RTP payload bytes, the SR's octet count
+    bool report_requested_ = false;
+    uint32_t last_report_rtp_ = 0;
+    Clock::time_point window_start_;
+    uint64_t window_bytes_ = 0;
+    std::array<SentReport, kSentReports> sent_reports_{};
+    size_t next_report_ = 0;
+
+    // Caller holds mutex_
+    rtc::message_ptr makeSenderReport(uint32_t rtp_timestamp, Clock::time_point now);
+    void onReport(const uint8_t* packet, size_t size, Clock::time_point now);
+    void onFeedback(const uint8_t* packet, size_t size);
+    void onReportBlock(const uint8_t* block, Clock::time_point now);
+};
@@ -0,0 +1,65 @@
+#include "sei_timestamp.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "annexb.hpp"
+
+bool parseSeiTimestampMode(const std::string& text, SeiTimestampMode& mode) {
+    std::string lower = text;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    if (lower == "off" || lower == "none" || lower.empty()) {
+        mode = SeiTimestampMode::Off;
+    } else if (lower == "wallclock" || lower == "send") {
+        mode = SeiTimestampMode::WallClock;
+    } else if (lower == "capture") {
+        mode = SeiTimestampMode::Capture;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* toString(SeiTimestampMode mode) {
+    switch (mode) {
+        case SeiTimestampMode::WallClock: return "wallclock";
+        case SeiTimestampMode::Capture: return "capture";
+        default: return "off";
+    }
+}
+
+SeiTimestampMode defaultSeiTimestampMode() {
+    SeiTimestampMode mode = SeiTimestampMode::Off;
+    const char* env = std::getenv("SEI_TIMESTAMP");
+    if (env && !parseSeiTimestampMode(env, mode)) {
+        std::cout << "⚠️  Ignoring unknown SEI_TIMESTAMP value: " << env << std::endl;
+    }
+    return mode;
+}
+
+int64_t wallClockMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void buildTimestampSei(int64_t timestamp_ms, std::vector<uint8_t>& nal) {
+    const std::string user_data = "timestamp=" + std::to_string(timestamp_ms);
+
+    // sei_message(): payloadType and payloadSize are ff-escaped byte counts
+    std::vector<uint8_t> rbsp;
+    rbsp.reserve(user_data.size() + 4);
+    rbsp.push_back(5);  // user_data_unregistered
+    size_t size = user_data.size();
+    for (; size >= 255; size -= 255) {
+        rbsp.push_back(0xFF);
+    }
+    rbsp.push_back(static_cast<uint8_t>(size));
+    rbsp.insert(rbsp.end(), user_data.begin(), user_data.end());
+    rbsp.push_back(0x80);  // rbsp_trailing_bits
+
+    nal.clear();
+    nal.push_back(0x06);  // nal_ref_idc 0, nal_unit_type 6 (SEI)
+    annexb::escapeRbsp(rbsp.data(), rbsp.size(), nal);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Glass-to-glass latency probe: a user_data_unregistered SEI (payloadType 5)
+// whose user data is the ASCII text "timestamp=<unix ms>", the format the RMCS
+// decoder reads (see NOTE.md). The NAL is emulation-prevented, so timestamps
+// whose bytes look like a start code cannot break the stream.
+enum class SeiTimestampMode {
+    Off,
+    WallClock,  // time the access unit is handed to the RTP packetizer
+    Capture     // time the frame was captured, when the source knows it
+};
+
+// Parses "off" / "wallclock" / "capture" (case-insensitive)
+bool parseSeiTimestampMode(const std::string& text, SeiTimestampMode& mode);
+const char* toString(SeiTimestampMode mode);
+
+// Mode for peers whose offer does not choose one: $SEI_TIMESTAMP, else Off
+SeiTimestampMode defaultSeiTimestampMode();
+
+// Milliseconds since the Unix epoch on the system clock
+int64_t wallClockMillis();
+
+// Replaces nal with a complete SEI NAL unit (header included, no start code)
+void buildTimestampSei(int64_t timestamp_ms, std::vector<uint8_t>& nal);
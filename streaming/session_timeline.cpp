@@ -0,0 +1,142 @@
+#include "session_timeline.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Microsecond resolution is plenty for setup steps and keeps the JSON short
+double roundMillis(double ms) {
+    return std::round(ms * 1000.0) / 1000.0;
+}
+
+// Time between two milestones, or null if either is missing
+Json::Value stage(const SessionTimeline& timeline, Milestone from, Milestone to) {
+    double start = timeline.millis(from);
+    double end = timeline.millis(to);
+    if (start < 0.0 || end < 0.0) {
+        return Json::Value();
+    }
+    return roundMillis(std::max(0.0, end - start));
+}
+
+double percentile(std::vector<double>& sorted, double fraction) {
+    size_t rank = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+    return roundMillis(sorted[std::min(rank, sorted.size() - 1)]);
+}
+
+}  // namespace
+
+const char* toString(Milestone milestone) {
+    switch (milestone) {
+        case Milestone::OfferReceived: return "offer_received";
+        case Milestone::RemoteDescriptionSet: return "remote_description_set";
+        case Milestone::AnswerPublished: return "answer_published";
+        case Milestone::FirstLocalCandidate: return "first_local_candidate";
+        case Milestone::LastLocalCandidate: return "last_local_candidate";
+        case Milestone::IceConnected: return "ice_connected";
+        case Milestone::DtlsConnected: return "dtls_connected";
+        case Milestone::TrackOpen: return "track_open";
+        case Milestone::FirstMediaSent: return "first_media_sent";
+        case Milestone::Count: break;
+    }
+    return "unknown";
+}
+
+SessionTimeline::SessionTimeline(Clock::time_point offer_received) : start_(offer_received) {
+    for (auto& offset : offsets_ns_) {
+        offset = 0;
+    }
+    offsets_ns_[static_cast<size_t>(Milestone::OfferReceived)] = 1;
+}
+
+bool SessionTimeline::mark(Milestone milestone, Clock::time_point at) {
+    int64_t offset = std::chrono::duration_cast<std::chrono::nanoseconds>(at - start_).count();
+    int64_t value = std::max<int64_t>(offset, 0) + 1;
+    auto& slot = offsets_ns_[static_cast<size_t>(milestone)];
+
+    if (milestone == Milestone::LastLocalCandidate) {
+        slot = value;
+        return true;
+    }
+    int64_t unset = 0;
+    if (!slot.compare_exchange_strong(unset, value)) {
+        return false;
+    }
+    if (milestone == Milestone::FirstMediaSent && completion_) {
+        completion_(*this);
+    }
+    return true;
+}
+
+bool SessionTimeline::reached(Milestone milestone) const {
+    return offsets_ns_[static_cast<size_t>(milestone)] != 0;
+}
+
+double SessionTimeline::millis(Milestone milestone) const {
+    int64_t value = offsets_ns_[static_cast<size_t>(milestone)];
+    return value ? (value - 1) / 1e6 : -1.0;
+}
+
+Json::Value SessionTimeline::toJson(const std::string& outcome) const {
+    Json::Value json;
+    json["outcome"] = outcome;
+
+    Json::Value milestones(Json::objectValue);
+    for (size_t i = 0; i < kMilestoneCount; i++) {
+        Milestone milestone = static_cast<Milestone>(i);
+        milestones[toString(milestone)] = reached(milestone) ? Json::Value(roundMillis(millis(milestone))) : Json::Value();
+    }
+    json["milestones_ms"] = milestones;
+
+    // Where the time went: signaling, ICE, DTLS, track setup, first frame
+    Json::Value stages(Json::objectValue);
+    stages["sdp"] = stage(*this, Milestone::OfferReceived, Milestone::RemoteDescriptionSet);
+    stages["answer"] = stage(*this, Milestone::RemoteDescriptionSet, Milestone::AnswerPublished);
+    stages["ice_gathering"] = stage(*this, Milestone::AnswerPublished, Milestone::LastLocalCandidate);
+    stages["ice_connect"] = stage(*this, Milestone::AnswerPublished, Milestone::IceConnected);
+    stages["dtls"] = stage(*this, Milestone::IceConnected, Milestone::DtlsConnected);
+    stages["track_open"] = stage(*this, Milestone::DtlsConnected, Milestone::TrackOpen);
+    stages["first_media"] = stage(*this, Milestone::TrackOpen, Milestone::FirstMediaSent);
+    json["stages_ms"] = stages;
+    return json;
+}
+
+void TimelineStats::add(const SessionTimeline& timeline) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sessions_++;
+    for (size_t i = 0; i < kMilestoneCount; i++) {
+        double value = timeline.millis(static_cast<Milestone>(i));
+        if (value < 0.0) {
+            continue;
+        }
+        std::vector<double>& samples = samples_[i];
+        if (samples.size() < kWindow) {
+            samples.push_back(value);
+        } else {
+            samples[next_[i]] = value;
+        }
+        next_[i] = (next_[i] + 1) % kWindow;
+    }
+}
+
+Json::Value TimelineStats::toJson() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Json::Value json;
+    json["sessions"] = static_cast<Json::UInt64>(sessions_);
+    for (size_t i = 0; i < kMilestoneCount; i++) {
+        std::vector<double> sorted = samples_[i];
+        if (sorted.empty()) {
+            continue;
+        }
+        std::sort(sorted.begin(), sorted.end());
+        Json::Value entry;
+        entry["count"] = static_cast<Json::UInt64>(sorted.size());
+        entry["p50"] = percentile(sorted, 0.50);
+        entry["p95"] = percentile(sorted, 0.95);
+        entry["p99"] = percentile(sorted, 0.99);
+        entry["max"] = roundMillis(sorted.back());
+        json[toString(static_cast<Milestone>(i))] = entry;
+    }
+    return json;
+}
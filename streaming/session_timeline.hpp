@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <json/json.h>
+
+// Connection-setup steps of one peer session, in the order they normally happen
+enum class Milestone {
+    OfferReceived,
+    RemoteDescriptionSet,
+    AnswerPublished,
+    FirstLocalCandidate,
+    LastLocalCandidate,
+    IceConnected,
+    DtlsConnected,
+    TrackOpen,
+    FirstMediaSent,
+    Count
+};
+constexpr size_t kMilestoneCount = static_cast<size_t>(Milestone::Count);
+
+// snake_case name used in logs and JSON
+const char* toString(Milestone milestone);
+
+// Monotonic timestamps of a session's milestones, relative to the offer.
+//
+// Milestones are marked from the MQTT thread, libdatachannel callbacks and
+// the send path, so every slot is a lock-free atomic. A milestone keeps its
+// first mark, except LastLocalCandidate which moves with every candidate.
+// Marking FirstMediaSent runs the completion callback once.
+class SessionTimeline {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Completion = std::function<void(SessionTimeline& timeline)>;
+
+    explicit SessionTimeline(Clock::time_point offer_received = Clock::now());
+
+    // Set before the session is shared; called on the thread that sends the first packet
+    void onComplete(Completion completion) { completion_ = std::move(completion); }
+
+    // True if this call recorded the milestone
+    bool mark(Milestone milestone, Clock::time_point at = Clock::now());
+
+    bool reached(Milestone milestone) const;
+
+    // Milliseconds since the offer was received, or -1 if not reached
+    double millis(Milestone milestone) const;
+
+    // Claims the right to publish this timeline; true exactly once
+    bool claimPublish() { return !published_.exchange(true); }
+
+    // {"outcome", "milestones_ms": {...}, "stages_ms": {...}}
+    Json::Value toJson(const std::string& outcome) const;
+
+private:
+    Clock::time_point start_;
+    std::array<std::atomic<int64_t>, kMilestoneCount> offsets_ns_;  // 0 = not reached, else offset + 1
+    std::atomic<bool> published_{false};
+    Completion completion_;
+};
+
+// Percentiles of every milestone over the most recent sessions
+class TimelineStats {
+public:
+    void add(const SessionTimeline& timeline);
+
+    // {"sessions": n, "<milestone>": {"p50", "p95", "p99", "max", "count"}, ...}
+    Json::Value toJson() const;
+
+private:
+    static constexpr size_t kWindow = 512;  // sessions kept per milestone
+
+    mutable std::mutex mutex_;
+    uint64_t sessions_ = 0;
+    std::array<std::vector<double>, kMilestoneCount> samples_;  // ring buffers
+    std::array<size_t, kMilestoneCount> next_{};
+};
@@ -0,0 +1,247 @@
+#include "stream_scheduler.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace {
+
+// Adapts a callback to a stream: repeating every period until it returns false
+class FunctionStream : public ScheduledStream {
+public:
+    FunctionStream(Clock::duration period, std::function<bool()> fn) : period_(period), fn_(std::move(fn)) {}
+
+    bool step(Clock::time_point& next_due) override {
+        if (!fn_()) {
+            return false;
+        }
+        next_due = Clock::now() + period_;
+        return true;
+    }
+
+private:
+    Clock::duration period_;
+    std::function<bool()> fn_;
+};
+
+}  // namespace
+
+StreamScheduler::StreamScheduler(size_t threads) {
+    for (size_t i = 0; i < std::max<size_t>(threads, 1); i++) {
+        std::unique_ptr<Worker> worker(new Worker());
+        worker->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        worker->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (worker->epoll_fd < 0 || worker->wake_fd < 0) {
+            std::cerr << "❌ Failed to create stream scheduler worker" << std::endl;
+            continue;
+        }
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr;  // nullptr marks the wake fd
+        epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->wake_fd, &event);
+
+        Worker* raw = worker.get();
+        worker->thread = std::thread([this, raw]() { run(*raw); });
+        workers_.push_back(std::move(worker));
+    }
+    std::cout << "⏲️  Stream scheduler started with " << workers_.size() << " worker(s)" << std::endl;
+}
+
+StreamScheduler::~StreamScheduler() {
+    stopping_ = true;
+    for (auto& worker : workers_) {
+        uint64_t one = 1;
+        ssize_t written = write(worker->wake_fd, &one, sizeof(one));
+        (void)written;
+    }
+    for (auto& worker : workers_) {
+        worker->thread.join();
+    }
+
+    // Whatever is left never gets another step
+    std::map<StreamId, std::shared_ptr<Task>> remaining;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        remaining.swap(tasks_);
+    }
+    for (auto& entry : remaining) {
+        close(entry.second->timer_fd);
+        entry.second->stream->finish();
+    }
+    for (auto& worker : workers_) {
+        close(worker->epoll_fd);
+        close(worker->wake_fd);
+    }
+}
+
+size_t StreamScheduler::defaultThreadCount() {
+    const char* env = std::getenv("STREAM_SCHEDULER_THREADS");
+    if (env && std::atoi(env) > 0) {
+        return static_cast<size_t>(std::atoi(env));
+    }
+    return std::min<size_t>(4, std::max<size_t>(1, std::thread::hardware_concurrency() / 2));
+}
+
+bool StreamScheduler::arm(int timer_fd, Clock::time_point due) {
+    auto since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(due.time_since_epoch()).count();
+    itimerspec spec{};
+    spec.it_value.tv_sec = since_epoch / 1000000000;
+    spec.it_value.tv_nsec = since_epoch % 1000000000;
+    if (spec.it_value.tv_sec <= 0 && spec.it_value.tv_nsec <= 0) {
+        spec.it_value.tv_nsec = 1;  // an all-zero it_value would disarm the timer
+    }
+    // A deadline already in the past fires immediately
+    return timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr) == 0;
+}
+
+StreamScheduler::StreamId StreamScheduler::add(std::shared_ptr<ScheduledStream> stream, Clock::time_point first_due) {
+    if (!stream || workers_.empty() || stopping_) {
+        return 0;
+    }
+
+    auto task = std::make_shared<Task>();
+    task->stream = std::move(stream);
+    task->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (task->timer_fd < 0) {
+        std::cerr << "❌ Failed to create stream timer" << std::endl;
+        return 0;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task->id = next_id_++;
+        // Least-loaded worker keeps streams spread evenly
+        Worker* worker = workers_.front().get();
+        for (auto& candidate : workers_) {
+            if (candidate->tasks < worker->tasks) {
+                worker = candidate.get();
+            }
+        }
+        task->worker = worker;
+        worker->tasks++;
+        tasks_[task->id] = task;
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = task.get();
+    epoll_ctl(task->worker->epoll_fd, EPOLL_CTL_ADD, task->timer_fd, &event);
+    arm(task->timer_fd, first_due);
+    return task->id;
+}
+
+StreamScheduler::StreamId StreamScheduler::every(Clock::duration period, std::function<bool()> fn,
+                                                 Clock::duration delay) {
+    return add(std::make_shared<FunctionStream>(period, std::move(fn)), Clock::now() + delay);
+}
+
+StreamScheduler::StreamId StreamScheduler::after(Clock::duration delay, std::function<void()> fn) {
+    return every(Clock::duration::zero(), [fn]() {
+        fn();
+        return false;
+    }, delay);
+}
+
+void StreamScheduler::cancel(StreamId id) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = tasks_.find(id);
+    if (it == tasks_.end()) {
+        return;
+    }
+    std::shared_ptr<Task> task = it->second;
+    task->cancelled = true;
+
+    // Only workers retire tasks, so fire the timer now and let the owner do it
+    if (!task->retiring) {
+        arm(task->timer_fd, Clock::now());
+    }
+    for (auto& worker : workers_) {
+        if (std::this_thread::get_id() == worker->thread.get_id()) {
+            return;  // a worker waiting on a worker could deadlock; retired on its next wakeup
+        }
+    }
+    retired_.wait(lock, [this, id]() { return tasks_.find(id) == tasks_.end() || stopping_; });
+}
+
+size_t StreamScheduler::activeStreams() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tasks_.size();
+}
+
+void StreamScheduler::run(Worker& worker) {
+    epoll_event events[64];
+    while (!stopping_) {
+        int count = epoll_wait(worker.epoll_fd, events, 64, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "❌ Stream scheduler epoll_wait failed" << std::endl;
+            return;
+        }
+        for (int i = 0; i < count && !stopping_; i++) {
+            Task* task = static_cast<Task*>(events[i].data.ptr);
+            if (!task) {
+                continue;  // wake fd: loop condition checks stopping_
+            }
+            uint64_t expirations;
+            ssize_t drained = read(task->timer_fd, &expirations, sizeof(expirations));
+            if (drained < 0) {
+                continue;  // spurious: re-armed since the event was queued
+            }
+            runTask(*task);
+        }
+    }
+}
+
+void StreamScheduler::runTask(Task& task) {
+    bool cancelled;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancelled = task.cancelled;
+    }
+
+    Clock::time_point next_due;
+    bool more = false;
+    if (!cancelled) {
+        try {
+            more = task.stream->step(next_due);
+        } catch (const std::exception& e) {
+            std::cerr << "❌ Error in scheduled stream: " << e.what() << std::endl;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (more && !task.cancelled) {
+            arm(task.timer_fd, next_due);
+            return;
+        }
+    }
+    retire(task);
+}
+
+void StreamScheduler::retire(Task& task) {
+    // The map holds the task; keep it alive until it is fully torn down
+    std::shared_ptr<Task> keep;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        keep = tasks_[task.id];
+        task.retiring = true;
+        task.worker->tasks--;
+    }
+    epoll_ctl(task.worker->epoll_fd, EPOLL_CTL_DEL, task.timer_fd, nullptr);
+    close(task.timer_fd);
+
+    // Outside the lock, so finish() may add or cancel other streams
+    task.stream->finish();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.erase(task.id);
+    retired_.notify_all();
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work driven by the StreamScheduler: a paced video stream, or any other
+// timed task. All state lives in the object, not on a thread's stack.
+class ScheduledStream {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    virtual ~ScheduledStream() = default;
+
+    // Called once the previously returned deadline has passed. Does whatever
+    // is due, sets next_due and returns true, or returns false when done.
+    virtual bool step(Clock::time_point& next_due) = 0;
+
+    // Called exactly once, on a worker thread, after the last step or on cancellation
+    virtual void finish() {}
+};
+
+// Drives every active stream from a fixed pool of worker threads, however
+// many peers there are. Each stream owns a timerfd armed on its next
+// absolute deadline (CLOCK_MONOTONIC, same clock as steady_clock); each
+// worker waits on its streams' timers with one epoll set. A step must not
+// block: it runs on a thread shared with other streams.
+class StreamScheduler {
+public:
+    using Clock = ScheduledStream::Clock;
+    using StreamId = uint64_t;
+
+    explicit StreamScheduler(size_t threads = defaultThreadCount());
+    ~StreamScheduler();
+
+    StreamScheduler(const StreamScheduler&) = delete;
+    StreamScheduler& operator=(const StreamScheduler&) = delete;
+
+    // Schedules stream's first step at first_due; returns 0 on failure
+    StreamId add(std::shared_ptr<ScheduledStream> stream, Clock::time_point first_due = Clock::now());
+
+    // Runs fn every period, starting after delay, until it returns false
+    StreamId every(Clock::duration period, std::function<bool()> fn, Clock::duration delay = Clock::duration::zero());
+
+    // Runs fn once after delay
+    StreamId after(Clock::duration delay, std::function<void()> fn);
+
+    // Stops a stream and, unless called from a worker thread, waits until a
+    // running step has returned and finish() has run. Unknown or already
+    // finished ids are ignored.
+    void cancel(StreamId id);
+
+    size_t activeStreams() const;
+    size_t threadCount() const { return workers_.size(); }
+
+    // $STREAM_SCHEDULER_THREADS, else half the cores clamped to [1, 4]
+    static size_t defaultThreadCount();
+
+private:
+    struct Worker;
+
+    struct Task {
+        StreamId id = 0;
+        int timer_fd = -1;
+        std::shared_ptr<ScheduledStream> stream;
+        Worker* worker = nullptr;
+        bool cancelled = false;  // guarded by mutex_
+        bool retiring = false;   // guarded by mutex_; timer_fd is being closed
+    };
+
+    struct Worker {
+        int epoll_fd = -1;
+        int wake_fd = -1;  // eventfd, wakes the loop for shutdown
+        size_t tasks = 0;  // guarded by mutex_
+        std::thread thread;
+    };
+
+    mutable std::mutex mutex_;
+    std::condition_variable retired_;
+    std::map<StreamId, std::shared_ptr<Task>> tasks_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    StreamId next_id_ = 1;
+    std::atomic<bool> stopping_{false};
+
+    void run(Worker& worker);
+    void runTask(Task& task);
+    void retire(Task& task);
+    static bool arm(int timer_fd, Clock::time_point due);
+};
@@ -0,0 +1,359 @@
+#include "video_streams.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#include "log.hpp"
+#include "sei_timestamp.hpp"
+
+int64_t captureTimeMillis(const std::string& image_path) {
+    size_t underscore = image_path.rfind('_');
+    size_t dot = image_path.rfind('.');
+    if (underscore == std::string::npos || dot == std::string::npos || dot <= underscore + 1) {
+        return 0;
+    }
+    char* end = nullptr;
+    std::string seconds = image_path.substr(underscore + 1, dot - underscore - 1);
+    double value = std::strtod(seconds.c_str(), &end);
+    return (end && *end == '\0' && value > 0.0) ? static_cast<int64_t>(value * 1000.0 + 0.5) : 0;
+}
+
+PlaybackControl::PlaybackControl() {
+    const char* env = std::getenv("STREAM_LOOP");
+    loop_ = env && std::string(env) == "1";
+}
+
+void PlaybackControl::continueFrom(const PlaybackControl& previous) {
+    loop_ = previous.loop();
+    rate_ = previous.rate();
+    paused_ = previous.paused();
+    start_clock_ = previous.next_clock_.load(std::memory_order_relaxed);
+    seek(previous.position());
+}
+
+void PlaybackControl::seek(double seconds) {
+    {
+        std::lock_guard<std::mutex> lock(seek_mutex_);
+        seek_pending_ = true;
+        seek_seconds_ = std::max(0.0, seconds);
+    }
+    version_++;
+}
+
+void PlaybackControl::setLoop(bool loop) {
+    loop_ = loop;
+    version_++;
+}
+
+void PlaybackControl::setRate(double rate) {
+    rate_ = std::min(kMaxRate, std::max(kMinRate, rate));
+    version_++;
+}
+
+void PlaybackControl::setPaused(bool paused) {
+    paused_ = paused;
+    version_++;
+}
+
+void PlaybackControl::requestKeyframe() {
+    keyframe_requested_ = true;
+    version_++;
+}
+
+bool PlaybackControl::takeSeek(double& seconds) {
+    std::lock_guard<std::mutex> lock(seek_mutex_);
+    if (!seek_pending_) {
+        return false;
+    }
+    seek_pending_ = false;
+    seconds = seek_seconds_;
+    return true;
+}
+
+void PlaybackControl::report(double position, double duration, double next_clock) {
+    position_.store(position, std::memory_order_relaxed);
+    duration_.store(duration, std::memory_order_relaxed);
+    next_clock_.store(next_clock, std::memory_order_relaxed);
+}
+
+FileStream::FileStream(std::string name, std::shared_ptr<const MediaSource> source,
+                       std::shared_ptr<AccessUnitOutput> output, std::shared_ptr<PacingScheduler> pacer,
+                       std::shared_ptr<PlaybackControl> control)
+    : name_(std::move(name)), source_(source), cursor_(source), output_(std::move(output)), pacer_(std::move(pacer)),
+      control_(std::move(control)), segment_media_(source_->toSeconds(source_->unitDts(0))) {}
+
+double FileStream::playbackSeconds(int64_t ticks) const {
+    return segment_play_ + (source_->toSeconds(ticks) - segment_media_) / rate_;
+}
+
+void FileStream::startSegment(size_t index) {
+    // The clock carries on one frame after the last unit sent
+    double origin = control_ ? control_->startClock() : 0.0;
+    segment_play_ = have_first_ ? last_play_ + source_->frameInterval() / rate_ : origin;
+    segment_media_ = source_->toSeconds(source_->unitDts(index));
+    segment_units_ = 0;
+    cursor_.seek(index);
+    pending_ = false;
+}
+
+void FileStream::applyControls() {
+    uint64_t version = control_->version();
+    if (version == control_version_) {
+        return;
+    }
+    control_version_ = version;
+
+    double rate = control_->rate();
+    if (rate != rate_) {
+        // Re-anchor at the next unit so its deadline, and the clock, do not jump
+        size_t next = std::min(cursor_.position(), source_->unitCount() - 1);
+        int64_t ticks = pending_ ? au_.dts : source_->unitDts(next);
+        segment_play_ = playbackSeconds(ticks);
+        segment_media_ = source_->toSeconds(ticks);
+        rate_ = rate;
+        std::cout << "⏩ " << name_ << " playing at " << rate_ << "x" << std::endl;
+    }
+
+    double seconds = 0.0;
+    if (control_->takeSeek(seconds)) {
+        size_t target = source_->keyframeAtOrBefore(source_->unitAtTime(seconds));
+        startSegment(target);
+        std::cout << "⏩ " << name_ << " seeking to " << seconds << "s: keyframe at unit " << target << " ("
+                  << source_->toSeconds(source_->unitDts(target) - source_->unitDts(0)) << "s)" << std::endl;
+    }
+
+    if (control_->takeKeyframeRequest() && !(pending_ && au_.keyframe)) {
+        size_t next = pending_ ? au_.index : cursor_.position();
+        size_t target = source_->keyframeAtOrAfter(next);
+        if (target < source_->unitCount()) {
+            startSegment(target);
+            std::cout << "🔑 " << name_ << " skipping to keyframe at unit " << target << std::endl;
+        }
+    }
+}
+
+bool FileStream::step(Clock::time_point& next_due) {
+    // Units are sent in decode order, so they are released on their DTS;
+    // every unit already due goes out in this wakeup
+    for (;;) {
+        if (!output_->active()) {
+            std::cout << "⚠️ Output closed, stopping stream " << name_ << std::endl;
+            return false;
+        }
+        if (control_) {
+            applyControls();
+            if (control_->paused()) {
+                if (!paused_) {
+                    paused_ = true;
+                    paused_at_ = Clock::now();
+                    std::cout << "⏸️  " << name_ << " paused" << std::endl;
+                }
+                next_due = Clock::now() + kPausePoll;
+                return true;
+            }
+            if (paused_) {
+                // The clock moves on by the pause, so pacing picks up where it left off
+                paused_ = false;
+                segment_play_ += std::chrono::duration<double>(Clock::now() - paused_at_).count();
+                if (pending_) {
+                    deadline_ = pacer_->schedule(playbackSeconds(au_.dts));
+                }
+                std::cout << "▶️  " << name_ << " resumed" << std::endl;
+            }
+        }
+        if (!pending_) {
+            if (!cursor_.next(au_)) {
+                // Loop only if the pass sent something, or a broken file would spin
+                if (!control_ || !control_->loop() || segment_units_ == 0) {
+                    return false;
+                }
+                std::cout << "🔁 " << name_ << " looping after " << units_ << " access units" << std::endl;
+                startSegment(0);
+                continue;
+            }
+            deadline_ = pacer_->schedule(playbackSeconds(au_.dts));
+            pending_ = true;
+        }
+        if (deadline_ > Clock::now()) {
+            next_due = deadline_;
+            return true;
+        }
+        pacer_->released(deadline_);
+        pending_ = false;
+
+        // RTP timestamps follow presentation time on the playback clock.
+        // A file has no capture clock; its frames are "captured" when playback presents them.
+        if (!have_first_) {
+            first_wall_ms_ = wallClockMillis() - static_cast<int64_t>(segment_play_ * 1000.0);
+            have_first_ = true;
+        }
+        double pts_seconds = playbackSeconds(au_.pts);
+        last_play_ = playbackSeconds(au_.dts);
+        output_->send(au_, pts_seconds, first_wall_ms_ + static_cast<int64_t>(pts_seconds * 1000.0), source_);
+        nals_ += au_.nal_units.size();
+        segment_units_++;
+        if (control_) {
+            control_->report(source_->toSeconds(au_.dts - source_->unitDts(0)), source_->duration(),
+                             last_play_ + source_->frameInterval() / rate_);
+        }
+
+        if (units_ % 30 == 0) {
+            LOG_INFO("📤 {}: sent access unit {} (dts {}s, pts {}s, {} NALs{})", name_, units_,
+                     source_->toSeconds(au_.dts), source_->toSeconds(au_.pts), au_.nal_units.size(),
+                     au_.keyframe ? ", keyframe" : "");
+        }
+        units_++;
+        if (units_ % 300 == 0) {
+            logPacingStats(name_, pacer_->stats());
+        }
+    }
+}
+
+void FileStream::finish() {
+    std::cout << "✅ H264 file streaming completed for " << name_ << " (" << units_ << " access units, "
+              << nals_ << " NAL units sent)" << std::endl;
+    logPacingStats(name_, pacer_->stats());
+    output_->close();
+}
+
+ImageStream::ImageStream(std::string name, std::vector<std::string> image_files, DecodePool& pool,
+                         std::shared_ptr<AccessUnitOutput> output, std::shared_ptr<PacingScheduler> pacer)
+    : name_(std::move(name)), prefetcher_(std::move(image_files), pool),
+      encoder_(H264EncoderConfig::fromEnvironment()), output_(std::move(output)), pacer_(std::move(pacer)) {}
+
+bool ImageStream::step(Clock::time_point& next_due) {
+    if (!opened_) {
+        if (!encoder_.open()) {
+            return false;
+        }
+        opened_ = true;
+        std::cout << "🎬 Starting " << encoder_.config().fps << " FPS image streaming for " << name_ << std::endl;
+    }
+    const int fps = encoder_.config().fps;
+
+    for (;;) {
+        if (!output_->active()) {
+            std::cout << "⚠️ Output closed, stopping stream " << name_ << std::endl;
+            return false;
+        }
+        if (!pending_) {
+            FramePrefetcher::PopResult result = prefetcher_.tryPop(frame_);
+            if (result == FramePrefetcher::PopResult::End) {
+                return false;
+            }
+            if (result == FramePrefetcher::PopResult::Pending) {
+                next_due = Clock::now() + kUnderrunRetry;
+                return true;
+            }
+            deadline_ = pacer_->schedule(static_cast<double>(frames_) / fps);
+            pending_ = true;
+        }
+        if (deadline_ > Clock::now()) {
+            next_due = deadline_;
+            return true;
+        }
+        pacer_->released(deadline_);
+        pending_ = false;
+
+        // A joining or PLI-ing viewer gets an IDR now instead of waiting out the GOP
+        if (output_->takeKeyframeRequest()) {
+            std::cout << "🔑 Keyframe requested for " << name_ << std::endl;
+            encoder_.requestKeyframe();
+        }
+        if (!encoder_.encode(frame_.image, frames_, au_)) {
+            continue;
+        }
+        // Encoder output is only valid until the next encode; outputs copy what they keep
+        output_->send(au_, static_cast<double>(au_.pts) / fps, captureTimeMillis(frame_.path), nullptr);
+
+        if (frames_ == 0) {
+            std::cout << "📤 Started sending frames (" << frame_.image.cols << "x" << frame_.image.rows << " -> "
+                      << encoder_.config().width << "x" << encoder_.config().height << ") at " << fps
+                      << " FPS..." << std::endl;
+        }
+        frames_++;
+
+        // Once a second, report if decoding fell behind
+        if (frames_ % fps == 0) {
+            PrefetchStats stats = prefetcher_.stats();
+            if (stats.underruns > reported_underruns_) {
+                std::cout << "⚠️  Prefetch underruns for " << name_ << ": " << stats.underruns - reported_underruns_
+                          << " since last report (" << stats.wait_ms << " ms waited in total)" << std::endl;
+                reported_underruns_ = stats.underruns;
+            }
+        }
+    }
+}
+
+void ImageStream::finish() {
+    PrefetchStats prefetch = prefetcher_.stats();
+    std::cout << "✅ Image streaming completed for " << name_ << " (" << frames_ << " frames sent)" << std::endl;
+    std::cout << "📦 Prefetch " << name_ << ": " << prefetch.frames << " frames, " << prefetch.underruns
+              << " underrun(s), " << prefetch.wait_ms << " ms waited, " << prefetch.failed << " unreadable" << std::endl;
+    logPacingStats(name_, pacer_->stats());
+    output_->close();
+}
+
+TestPatternStream::TestPatternStream(std::string name, std::shared_ptr<AccessUnitOutput> output)
+    : name_(std::move(name)), encoder_(H264EncoderConfig::fromEnvironment()), output_(std::move(output)) {}
+
+bool TestPatternStream::step(Clock::time_point& next_due) {
+    if (!opened_) {
+        if (!encoder_.open()) {
+            return false;
+        }
+        opened_ = true;
+
+        // SMPTE-style color bars with a sweeping white bar so motion is visible
+        const cv::Scalar bars[] = {
+            {192, 192, 192}, {0, 192, 192}, {192, 192, 0}, {0, 192, 0},
+            {192, 0, 192}, {0, 0, 192}, {192, 0, 0}};
+        const int bar_count = sizeof(bars) / sizeof(bars[0]);
+        const cv::Size size(encoder_.config().width, encoder_.config().height);
+        background_.create(size, CV_8UC3);
+        for (int i = 0; i < bar_count; i++) {
+            int x0 = size.width * i / bar_count;
+            int x1 = size.width * (i + 1) / bar_count;
+            background_(cv::Rect(x0, 0, x1 - x0, size.height)).setTo(bars[i]);
+        }
+    }
+
+    const int fps = encoder_.config().fps;
+    if (frames_ >= fps * 10 || !output_->active()) {  // Stream for 10 seconds
+        return false;
+    }
+
+    Clock::time_point deadline = pacer_.schedule(static_cast<double>(frames_) / fps);
+    if (deadline > Clock::now()) {
+        next_due = deadline;
+        return true;
+    }
+    pacer_.released(deadline);
+
+    const int height = background_.rows;
+    const int width = background_.cols;
+    background_.copyTo(frame_);
+    int y = (frames_ * 4) % height;
+    frame_(cv::Rect(0, y, width, std::min(8, height - y))).setTo(cv::Scalar(255, 255, 255));
+
+    if (output_->takeKeyframeRequest()) {
+        encoder_.requestKeyframe();
+    }
+    if (encoder_.encode(frame_, frames_, au_)) {
+        output_->send(au_, static_cast<double>(au_.pts) / fps, 0, nullptr);
+    }
+
+    if (frames_ % fps == 0) {
+        LOG_INFO("📺 {}: sent test frame {} via WebRTC", name_, frames_);
+    }
+    frames_++;
+
+    next_due = Clock::now();  // schedule() of the next frame decides the real deadline
+    return true;
+}
+
+void TestPatternStream::finish() {
+    std::cout << "✅ Test pattern streaming completed (" << frames_ << " frames sent)" << std::endl;
+    output_->close();
+}
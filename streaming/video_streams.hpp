@@ -0,0 +1,198 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "access_unit.hpp"
+#include "frame_prefetcher.hpp"
+#include "h264_encoder.hpp"
+#include "media_source.hpp"
+#include "pacing.hpp"
+#include "stream_scheduler.hpp"
+
+// Where a stream's access units go: one peer's track, or a broadcast that
+// fans them out to many.
+class AccessUnitOutput {
+public:
+    virtual ~AccessUnitOutput() = default;
+
+    // False ends the stream (track closed, broadcast has no viewers)
+    virtual bool active() = 0;
+
+    // owner, if set, keeps au's NAL bytes alive beyond this call
+    virtual void send(const AccessUnit& au, double pts_seconds, int64_t capture_ms,
+                      const std::shared_ptr<const void>& owner) = 0;
+
+    // Live encoders poll this before each frame
+    virtual bool takeKeyframeRequest() { return false; }
+
+    // The stream has ended
+    virtual void close() {}
+};
+
+// Capture time of a bag_processor frame, "image_<n>_<unix seconds>.jpg"; 0 if unknown
+int64_t captureTimeMillis(const std::string& image_path);
+
+// Operator controls of one file stream. The control plane sets them from any
+// thread; the stream picks them up on its next step.
+class PlaybackControl {
+public:
+    static constexpr double kMinRate = 0.25;
+    static constexpr double kMaxRate = 8.0;
+
+    PlaybackControl();  // loop defaults to $STREAM_LOOP
+
+    // Takes over loop, rate, pause and position from the control of the stream
+    // this one replaces (e.g. the same recording at another quality), and
+    // carries on its playback clock so RTP timestamps keep increasing
+    void continueFrom(const PlaybackControl& previous);
+
+    // Seconds from the start of the file; playback resumes at the keyframe before it
+    void seek(double seconds);
+    void setLoop(bool loop);
+    // Clamped to [kMinRate, kMaxRate]
+    void setRate(double rate);
+    void setPaused(bool paused);
+    // Skip ahead to the next keyframe, for a receiver that lost its reference
+    void requestKeyframe();
+
+    bool loop() const { return loop_; }
+    double rate() const { return rate_; }
+    bool paused() const { return paused_; }
+
+    // Media position of the last unit sent, and the file's length, in seconds
+    double position() const { return position_; }
+    double duration() const { return duration_; }
+
+    // Stream side
+    uint64_t version() const { return version_.load(std::memory_order_acquire); }
+    bool takeSeek(double& seconds);
+    bool takeKeyframeRequest() { return keyframe_requested_.exchange(false); }
+    // next_clock: playback time the unit after the last one sent is due at
+    void report(double position, double duration, double next_clock);
+    // Playback time the first unit goes out at; 0 unless continued from another stream
+    double startClock() const { return start_clock_; }
+
+private:
+    std::atomic<bool> loop_{false};
+    std::atomic<double> rate_{1.0};
+    std::atomic<bool> paused_{false};
+    std::atomic<bool> keyframe_requested_{false};
+    std::atomic<double> position_{0.0};
+    std::atomic<double> duration_{0.0};
+    std::atomic<double> next_clock_{0.0};
+    double start_clock_ = 0.0;  // set before the stream starts
+    std::atomic<uint64_t> version_{0};  // bumped by every command
+
+    std::mutex seek_mutex_;
+    bool seek_pending_ = false;
+    double seek_seconds_ = 0.0;
+};
+
+// Plays a mapped MP4 / Annex-B file in real time, releasing units on their DTS.
+//
+// Units are released on a playback clock rather than on their media time:
+// playback = segment_play + (media - segment_media) / rate. A seek, a loop or
+// a rate change starts a new segment where the clock left off, so pacing
+// deadlines and RTP timestamps stay continuous and the receiver sees one
+// uninterrupted stream. A seek lands on the keyframe before the target and
+// goes out one frame interval after the last unit sent. A pause holds the
+// next unit back and moves the clock on by the time spent paused.
+class FileStream : public ScheduledStream {
+public:
+    FileStream(std::string name, std::shared_ptr<const MediaSource> source,
+               std::shared_ptr<AccessUnitOutput> output, std::shared_ptr<PacingScheduler> pacer,
+               std::shared_ptr<PlaybackControl> control = nullptr);
+
+    bool step(Clock::time_point& next_due) override;
+    void finish() override;
+
+private:
+    std::string name_;
+    std::shared_ptr<const MediaSource> source_;
+    MediaCursor cursor_;
+    std::shared_ptr<AccessUnitOutput> output_;
+    std::shared_ptr<PacingScheduler> pacer_;
+    std::shared_ptr<PlaybackControl> control_;
+
+    // How soon to look again for a resume while paused
+    static constexpr std::chrono::milliseconds kPausePoll{20};
+
+    AccessUnit au_;
+    bool pending_ = false;  // au_ is scheduled but not yet sent
+    Clock::time_point deadline_;
+    bool have_first_ = false;
+    int64_t first_wall_ms_ = 0;
+    size_t units_ = 0;
+    size_t nals_ = 0;
+
+    // Playback clock
+    uint64_t control_version_ = 0;
+    double rate_ = 1.0;
+    double segment_media_ = 0.0;
+    double segment_play_ = 0.0;
+    double last_play_ = 0.0;        // playback time of the last unit sent
+    size_t segment_units_ = 0;      // units sent since the segment started
+    bool paused_ = false;
+    Clock::time_point paused_at_;
+
+    double playbackSeconds(int64_t ticks) const;
+    void applyControls();
+    void startSegment(size_t index);
+};
+
+// Encodes a directory of images (decoded ahead on the shared pool) at the
+// encoder frame rate
+class ImageStream : public ScheduledStream {
+public:
+    ImageStream(std::string name, std::vector<std::string> image_files, DecodePool& pool,
+                std::shared_ptr<AccessUnitOutput> output, std::shared_ptr<PacingScheduler> pacer);
+
+    bool step(Clock::time_point& next_due) override;
+    void finish() override;
+
+private:
+    // How soon to look again when the next frame is still being decoded
+    static constexpr std::chrono::milliseconds kUnderrunRetry{2};
+
+    std::string name_;
+    FramePrefetcher prefetcher_;
+    H264Encoder encoder_;
+    std::shared_ptr<AccessUnitOutput> output_;
+    std::shared_ptr<PacingScheduler> pacer_;
+
+    bool opened_ = false;
+    PrefetchedFrame frame_;
+    AccessUnit au_;
+    bool pending_ = false;
+    Clock::time_point deadline_;
+    int64_t frames_ = 0;
+    uint64_t reported_underruns_ = 0;
+};
+
+// Ten seconds of moving colour bars, for checking the path without media
+class TestPatternStream : public ScheduledStream {
+public:
+    TestPatternStream(std::string name, std::shared_ptr<AccessUnitOutput> output);
+
+    bool step(Clock::time_point& next_due) override;
+    void finish() override;
+
+private:
+    std::string name_;
+    H264Encoder encoder_;
+    std::shared_ptr<AccessUnitOutput> output_;
+    PacingScheduler pacer_;
+
+    bool opened_ = false;
+    cv::Mat background_;
+    cv::Mat frame_;
+    AccessUnit au_;
+    int frames_ = 0;
+};
@@ -1,34 +1,218 @@
 #include "webrtc_manager.hpp"
+#include "log.hpp"
 #include <iostream>
 #include <sstream>
 #include <chrono>
 #include <thread>
 #include <cstddef>
 #include <fstream>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <map>
 
 #ifdef WEBRTC_ENABLED
 
+namespace {
+
+// Session id and version from an SDP "o=<user> <sess-id> <sess-version> ..." line
+bool parseSdpOrigin(const std::string& sdp, std::string& session_id, uint64_t& version) {
+    size_t pos = sdp.rfind("o=", 0) == 0 ? 0 : sdp.find("\no=");
+    if (pos == std::string::npos) {
+        return false;
+    }
+    pos += sdp[pos] == '\n' ? 3 : 2;
+    std::istringstream origin(sdp.substr(pos, sdp.find('\n', pos) - pos));
+    std::string user;
+    std::string version_text;
+    if (!(origin >> user >> session_id >> version_text)) {
+        return false;
+    }
+    char* end = nullptr;
+    version = std::strtoull(version_text.c_str(), &end, 10);
+    return end && *end == '\0';
+}
+
+// Media ids of the offer's video sections, in SDP order
+std::vector<std::string> offeredVideoMids(const std::string& sdp) {
+    std::vector<std::string> mids;
+    std::istringstream lines(sdp);
+    std::string line;
+    bool video = false;
+    while (std::getline(lines, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.rfind("m=", 0) == 0) {
+            video = line.rfind("m=video", 0) == 0;
+        } else if (video && line.rfind("a=mid:", 0) == 0) {
+            mids.push_back(line.substr(6));
+            video = false;
+        }
+    }
+    return mids;
+}
+
+// ICE username fragment of an SDP ("a=ice-ufrag:"); bundled sections share one
+std::string sdpIceUfrag(const std::string& sdp) {
+    size_t pos = sdp.find("a=ice-ufrag:");
+    if (pos == std::string::npos) {
+        return "";
+    }
+    pos += 12;
+    size_t end = sdp.find_first_of("\r\n", pos);
+    return sdp.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+}
+
+// ICE username fragment a trickled candidate belongs to: its usernameFragment
+// field, else the "ufrag" attribute browsers append to the candidate line.
+// Empty if the client sent neither.
+std::string candidateUfrag(const Json::Value& candidate) {
+    if (candidate.isMember("usernameFragment") && candidate["usernameFragment"].isString()) {
+        return candidate["usernameFragment"].asString();
+    }
+    std::istringstream fields(candidate.get("candidate", "").asString());
+    std::string field;
+    while (fields >> field) {
+        if (field == "ufrag" && fields >> field) {
+            return field;
+        }
+    }
+    return "";
+}
+
+// Lines of a "<name>_<lines>p.<ext>" file, e.g. 480 for "drive_480p.mp4"; 0 without that suffix
+int qualityOf(const std::string& path, size_t* suffix = nullptr) {
+    size_t slash = path.rfind('/');
+    size_t dot = path.rfind('.');
+    size_t stem_end = (dot == std::string::npos || (slash != std::string::npos && dot < slash)) ? path.size() : dot;
+    size_t underscore = path.rfind('_', stem_end);
+    if (suffix) {
+        *suffix = stem_end;
+    }
+    if (underscore == std::string::npos || (slash != std::string::npos && underscore < slash) ||
+        stem_end < underscore + 3 || path[stem_end - 1] != 'p') {
+        return 0;
+    }
+    int lines = 0;
+    for (size_t i = underscore + 1; i < stem_end - 1; i++) {
+        if (path[i] < '0' || path[i] > '9') {
+            return 0;
+        }
+        lines = lines * 10 + (path[i] - '0');
+    }
+    if (suffix) {
+        *suffix = underscore;
+    }
+    return lines;
+}
+
+// The same recording at another quality: "drive.mp4" -> "drive_480p.mp4"; lines 0 is the original
+std::string qualityVariant(const std::string& path, int lines) {
+    size_t stem_end = 0;
+    qualityOf(path, &stem_end);
+    size_t dot = path.rfind('.');
+    size_t slash = path.rfind('/');
+    std::string extension = (dot == std::string::npos || (slash != std::string::npos && dot < slash)) ? "" : path.substr(dot);
+    std::string variant = path.substr(0, stem_end);
+    if (lines > 0) {
+        variant += "_" + std::to_string(lines) + "p";
+    }
+    return variant + extension;
+}
+
+// Existing file of the same recording at `lines`, or "" if there is none. Lines 0 asks
+// for the top quality: the original, or the tallest rendition when the ladder wrote
+// renditions only ("drive_1080p.mp4", "drive_720p.mp4", ... without "drive.mp4")
+std::string availableVariant(const std::string& path, int lines) {
+    std::string variant = qualityVariant(path, lines);
+    if (std::ifstream(variant).good()) {
+        return variant;
+    }
+    if (lines > 0) {
+        return "";
+    }
+    std::string original = variant;
+    size_t dot = original.rfind('.');
+    size_t slash = original.rfind('/');
+    size_t stem_end = (dot == std::string::npos || (slash != std::string::npos && dot < slash)) ? original.size() : dot;
+    std::vector<cv::String> renditions;
+    cv::glob(original.substr(0, stem_end) + "_*p" + original.substr(stem_end), renditions);
+    std::string tallest;
+    int tallest_lines = 0;
+    for (const cv::String& rendition : renditions) {
+        int rendition_lines = qualityOf(rendition);
+        if (rendition_lines > tallest_lines && qualityVariant(rendition, 0) == original) {
+            tallest = rendition;
+            tallest_lines = rendition_lines;
+        }
+    }
+    return tallest;
+}
+
+const char* toString(rtc::PeerConnection::State state) {
+    switch (state) {
+        case rtc::PeerConnection::State::New: return "new";
+        case rtc::PeerConnection::State::Connecting: return "connecting";
+        case rtc::PeerConnection::State::Connected: return "connected";
+        case rtc::PeerConnection::State::Disconnected: return "disconnected";
+        case rtc::PeerConnection::State::Failed: return "failed";
+        case rtc::PeerConnection::State::Closed: return "closed";
+    }
+    return "unknown";
+}
+
+}  // namespace
+
+// A peer's video track as the output of a scheduled stream
+class WebRTCManager::PeerOutput : public AccessUnitOutput {
+public:
+    // A new output is a new stream on the track: it takes over the RTP clock from here
+    PeerOutput(std::shared_ptr<rtc::Track> track, std::shared_ptr<VideoSender> sender)
+        : track_(std::move(track)), sender_(std::move(sender)), generation_(sender_->beginStream()) {}
+    
+    bool active() override { return track_->isOpen(); }
+    
+    // Packetized before this returns, so nothing needs to be kept alive
+    void send(const AccessUnit& au, double pts_seconds, int64_t capture_ms,
+              const std::shared_ptr<const void>& /*owner*/) override {
+        sendAccessUnit(track_, *sender_, generation_, au, pts_seconds, capture_ms);
+    }
+    
+    bool takeKeyframeRequest() override { return sender_->keyframe_requested.exchange(false); }
+    
+private:
+    std::shared_ptr<rtc::Track> track_;
+    std::shared_ptr<VideoSender> sender_;
+    const uint64_t generation_;
+};
+
 WebRTCManager::WebRTCManager(const std::string& thing_name, PublishCallback publish_cb) 
     : thing_name_(thing_name), publish_callback_(publish_cb) {
-    std::cout << "✅ WebRTC Manager initialized with libdatachannel" << std::endl;
+    const char* broadcast = std::getenv("STREAM_BROADCAST");
+    broadcast_enabled_ = broadcast && std::string(broadcast) == "1";
+    const char* trickle = std::getenv("TRICKLE_ICE");
+    trickle_ice_ = trickle && std::string(trickle) == "1";
+    const char* coalesce = std::getenv("TRICKLE_ICE_COALESCE_MS");
+    if (coalesce && *coalesce) {
+        candidate_coalesce_ = std::chrono::milliseconds(std::max(0, std::atoi(coalesce)));
+    }
+    std::cout << "✅ WebRTC Manager initialized with libdatachannel"
+              << (broadcast_enabled_ ? " (broadcast mode)" : "")
+              << (trickle_ice_ ? " (trickle ICE, " + std::to_string(candidate_coalesce_.count()) + " ms coalescing)" : "") << ", " << scheduler_.threadCount()
+              << " stream scheduler thread(s)" << std::endl;
 }
 
 WebRTCManager::~WebRTCManager() {
-    // Stop all streaming
-    for (auto& [peer_id, active] : streaming_active_) {
-        stopVideoStreaming(peer_id);
-    }
-    
-    // Close all peer connections
-    for (auto& [peer_id, pc] : peer_connections_) {
-        if (pc) {
-            pc->close();
+    // Stop all streaming and close all peer connections
+    for (const auto& session : peers_.snapshot()) {
+        stopSessionStreaming(*session);
+        if (session->pc) {
+            session->pc->close();
         }
+        peers_.remove(session->peer_id);
     }
-    peer_connections_.clear();
-    video_tracks_.clear();
-    streaming_active_.clear();
-    streaming_threads_.clear();
     std::cout << "🧹 WebRTC Manager cleaned up" << std::endl;
 }
 
@@ -42,68 +226,73 @@ rtc::Configuration WebRTCManager::getRTCConfig() {
     return config;
 }
 
-std::shared_ptr<rtc::PeerConnection> WebRTCManager::createPeerConnection(const std::string& peer_id) {
+std::shared_ptr<rtc::PeerConnection> WebRTCManager::createPeerConnection(const PeerSessionPtr& session) {
+    const std::string& peer_id = session->peer_id;
     auto config = getRTCConfig();
     auto pc = std::make_shared<rtc::PeerConnection>(config);
+    auto timeline = session->timeline;
     
     // Set up connection state callback
-    pc->onStateChange([this, peer_id](rtc::PeerConnection::State state) {
-        std::cout << "🔗 Peer " << peer_id << " connection state: ";
+    pc->onStateChange([this, peer_id, timeline](rtc::PeerConnection::State state) {
+        const char* name = "";
         switch (state) {
-            case rtc::PeerConnection::State::New:
-                std::cout << "New" << std::endl;
-                break;
-            case rtc::PeerConnection::State::Connecting:
-                std::cout << "Connecting" << std::endl;
-                break;
-            case rtc::PeerConnection::State::Connected:
-                std::cout << "Connected" << std::endl;
-                std::cout << "✅ WebRTC connection established for " << peer_id << std::endl;
-                std::cout << "🎯 Ready for video streaming via WebSocket" << std::endl;
-                break;
-            case rtc::PeerConnection::State::Disconnected:
-                std::cout << "Disconnected" << std::endl;
-                break;
-            case rtc::PeerConnection::State::Failed:
-                std::cout << "Failed" << std::endl;
-                std::cout << "❌ WebRTC connection failed for " << peer_id << " - check network connectivity" << std::endl;
-                break;
-            case rtc::PeerConnection::State::Closed:
-                std::cout << "Closed" << std::endl;
-                break;
+            case rtc::PeerConnection::State::New: name = "New"; break;
+            case rtc::PeerConnection::State::Connecting: name = "Connecting"; break;
+            case rtc::PeerConnection::State::Connected: name = "Connected"; break;
+            case rtc::PeerConnection::State::Disconnected: name = "Disconnected"; break;
+            case rtc::PeerConnection::State::Failed: name = "Failed"; break;
+            case rtc::PeerConnection::State::Closed: name = "Closed"; break;
+        }
+        LOG_INFO("🔗 Peer {} connection state: {}", peer_id, name);
+        
+        if (state == rtc::PeerConnection::State::Connected) {
+            LOG_INFO("✅ WebRTC connection established for {}", peer_id);
+            timeline->mark(Milestone::DtlsConnected);
+            LOG_INFO("🎯 Ready for video streaming via WebSocket");
+        } else if (state == rtc::PeerConnection::State::Failed) {
+            LOG_ERROR("❌ WebRTC connection failed for {} - check network connectivity", peer_id);
+            publishTimeline(peer_id, *timeline, "failed");
+        }
+    });
+    
+    // ICE connectivity is the step before DTLS in the setup timeline
+    pc->onIceStateChange([timeline](rtc::PeerConnection::IceState state) {
+        if (state == rtc::PeerConnection::IceState::Connected || state == rtc::PeerConnection::IceState::Completed) {
+            timeline->mark(Milestone::IceConnected);
         }
     });
     
     // Set up gathering state callback
     pc->onGatheringStateChange([peer_id](rtc::PeerConnection::GatheringState state) {
-        std::cout << "🧊 Peer " << peer_id << " ICE gathering: ";
+        const char* name = "";
         switch (state) {
-            case rtc::PeerConnection::GatheringState::New:
-                std::cout << "New" << std::endl;
-                break;
-            case rtc::PeerConnection::GatheringState::InProgress:
-                std::cout << "In Progress" << std::endl;
-                break;
-            case rtc::PeerConnection::GatheringState::Complete:
-                std::cout << "Complete" << std::endl;
-                break;
+            case rtc::PeerConnection::GatheringState::New: name = "New"; break;
+            case rtc::PeerConnection::GatheringState::InProgress: name = "In Progress"; break;
+            case rtc::PeerConnection::GatheringState::Complete: name = "Complete"; break;
         }
+        LOG_INFO("🧊 Peer {} ICE gathering: {}", peer_id, name);
     });
     
     // Video track will be added after remote description is set
     
     // Set up ICE candidate handling
-    setupICEHandling(peer_id, pc);
+    setupICEHandling(session, pc);
     
     return pc;
 }
 
-void WebRTCManager::setupICEHandling(const std::string& peer_id, std::shared_ptr<rtc::PeerConnection> pc) {
-    // Store local candidates for batching
-    static std::map<std::string, Json::Value> localCandidates;
+void WebRTCManager::setupICEHandling(const PeerSessionPtr& session, std::shared_ptr<rtc::PeerConnection> pc) {
+    const std::string peer_id = session->peer_id;
+    std::weak_ptr<PeerSession> weak_session = session;  // the session owns pc, and pc these callbacks
     
-    pc->onLocalCandidate([this, peer_id](rtc::Candidate candidate) {
-        std::cout << "🧊 Local ICE candidate for " << peer_id << ": " << candidate.candidate() << std::endl;
+    pc->onLocalCandidate([this, peer_id, weak_session](rtc::Candidate candidate) {
+        LOG_DEBUG("🧊 Local ICE candidate for {}: {}", peer_id, candidate.candidate());
+        auto session = weak_session.lock();
+        if (!session) {
+            return;
+        }
+        session->timeline->mark(Milestone::FirstLocalCandidate);
+        session->timeline->mark(Milestone::LastLocalCandidate);
         
         // Create candidate JSON object
         Json::Value candidateJson;
@@ -112,115 +301,203 @@ void WebRTCManager::setupICEHandling(const std::string& peer_id, std::shared_ptr
         candidateJson["sdpMLineIndex"] = 0; // Default to 0, adjust as needed
         
         // Add to local candidates array for this peer
-        if (localCandidates.find(peer_id) == localCandidates.end()) {
-            localCandidates[peer_id] = Json::Value(Json::arrayValue);
+        bool schedule_flush = false;
+        {
+            std::lock_guard<std::mutex> lock(session->mutex);
+            session->local_candidates.append(candidateJson);
+            if (trickle_ice_ && !session->candidate_flush_pending) {
+                session->candidate_flush_pending = true;
+                schedule_flush = true;
+            }
+        }
+        
+        // Trickle: publish now, or together with whatever else arrives in the next few ms
+        if (schedule_flush) {
+            if (candidate_coalesce_.count() <= 0) {
+                publishLocalCandidates(*session);
+            } else {
+                scheduler_.after(candidate_coalesce_, [this, weak_session]() {
+                    if (auto session = weak_session.lock()) {
+                        publishLocalCandidates(*session);
+                    }
+                });
+            }
         }
-        localCandidates[peer_id].append(candidateJson);
     });
     
-    pc->onGatheringStateChange([this, peer_id](rtc::PeerConnection::GatheringState state) {
+    pc->onGatheringStateChange([this, peer_id, weak_session](rtc::PeerConnection::GatheringState state) {
         if (state == rtc::PeerConnection::GatheringState::Complete) {
-            std::cout << "🧊 Peer " << peer_id << " ICE gathering: Complete" << std::endl;
-            
-            // Publish all collected local ICE candidates to /rmcs topic
-            std::string rmcs_topic = thing_name_ + "/robot-control/" + peer_id + "/candidate/rmcs";
+            LOG_INFO("🧊 Peer {} ICE gathering: Complete", peer_id);
             
-            // Get collected candidates for this peer
-            if (localCandidates.find(peer_id) != localCandidates.end()) {
-                Json::StreamWriterBuilder builder;
-                std::string candidatesStr = Json::writeString(builder, localCandidates[peer_id]);
-                
-                if (publish_callback_) {
-                    publish_callback_(rmcs_topic, candidatesStr);
-                    std::cout << "📤 Published " << localCandidates[peer_id].size() << " local ICE candidates to rmcs topic for " << peer_id << std::endl;
-                }
-                
-                // Clear candidates for this peer
-                localCandidates.erase(peer_id);
+            // Publish all remaining local ICE candidates to /rmcs topic
+            if (auto session = weak_session.lock()) {
+                publishLocalCandidates(*session);
             }
         } else {
-            std::cout << "🧊 Peer " << peer_id << " ICE gathering: In Progress" << std::endl;
+            LOG_INFO("🧊 Peer {} ICE gathering: In Progress", peer_id);
         }
     });
     
-    pc->onLocalDescription([this, peer_id](rtc::Description description) {
-        std::cout << "📤 Local description ready for " << peer_id << std::endl;
-        
-        // Publish answer to MQTT
-        std::string answer_topic = thing_name_ + "/robot-control/" + peer_id + "/answer";
-        
-        // Publish raw SDP answer (to match the format from response.md)
-        std::string sdp_answer = description;
-        
-        if (publish_callback_) {
-            publish_callback_(answer_topic, sdp_answer);
-            std::cout << "✅ Raw SDP answer published for peer " << peer_id << std::endl;
-            std::cout << "📄 Answer SDP length: " << sdp_answer.length() << " characters" << std::endl;
+    pc->onLocalDescription([this, peer_id, weak_session](rtc::Description description) {
+        LOG_INFO("📤 Local description ready for {}", peer_id);
+        publishAnswer(peer_id, description);
+        if (auto session = weak_session.lock()) {
+            session->timeline->mark(Milestone::AnswerPublished);
         }
     });
 }
 
-bool WebRTCManager::handleOffer(const std::string& peer_id, const std::string& offer_sdp) {
+void WebRTCManager::publishTimeline(const std::string& peer_id, SessionTimeline& timeline, const std::string& outcome) {
+    // Published once per session: on first media, or when it ends without any
+    if (!timeline.claimPublish()) {
+        return;
+    }
+    if (outcome == "connected") {
+        timeline_stats_.add(timeline);
+    }
+    
+    Json::Value summary = timeline.toJson(outcome);
+    summary["peer_id"] = peer_id;
+    summary["aggregate"] = timeline_stats_.toJson();
+    
+    auto stage = [&summary](const char* name) {
+        const Json::Value& value = summary["stages_ms"][name];
+        return value.isNull() ? std::string("-") : std::to_string(static_cast<int>(value.asDouble() + 0.5));
+    };
+    LOG_INFO("⏱️  Setup timeline {} ({}): sdp {} ms, answer {} ms, ICE {} ms, DTLS {} ms, track {} ms, "
+             "first media {} ms", peer_id, outcome, stage("sdp"), stage("answer"), stage("ice_connect"),
+             stage("dtls"), stage("track_open"), stage("first_media"));
+    
+    if (publish_callback_) {
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        builder["precision"] = 6;
+        publish_callback_(thing_name_ + "/robot-control/" + peer_id + "/timeline", Json::writeString(builder, summary));
+    }
+}
+
+void WebRTCManager::publishAnswer(const std::string& peer_id, const std::string& sdp_answer) {
+    // Publish answer to MQTT
+    std::string answer_topic = thing_name_ + "/robot-control/" + peer_id + "/answer";
+    
+    // Publish raw SDP answer (to match the format from response.md)
+    if (publish_callback_) {
+        publish_callback_(answer_topic, sdp_answer);
+        LOG_INFO("✅ Raw SDP answer published for peer {}", peer_id);
+        LOG_INFO("📄 Answer SDP length: {} characters", sdp_answer.length());
+    }
+}
+
+void WebRTCManager::publishLocalCandidates(PeerSession& session) {
+    Json::Value candidates(Json::arrayValue);
+    {
+        std::lock_guard<std::mutex> lock(session.mutex);
+        candidates.swap(session.local_candidates);
+        session.candidate_flush_pending = false;
+    }
+    if (candidates.empty()) {
+        return;
+    }
+    
+    std::string rmcs_topic = thing_name_ + "/robot-control/" + session.peer_id + "/candidate/rmcs";
+    Json::StreamWriterBuilder builder;
+    std::string candidatesStr = Json::writeString(builder, candidates);
+    
+    if (publish_callback_) {
+        publish_callback_(rmcs_topic, candidatesStr);
+        LOG_INFO("📤 Published {} local ICE candidates to rmcs topic for {}", candidates.size(), session.peer_id);
+    }
+}
+
+bool WebRTCManager::handleOffer(const std::string& peer_id, const std::string& offer_sdp,
+                                SeiTimestampMode sei_mode) {
+    auto offer_received = SessionTimeline::Clock::now();
     try {
-        std::cout << "🚀 Creating WebRTC peer connection for: " << peer_id << std::endl;
+        std::string origin_id;
+        uint64_t origin_version = 0;
+        bool has_origin = parseSdpOrigin(offer_sdp, origin_id, origin_version);
+        
+        // Retransmitted, reordered or renegotiating offers keep a working session
+        if (auto existing = peers_.find(peer_id)) {
+            if (has_origin && handleRepeatedOffer(*existing, offer_sdp, origin_id, origin_version)) {
+                return true;
+            }
+        }
         
-        // Create new peer connection
-        auto pc = createPeerConnection(peer_id);
+        LOG_INFO("🚀 Creating WebRTC peer connection for: {}", peer_id);
         
-        // Store the peer connection
-        peer_connections_[peer_id] = pc;
+        // Create new peer connection; the session is published once its track is set up
+        auto session = std::make_shared<PeerSession>(peer_id);
+        session->timeline = std::make_shared<SessionTimeline>(offer_received);
+        session->timeline->onComplete([this, peer_id](SessionTimeline& timeline) {
+            publishTimeline(peer_id, timeline, "connected");
+        });
+        session->offer_origin = origin_id;
+        session->offer_version = origin_version;
+        session->remote_ufrag = sdpIceUfrag(offer_sdp);
+        auto pc = createPeerConnection(session);
+        session->pc = pc;
         
         // Parse and set remote description
         rtc::Description offer(offer_sdp, rtc::Description::Type::Offer);
         pc->setRemoteDescription(offer);
         
-        std::cout << "📥 Remote description set for " << peer_id << std::endl;
+        session->timeline->mark(Milestone::RemoteDescriptionSet);
+        LOG_INFO("📥 Remote description set for {}", peer_id);
         
-        // Now add video track after remote description is set
-        try {
-            std::cout << "🎬 Adding video track to peer connection" << std::endl;
-            
-            // Create video media description with H264 codec
-            rtc::Description::Video video("video0", rtc::Description::Direction::SendOnly);
-            video.addH264Codec(96, "baseline"); // PT 96 for H264
-            video.setBitrate(1000); // 1 Mbps
-            
-            auto video_track = pc->addTrack(video);
-            video_tracks_[peer_id] = video_track;
-            
-            // Set up track callbacks
-            video_track->onOpen([this, peer_id]() {
-                std::cout << "✅ Video track opened for " << peer_id << std::endl;
-                
-                // Start video streaming in a separate thread to avoid blocking
-                std::thread([this, peer_id]() {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(500)); // Small delay to ensure track is ready
-                    
-                    // Auto-start H264 video streaming when track opens
-                    // Look for video files in bag_processor directory
-                    std::string video_file = this->findVideoFile();
-                    if (!video_file.empty()) {
-                        std::cout << "🎬 Auto-starting H264 video streaming via WebRTC..." << std::endl;
-                        std::cout << "📹 Video file: " << video_file << std::endl;
-                        this->startH264FileStreaming(peer_id, video_file);
-                    } else {
-                        std::cout << "⚠️ No video file found in bag_processor directory" << std::endl;
-                        
-                        // Try a simple test pattern as fallback
-                        std::cout << "📺 Starting test pattern streaming instead..." << std::endl;
-                        this->startTestPatternStreaming(peer_id);
-                    }
-                }).detach();
-            });
-            
-            video_track->onClosed([peer_id]() {
-                std::cout << "❌ Video track closed for " << peer_id << std::endl;
-            });
-            
-            std::cout << "✅ Video track with H264 codec added successfully" << std::endl;
-            
-        } catch (const std::exception& e) {
-            std::cerr << "⚠️  Failed to add video track: " << e.what() << std::endl;
+        // Candidates that raced ahead of the offer; ones held back from an
+        // earlier client session of this peer do not apply to it
+        Json::Value early(Json::arrayValue);
+        for (const auto& candidate : takeEarlyCandidates(peer_id)) {
+            std::string ufrag = candidateUfrag(candidate);
+            if (ufrag.empty() || session->remote_ufrag.empty() || ufrag == session->remote_ufrag) {
+                early.append(candidate);
+            }
+        }
+        if (!early.empty()) {
+            LOG_INFO("🧊 Applying {} early ICE candidates for {}", early.size(), peer_id);
+            addRemoteCandidates(*pc, early);
+        }
+        
+        // Now add the video tracks after remote description is set: one per
+        // camera, on the video sections the client offered
+        std::vector<std::string> mids = offeredVideoMids(offer_sdp);
+        if (mids.empty()) {
+            mids.push_back("video0");
+        }
+        std::vector<std::string> recordings = findVideoFiles();
+        size_t camera_count = std::min({mids.size(), std::max<size_t>(1, recordings.size()), kMaxCameras});
+        for (size_t i = 0; i < camera_count; i++) {
+            auto camera = std::make_shared<CameraTrack>(i, mids[i]);
+            camera->source = i < recordings.size() ? recordings[i] : "";
+            try {
+                addCameraTrack(session, camera, sei_mode);
+                session->cameras.push_back(camera);
+            } catch (const std::exception& e) {
+                LOG_WARN("⚠️  Failed to add video track {}: {}", camera->mid, e.what());
+            }
+        }
+        if (sei_mode != SeiTimestampMode::Off) {
+            LOG_INFO("🕒 SEI timestamps ({}) enabled for {}", toString(sei_mode), peer_id);
+        }
+        
+        // Clients that offer no data section keep using the MQTT control topic
+        if (offer.hasApplication()) {
+            try {
+                setupControlChannel(session);
+            } catch (const std::exception& e) {
+                LOG_WARN("⚠️  Failed to add control channel: {}", e.what());
+            }
+        }
+        
+        // A repeated offer replaces the peer's previous session
+        if (auto previous = peers_.insert(session)) {
+            LOG_INFO("🔁 Replacing previous session of {}", peer_id);
+            publishTimeline(peer_id, *previous->timeline, "replaced");
+            stopSessionStreaming(*previous);
+            if (previous->pc) {
+                previous->pc->close();
+            }
         }
         
         // The answer will be automatically generated and published via onLocalDescription callback
@@ -228,82 +505,345 @@ bool WebRTCManager::handleOffer(const std::string& peer_id, const std::string& o
         return true;
         
     } catch (const std::exception& e) {
-        std::cerr << "❌ Error handling offer for " << peer_id << ": " << e.what() << std::endl;
+        LOG_ERROR("❌ Error handling offer for {}: {}", peer_id, e.what());
         return false;
     }
 }
 
+void WebRTCManager::addCameraTrack(const PeerSessionPtr& session, const CameraTrackPtr& camera,
+                                   SeiTimestampMode sei_mode) {
+    const std::string& peer_id = session->peer_id;
+    LOG_INFO("🎬 Adding video track {} to peer connection", camera->mid);
+    
+    // Create video media description with H264 codec
+    // (packetization-mode=1 is required for FU-A and STAP-A)
+    auto sender = std::make_shared<VideoSender>();
+    sender->sei_mode = sei_mode;
+    sender->timeline = session->timeline;
+    const uint32_t ssrc = std::random_device{}();
+    const std::string cname = "robot-" + peer_id;  // shared by all cameras: one synchronisation context
+    
+    rtc::Description::Video video(camera->mid, rtc::Description::Direction::SendOnly);
+    video.addH264Codec(kH264PayloadType,
+                       "profile-level-id=42e01f;packetization-mode=1;level-asymmetry-allowed=1");
+    video.setBitrate(1000); // 1 Mbps
+    video.addSSRC(ssrc, cname, thing_name_, cname + "-" + camera->mid);
+    
+    auto video_track = session->pc->addTrack(video);
+    camera->track = video_track;
+    
+    // RTP chain: H.264 packetizer (single NAL / FU-A) -> NACK retransmission -> PLI (keyframe
+    // requests, honoured by live encoders) -> RTCP sender reports and transport counters for /metrics
+    sender->rtp_config = std::make_shared<rtc::RtpPacketizationConfig>(
+        ssrc, cname, kH264PayloadType, rtc::H264RtpPacketizer::defaultClockRate);
+    auto packetizer = std::make_shared<rtc::H264RtpPacketizer>(
+        rtc::H264RtpPacketizer::Separator::Length, sender->rtp_config, kMaxRtpPayload);
+    packetizer->addToChain(std::make_shared<rtc::RtcpNackResponder>());
+    std::weak_ptr<VideoSender> weak_sender = sender;
+    packetizer->addToChain(std::make_shared<rtc::PliHandler>([weak_sender]() {
+        if (auto sender = weak_sender.lock()) {
+            sender->keyframe_requested = true;
+        }
+    }));
+    sender->rtcp_stats = std::make_shared<RtcpStatsHandler>(ssrc, rtc::H264RtpPacketizer::defaultClockRate, cname);
+    packetizer->addToChain(sender->rtcp_stats);
+    video_track->setMediaHandler(packetizer);
+    camera->sender = sender;
+    
+    // Set up track callbacks
+    const size_t index = camera->index;
+    const std::string mid = camera->mid;
+    video_track->onOpen([this, peer_id, index, mid, timeline = session->timeline]() {
+        LOG_INFO("✅ Video track {} opened for {}", mid, peer_id);
+        timeline->mark(Milestone::TrackOpen);
+        
+        // Start the camera's stream from the scheduler to avoid blocking,
+        // after a small delay to ensure the track is ready
+        auto session = peers_.find(peer_id);
+        auto camera = session ? session->camera(index) : nullptr;
+        if (!camera) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(session->mutex);
+            if (!camera->active) {
+                LOG_INFO("💤 Camera {} of {} is inactive", mid, peer_id);
+                return;
+            }
+        }
+        setPeerStream(*session, *camera, [&]() {
+            return scheduler_.after(std::chrono::milliseconds(500), [this, peer_id, index]() {
+                startCamera(peer_id, index);
+            });
+        });
+    });
+    
+    video_track->onClosed([peer_id, mid]() {
+        LOG_ERROR("❌ Video track {} closed for {}", mid, peer_id);
+    });
+    
+    LOG_INFO("✅ Video track {} with H264 codec added successfully", mid);
+}
+
+void WebRTCManager::startCamera(const std::string& peer_id, size_t index) {
+    auto session = peers_.find(peer_id);
+    auto camera = session ? session->camera(index) : nullptr;
+    if (!camera) {
+        return;
+    }
+    // Auto-start H264 video streaming of the camera's recording
+    if (!camera->source.empty()) {
+        LOG_INFO("🎬 Auto-starting H264 video streaming via WebRTC...");
+        LOG_INFO("📹 Video file for {}: {}", camera->mid, camera->source);
+        // Mapping and indexing a large recording must not hold up the streams
+        // paced on a scheduler worker; the stream is scheduled once it is ready
+        std::string path = camera->source;
+        loader_.submit([this, session, camera, peer_id, index, path]() {
+            auto source = media_cache_.acquire(path);  // stays mapped until the stream holds it
+            if (peers_.find(peer_id) != session) {
+                return;  // the peer reconnected or left meanwhile
+            }
+            {
+                std::lock_guard<std::mutex> lock(session->mutex);
+                if (!camera->active) {
+                    return;
+                }
+            }
+            startH264FileStreaming(peer_id, path, index);
+        });
+    } else {
+        LOG_WARN("⚠️ No video file found for camera {}", camera->mid);
+        
+        // Try a simple test pattern as fallback
+        LOG_INFO("📺 Starting test pattern streaming instead...");
+        startTestPatternStreaming(peer_id, index);
+    }
+}
+
+uint32_t WebRTCManager::activeCameras(PeerSession& session) {
+    uint32_t mask = 0;
+    std::lock_guard<std::mutex> lock(session.mutex);
+    for (const CameraTrackPtr& camera : session.cameras) {
+        mask |= camera->active ? 1u << camera->index : 0;
+    }
+    return mask;
+}
+
+void WebRTCManager::setActiveCameras(PeerSession& session, uint32_t mask) {
+    // The tracks stay negotiated; only their streams start and stop
+    for (const CameraTrackPtr& camera : session.cameras) {
+        bool active = (mask >> camera->index) & 1;
+        bool was_active = false;
+        {
+            std::lock_guard<std::mutex> lock(session.mutex);
+            was_active = camera->active;
+            camera->active = active;
+        }
+        if (active == was_active) {
+            continue;
+        }
+        if (!active) {
+            LOG_INFO("💤 Deactivating camera {} of {}", camera->mid, session.peer_id);
+            stopCameraStreaming(session, *camera);
+        } else if (camera->track && camera->track->isOpen()) {
+            LOG_INFO("📷 Activating camera {} of {}", camera->mid, session.peer_id);
+            startCamera(session.peer_id, camera->index);
+        }  // else it starts when its track opens
+    }
+}
+
+bool WebRTCManager::handleRepeatedOffer(PeerSession& session, const std::string& offer_sdp,
+                                        const std::string& origin_id, uint64_t origin_version) {
+    const std::string& peer_id = session.peer_id;
+    if (!session.pc) {
+        return false;
+    }
+    auto state = session.pc->state();
+    if (state == rtc::PeerConnection::State::Failed || state == rtc::PeerConnection::State::Closed) {
+        return false;
+    }
+    
+    uint64_t current_version = 0;
+    {
+        std::lock_guard<std::mutex> lock(session.mutex);
+        if (session.offer_origin.empty() || session.offer_origin != origin_id) {
+            return false;  // a new session on the client side (e.g. page reload)
+        }
+        current_version = session.offer_version;
+    }
+    
+    if (origin_version < current_version) {
+        LOG_INFO("⏭️  Ignoring stale offer for {} (version {}, current {})", peer_id, origin_version,
+                 current_version);
+        return true;
+    }
+    
+    if (origin_version == current_version) {
+        // A retransmission: the client may have missed our answer
+        LOG_INFO("🔁 Duplicate offer for {}, keeping the current session", peer_id);
+        if (auto answer = session.pc->localDescription()) {
+            publishAnswer(peer_id, std::string(*answer));
+        }
+        return true;
+    }
+    
+    // Same client session, newer version: renegotiate on the existing connection
+    try {
+        session.pc->setRemoteDescription(rtc::Description(offer_sdp, rtc::Description::Type::Offer));
+    } catch (const std::exception& e) {
+        LOG_WARN("⚠️  Renegotiation failed for {}, recreating the session: {}", peer_id, e.what());
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(session.mutex);
+        session.offer_version = origin_version;
+        session.remote_ufrag = sdpIceUfrag(offer_sdp);  // changes on an ICE restart
+    }
+    LOG_INFO("🔄 Renegotiated {} (offer version {})", peer_id, origin_version);
+    return true;
+}
+
+void WebRTCManager::bufferEarlyCandidates(const std::string& peer_id, const Json::Value& candidates) {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    
+    // Expired entries belong to offers that never came
+    for (auto it = pending_candidates_.begin(); it != pending_candidates_.end();) {
+        if (now - it->second.received > kPendingCandidateTtl) {
+            LOG_INFO("🗑️  Dropping {} early ICE candidates for {} (no offer)", it->second.candidates.size(),
+                     it->first);
+            it = pending_candidates_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    
+    PendingCandidates& pending = pending_candidates_[peer_id];
+    for (const auto& candidate : candidates) {
+        if (pending.candidates.size() >= kMaxPendingCandidates) {
+            break;
+        }
+        pending.candidates.append(candidate);
+    }
+    pending.received = now;
+    LOG_INFO("⏳ Holding {} early ICE candidates for {} until its offer arrives", pending.candidates.size(), peer_id);
+}
+
+Json::Value WebRTCManager::takeEarlyCandidates(const std::string& peer_id) {
+    Json::Value candidates(Json::arrayValue);
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    auto it = pending_candidates_.find(peer_id);
+    if (it == pending_candidates_.end()) {
+        return candidates;
+    }
+    if (std::chrono::steady_clock::now() - it->second.received <= kPendingCandidateTtl) {
+        candidates.swap(it->second.candidates);
+    }
+    pending_candidates_.erase(it);
+    return candidates;
+}
+
 bool WebRTCManager::handleCandidates(const std::string& peer_id, const Json::Value& candidates) {
 #ifdef JSON_ENABLED
     try {
-        // Find the peer connection
-        auto it = peer_connections_.find(peer_id);
-        if (it == peer_connections_.end()) {
-            std::cout << "⚠️  No peer connection found for " << peer_id << std::endl;
-            return false;
+        // Find the peer connection; candidates may overtake the offer on the broker
+        auto session = peers_.find(peer_id);
+        if (!session) {
+            bufferEarlyCandidates(peer_id, candidates);
+            return true;
         }
         
-        auto pc = it->second;
+        auto pc = session->pc;
         if (!pc) {
-            std::cout << "⚠️  Invalid peer connection for " << peer_id << std::endl;
+            LOG_WARN("⚠️  Invalid peer connection for {}", peer_id);
             return false;
         }
         
-        std::cout << "🧊 Processing " << candidates.size() << " ICE candidates for " << peer_id << std::endl;
-        
-        // Process each candidate
-        for (const auto& candidateJson : candidates) {
-            if (candidateJson.isMember("candidate") && candidateJson.isMember("sdpMid")) {
-                std::string candidateStr = candidateJson["candidate"].asString();
-                std::string sdpMid = candidateJson["sdpMid"].asString();
-                int sdpMLineIndex = candidateJson.get("sdpMLineIndex", 0).asInt();
-                
-                // Create rtc::Candidate and add to peer connection
-                rtc::Candidate candidate(candidateStr, sdpMid);
-                pc->addRemoteCandidate(candidate);
-                
-                std::cout << "✅ Added ICE candidate: " << candidateStr << " (mid: " << sdpMid << ")" << std::endl;
-            } else {
-                std::cout << "⚠️  Invalid candidate format - missing required fields" << std::endl;
-            }
+        // After a client reload the new session's candidates can overtake its
+        // offer (same peer ID, new ICE credentials): hold those for that offer
+        // instead of feeding them to the old connection
+        std::string remote_ufrag;
+        {
+            std::lock_guard<std::mutex> lock(session->mutex);
+            remote_ufrag = session->remote_ufrag;
+        }
+        Json::Value current(Json::arrayValue);
+        Json::Value other(Json::arrayValue);
+        for (const auto& candidate : candidates) {
+            std::string ufrag = candidateUfrag(candidate);
+            bool matches = ufrag.empty() || remote_ufrag.empty() || ufrag == remote_ufrag;
+            (matches ? current : other).append(candidate);
+        }
+        if (!other.empty()) {
+            bufferEarlyCandidates(peer_id, other);
+        }
+        if (current.empty()) {
+            return true;
         }
         
+        LOG_INFO("🧊 Processing {} ICE candidates for {}", current.size(), peer_id);
+        addRemoteCandidates(*pc, current);
+        
         // Note: Remote candidates from Flutter are processed above and set on peer connection
         // Local robot candidates are automatically published to /rmcs when generated
         
         return true;
         
     } catch (const std::exception& e) {
-        std::cerr << "❌ Error handling ICE candidates for " << peer_id << ": " << e.what() << std::endl;
+        LOG_ERROR("❌ Error handling ICE candidates for {}: {}", peer_id, e.what());
         return false;
     }
 #else
-    std::cout << "⚠️  JSON parsing disabled - cannot handle ICE candidates" << std::endl;
+    LOG_WARN("⚠️  JSON parsing disabled - cannot handle ICE candidates");
     return false;
 #endif
 }
 
+void WebRTCManager::addRemoteCandidates(rtc::PeerConnection& pc, const Json::Value& candidates) {
+    // Process each candidate
+    for (const auto& candidateJson : candidates) {
+        if (candidateJson.isMember("candidate") && candidateJson.isMember("sdpMid")) {
+            std::string candidateStr = candidateJson["candidate"].asString();
+            std::string sdpMid = candidateJson["sdpMid"].asString();
+            
+            // Create rtc::Candidate and add to peer connection; a bad one must
+            // not cost the rest of the batch
+            try {
+                rtc::Candidate candidate(candidateStr, sdpMid);
+                pc.addRemoteCandidate(candidate);
+            } catch (const std::exception& e) {
+                LOG_WARN("⚠️  Skipping ICE candidate {}: {}", candidateStr, e.what());
+                continue;
+            }
+            
+            LOG_DEBUG("✅ Added ICE candidate: {} (mid: {})", candidateStr, sdpMid);
+        } else {
+            LOG_WARN("⚠️  Invalid candidate format - missing required fields");
+        }
+    }
+}
+
 void WebRTCManager::closePeerConnection(const std::string& peer_id) {
-    auto it = peer_connections_.find(peer_id);
-    if (it != peer_connections_.end()) {
-        if (it->second) {
-            it->second->close();
+    auto session = peers_.remove(peer_id);
+    if (session) {
+        publishTimeline(peer_id, *session->timeline, "closed");
+        stopSessionStreaming(*session);
+        if (session->pc) {
+            session->pc->close();
         }
-        peer_connections_.erase(it);
-        std::cout << "🔒 Closed peer connection for " << peer_id << std::endl;
+        LOG_INFO("🔒 Closed peer connection for {}", peer_id);
     }
 }
 
 bool WebRTCManager::startVideoStreaming(const std::string& peer_id, const std::string& images_dir_path) {
     try {
-        auto it = peer_connections_.find(peer_id);
-        if (it == peer_connections_.end()) {
+        auto session = peers_.find(peer_id);
+        if (!session) {
             std::cout << "⚠️  No peer connection found for " << peer_id << std::endl;
             return false;
         }
         
-        auto pc = it->second;
-        if (!pc) {
+        if (!session->pc) {
             std::cout << "⚠️  Invalid peer connection for " << peer_id << std::endl;
             return false;
         }
@@ -311,33 +851,33 @@ bool WebRTCManager::startVideoStreaming(const std::string& peer_id, const std::s
         std::cout << "🎥 Starting live image streaming for " << peer_id << std::endl;
         std::cout << "📁 Images directory: " << images_dir_path << std::endl;
         
-        // Get existing video track (created during peer connection setup)
-        auto track_it = video_tracks_.find(peer_id);
-        if (track_it == video_tracks_.end()) {
+        // Get existing video track of the first camera (created during peer connection setup)
+        auto camera = session->camera(0);
+        if (!camera || !camera->track) {
             std::cout << "⚠️  No video track found for " << peer_id << std::endl;
             return false;
         }
         
         // Wait for track to be ready before starting streaming
-        auto track = track_it->second;
+        auto track = camera->track;
         std::cout << "⏳ Waiting for video track to be ready..." << std::endl;
         
-        // Start streaming in background thread with track readiness check
-        streaming_active_[peer_id] = true;
-        streaming_threads_[peer_id] = std::thread([this, peer_id, images_dir_path, track]() {
-            // Wait for track to be open
-            int wait_count = 0;
-            while (wait_count < 50 && !track->isOpen()) {  // Wait up to 5 seconds
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                wait_count++;
-            }
-            
+        // Poll the track from the scheduler until it is open, then start streaming
+        auto wait_count = std::make_shared<int>(0);
+        auto wait_for_track = [this, peer_id, images_dir_path, track, wait_count]() {
             if (track->isOpen()) {
                 std::cout << "✅ Track is ready, starting streaming..." << std::endl;
-                this->streamImagesFromDirectory(peer_id, images_dir_path);
-            } else {
+                this->startImageStream(peer_id, images_dir_path);
+                return false;
+            }
+            if (++*wait_count >= 50) {  // Wait up to 5 seconds
                 std::cout << "❌ Track failed to open within timeout" << std::endl;
+                return false;
             }
+            return true;
+        };
+        setPeerStream(*session, *camera, [&]() {
+            return scheduler_.every(std::chrono::milliseconds(100), wait_for_track);
         });
         
         return true;
@@ -351,25 +891,56 @@ bool WebRTCManager::startVideoStreaming(const std::string& peer_id, const std::s
 void WebRTCManager::stopVideoStreaming(const std::string& peer_id) {
     std::cout << "🛑 Stopping video streaming for " << peer_id << std::endl;
     
-    // Stop streaming
-    auto active_it = streaming_active_.find(peer_id);
-    if (active_it != streaming_active_.end()) {
-        active_it->second = false;
+    if (auto session = peers_.find(peer_id)) {
+        stopSessionStreaming(*session);
     }
-    
-    // Wait for thread to finish
-    auto thread_it = streaming_threads_.find(peer_id);
-    if (thread_it != streaming_threads_.end() && thread_it->second.joinable()) {
-        thread_it->second.join();
-        streaming_threads_.erase(thread_it);
+}
+
+void WebRTCManager::stopSessionStreaming(PeerSession& session) {
+    for (const CameraTrackPtr& camera : session.cameras) {
+        stopCameraStreaming(session, *camera);
     }
+}
+
+void WebRTCManager::stopCameraStreaming(PeerSession& session, CameraTrack& camera) {
+    leaveBroadcast(session, camera);
     
-    // Clean up
-    streaming_active_.erase(peer_id);
-    video_tracks_.erase(peer_id);
+    // Stop the camera's stream and wait for its current step to return
+    StreamScheduler::StreamId id = 0;
+    {
+        std::lock_guard<std::mutex> lock(session.mutex);
+        id = camera.stream;
+        camera.stream = 0;
+        camera.pacer.reset();
+        camera.playback.reset();
+        camera.file_path.clear();
+    }
+    if (id) {
+        scheduler_.cancel(id);  // outside the lock: the stream may be starting another one
+    }
+}
+
+void WebRTCManager::setPeerStream(PeerSession& session, CameraTrack& camera,
+                                  const std::function<StreamScheduler::StreamId()>& schedule) {
+    StreamScheduler::StreamId previous = 0;
+    StreamScheduler::StreamId id = 0;
+    {
+        // Held while scheduling, so a task that starts the next stream as soon
+        // as it runs cannot register it before the task itself is registered
+        std::lock_guard<std::mutex> lock(session.mutex);
+        camera.playback.reset();  // set again by schedule() for a file stream
+        camera.file_path.clear();
+        id = schedule();
+        previous = camera.stream;
+        camera.stream = id;
+    }
+    // A camera has one stream at a time; starting another replaces it
+    if (previous && previous != id) {
+        scheduler_.cancel(previous);
+    }
 }
 
-void WebRTCManager::streamImagesFromDirectory(const std::string& peer_id, const std::string& images_dir) {
+void WebRTCManager::startImageStream(const std::string& peer_id, const std::string& images_dir) {
     try {
         std::cout << "📁 Loading images from directory: " << images_dir << std::endl;
         
@@ -383,54 +954,40 @@ void WebRTCManager::streamImagesFromDirectory(const std::string& peer_id, const
         std::cout << "📊 Found " << image_files.size() << " images" << std::endl;
         
         // Get video track
-        auto track_it = video_tracks_.find(peer_id);
-        if (track_it == video_tracks_.end()) {
+        auto session = peers_.find(peer_id);
+        auto camera = session ? session->camera(0) : nullptr;
+        if (!camera || !camera->track) {
             std::cout << "⚠️  No video track found for " << peer_id << std::endl;
             return;
         }
         
-        auto track = track_it->second;
-        if (!track) {
+        auto track = camera->track;
+        auto sender = camera->sender;
+        if (!track || !sender) {
             std::cout << "⚠️  Invalid video track for " << peer_id << std::endl;
             return;
         }
         
-        // Stream images at 30 FPS
-        const int fps = 30;
-        const auto frame_duration = std::chrono::milliseconds(1000 / fps);
-        
-        std::cout << "🎬 Starting 30 FPS image streaming..." << std::endl;
-        
-        size_t frame_count = 0;
-        auto& active = streaming_active_[peer_id];
-        
-        while (active && frame_count < image_files.size()) {
-            // Load and process image
-            cv::Mat frame = loadAndResizeImage(image_files[frame_count]);
-            if (frame.empty()) {
-                std::cout << "⚠️  Failed to load image: " << image_files[frame_count] << std::endl;
-                frame_count++;
-                continue;
-            }
-            
-            // Send frame
-            sendH264Frame(track, frame);
-            
-            // Only log first and last frame
-            if (frame_count == 0) {
-                std::cout << "📤 Started sending frames (" << frame.cols << "x" << frame.rows << ") at 30 FPS..." << std::endl;
-            }
-            
-            frame_count++;
-            
-            // Wait for next frame timing
-            std::this_thread::sleep_for(frame_duration);
+        if (broadcast_enabled_) {
+            joinBroadcast(*session, *camera, "images:" + images_dir, [this, image_files](std::shared_ptr<BroadcastSource> broadcast) {
+                return std::make_shared<ImageStream>(broadcast->name(), image_files, decode_pool_, broadcast,
+                                                     std::make_shared<PacingScheduler>());
+            });
+            return;
         }
         
-        std::cout << "✅ Image streaming completed for " << peer_id << " (" << frame_count << " frames sent)" << std::endl;
+        auto pacer = std::make_shared<PacingScheduler>();
+        
+        // Decoding runs ahead on the shared pool; the stream only pops, encodes and sends
+        auto stream = std::make_shared<ImageStream>(peer_id, std::move(image_files), decode_pool_,
+                                                    std::make_shared<PeerOutput>(track, sender), pacer);
+        setPeerStream(*session, *camera, [&]() {
+            camera->pacer = pacer;
+            return scheduler_.add(stream);
+        });
         
     } catch (const std::exception& e) {
-        std::cerr << "❌ Error in image streaming thread for " << peer_id << ": " << e.what() << std::endl;
+        std::cerr << "❌ Error starting image streaming for " << peer_id << ": " << e.what() << std::endl;
     }
 }
 
@@ -459,270 +1016,546 @@ std::vector<std::string> WebRTCManager::getImageFiles(const std::string& directo
     return image_files;
 }
 
-cv::Mat WebRTCManager::loadAndResizeImage(const std::string& image_path) {
+bool WebRTCManager::startH264FileStreaming(const std::string& peer_id, const std::string& h264_file_path,
+                                           size_t camera_index) {
     try {
-        // Load image
-        cv::Mat image = cv::imread(image_path);
-        if (image.empty()) {
-            std::cerr << "❌ Failed to load image: " << image_path << std::endl;
-            return cv::Mat();
+        auto session = peers_.find(peer_id);
+        if (!session) {
+            std::cout << "⚠️  No peer connection found for " << peer_id << std::endl;
+            return false;
+        }
+        
+        auto camera = session->camera(camera_index);
+        if (!camera || !camera->track) {
+            std::cout << "⚠️  No video track " << camera_index << " found for " << peer_id << std::endl;
+            return false;
+        }
+        
+        auto track = camera->track;
+        if (!track->isOpen()) {
+            std::cout << "⚠️  Track is not ready for " << peer_id << std::endl;
+            return false;
+        }
+        
+        std::cout << "🎬 Starting H264 file streaming: " << h264_file_path << std::endl;
+        
+        // The file is mapped and indexed once and shared by every peer streaming it
+        auto source = media_cache_.acquire(h264_file_path);
+        if (!source) {
+            std::cout << "❌ Failed to load video file: " << h264_file_path << std::endl;
+            return false;
         }
         
-        // Resize to standard resolution for WebRTC (640x480)
-        cv::Mat resized;
-        cv::resize(image, resized, cv::Size(640, 480));
+        std::cout << "🔍 " << source->unitCount() << " access units, "
+                  << media_cache_.activeSources() << " video file(s) mapped" << std::endl;
+        
+        if (broadcast_enabled_) {
+            // Shared by every viewer, so not seekable; it still loops with STREAM_LOOP=1
+            return joinBroadcast(*session, *camera, "file:" + h264_file_path, [source](std::shared_ptr<BroadcastSource> broadcast) {
+                return std::make_shared<FileStream>(broadcast->name(), source, broadcast,
+                                                    std::make_shared<PacingScheduler>(),
+                                                    std::make_shared<PlaybackControl>());
+            });
+        }
         
-        return resized;
+        // Wait a bit for track to stabilize
+        return startFileStream(*session, *camera, h264_file_path, source, std::make_shared<PlaybackControl>(),
+                               std::chrono::milliseconds(500));
         
     } catch (const std::exception& e) {
-        std::cerr << "❌ Error processing image " << image_path << ": " << e.what() << std::endl;
-        return cv::Mat();
+        std::cerr << "❌ Error starting H264 file streaming: " << e.what() << std::endl;
+        return false;
     }
 }
 
-void WebRTCManager::sendH264Frame(std::shared_ptr<rtc::Track> track, const cv::Mat& frame) {
-    if (!track || frame.empty()) {
-        std::cout << "⚠️  Invalid track or empty frame" << std::endl;
-        return;
+bool WebRTCManager::startFileStream(PeerSession& session, CameraTrack& camera, const std::string& path,
+                                    std::shared_ptr<const MediaSource> source,
+                                    std::shared_ptr<PlaybackControl> playback,
+                                    StreamScheduler::Clock::duration delay) {
+    auto sender = camera.sender;
+    if (!sender) {
+        std::cout << "⚠️  No RTP sender for " << session.peer_id << std::endl;
+        return false;
     }
     
-    if (!track->isOpen()) {
-        std::cout << "⚠️  Track is not open" << std::endl;
-        return;
+    // Units are sent in decode order, so they are released on their DTS;
+    // all NALs of one access unit go out back-to-back
+    auto pacer = std::make_shared<PacingScheduler>();
+    
+    std::cout << "📤 Started sending H264 access units via WebRTC..." << std::endl;
+    
+    auto stream = std::make_shared<FileStream>(session.peer_id + "/" + camera.mid, source,
+                                               std::make_shared<PeerOutput>(camera.track, sender), pacer, playback);
+    setPeerStream(session, camera, [&]() {
+        camera.pacer = pacer;
+        camera.playback = playback;
+        camera.file_path = path;
+        return scheduler_.add(stream, StreamScheduler::Clock::now() + delay);
+    });
+    return true;
+}
+
+bool WebRTCManager::joinBroadcast(PeerSession& session, CameraTrack& camera, const std::string& key,
+                                  const ProducerFactory& make_producer) {
+    const std::string subscriber = session.peer_id + "/" + camera.mid;
+    auto track = camera.track;
+    auto sender = camera.sender;
+    if (!track || !sender) {
+        std::cout << "⚠️  No video track found for " << subscriber << std::endl;
+        return false;
     }
     
-    try {
-        // Encode frame as JPEG for WebRTC (simpler approach)
-        std::vector<uchar> encoded_image;
-        std::vector<int> compression_params = {cv::IMWRITE_JPEG_QUALITY, 80};
-        
-        if (!cv::imencode(".jpg", frame, encoded_image, compression_params)) {
-            std::cout << "⚠️  Failed to encode frame" << std::endl;
-            return;
+    // Watching a broadcast replaces whatever the camera was showing before
+    leaveBroadcast(session, camera);
+    
+    // Sinks only run inside publish(), called by the producer stream that owns
+    // the source, so the raw pointer is safe
+    uint64_t generation = sender->beginStream();
+    auto make_sink = [track, sender, generation](BroadcastSource* raw) {
+        return [track, sender, raw, generation](const SharedAccessUnitPtr& unit, double pts_seconds) {
+            if (!track->isOpen()) {
+                return false;
+            }
+            if (sender->keyframe_requested.exchange(false)) {
+                raw->requestKeyframe();
+            }
+            sendAccessUnit(track, *sender, generation, unit->au, pts_seconds, unit->capture_ms);
+            return true;
+        };
+    };
+    
+    std::shared_ptr<BroadcastSource> broadcast;
+    bool created = false;
+    {
+        // Subscribed under the lock, so the last viewer leaving at the same
+        // time cannot stop the source between the lookup and the subscribe
+        std::lock_guard<std::mutex> lock(broadcasts_mutex_);
+        auto& slot = broadcasts_[key];
+        if (!slot || slot->finished() || !slot->running()) {
+            slot = std::make_shared<BroadcastSource>(key);
+            created = true;
         }
-        
-        // Convert to rtc::binary
-        rtc::binary packet;
-        packet.reserve(encoded_image.size());
-        
-        for (const auto& byte : encoded_image) {
-            packet.push_back(static_cast<std::byte>(byte));
+        broadcast = slot;
+        broadcast->subscribe(subscriber, make_sink(broadcast.get()));
+    }
+    {
+        std::lock_guard<std::mutex> lock(session.mutex);
+        camera.broadcast_key = key;
+    }
+    
+    if (created) {
+        std::cout << "📡 Starting broadcast " << key << std::endl;
+        if (!scheduler_.add(make_producer(broadcast))) {
+            broadcast->stop();
+            return false;
         }
-        
-        if (track->send(packet)) {
-            // Success - frame sent
-        } else {
-            std::cout << "⚠️  Failed to send frame data" << std::endl;
+    }
+    return true;
+}
+
+void WebRTCManager::leaveBroadcast(PeerSession& session, CameraTrack& camera) {
+    std::string key;
+    {
+        std::lock_guard<std::mutex> lock(session.mutex);
+        key.swap(camera.broadcast_key);
+    }
+    if (key.empty()) {
+        return;
+    }
+    
+    std::shared_ptr<BroadcastSource> idle;
+    {
+        std::lock_guard<std::mutex> lock(broadcasts_mutex_);
+        auto it = broadcasts_.find(key);
+        if (it != broadcasts_.end()) {
+            it->second->unsubscribe(session.peer_id + "/" + camera.mid);
+            if (it->second->subscriberCount() == 0) {
+                idle = it->second;
+                broadcasts_.erase(it);
+            }
         }
-        
-    } catch (const std::exception& e) {
-        std::cerr << "❌ Error sending frame: " << e.what() << std::endl;
+    }
+    if (idle) {
+        idle->stop();  // its producer stream ends on its next step
     }
 }
 
-std::vector<uint8_t> WebRTCManager::encodeFrameToH264(const cv::Mat& frame) {
-    std::vector<uint8_t> h264_data;
+bool WebRTCManager::getPacingStats(const std::string& peer_id, PacingStats& stats) {
+    auto session = peers_.find(peer_id);
+    auto camera = session ? session->camera(0) : nullptr;
+    if (!camera) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(session->mutex);
+    if (!camera->pacer) {
+        return false;
+    }
+    stats = camera->pacer->stats();
+    return true;
+}
+
+bool WebRTCManager::handlePlaybackControl(const std::string& peer_id, const Json::Value& command) {
+    auto session = peers_.find(peer_id);
+    if (!session) {
+        LOG_WARN("⚠️  No peer connection found for {}", peer_id);
+        return false;
+    }
+    ControlCommand parsed = controlCommandFromJson(command);
+    ControlResult result = applyControl(*session, parsed);
     
-    try {
-        // For libdatachannel, we need to send raw RGB/BGR frame data
-        // The library will handle H264 encoding internally
-        
-        // Ensure frame is continuous in memory
-        cv::Mat continuous_frame;
-        if (frame.isContinuous()) {
-            continuous_frame = frame;
-        } else {
-            frame.copyTo(continuous_frame);
+    // Position is that of the last unit sent; a seek shows up from the next report
+    auto camera = session->camera(parsed.camera.value_or(0));
+    ControlTelemetry telemetry = camera ? telemetryFor(*session, *camera) : ControlTelemetry();
+    telemetry.result = result;
+    if (publish_callback_) {
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        publish_callback_(thing_name_ + "/robot-control/" + peer_id + "/playback",
+                          Json::writeString(builder, toJson(telemetry)));
+    }
+    return result == ControlResult::Ok;
+}
+
+ControlResult WebRTCManager::applyControl(PeerSession& session, const ControlCommand& command) {
+    if (command.active_cameras) {
+        setActiveCameras(session, *command.active_cameras);
+    }
+    
+    auto camera = session.camera(command.camera.value_or(0));
+    if (!camera) {
+        std::cout << "⚠️  " << session.peer_id << " has no camera " << command.camera.value_or(0) << std::endl;
+        return ControlResult::Rejected;
+    }
+    const std::string peer_id = session.peer_id + "/" + camera->mid;
+    if (command.keyframe && camera->sender) {
+        camera->sender->keyframe_requested = true;  // as for a PLI: live encoders and broadcasts
+    }
+    
+    std::shared_ptr<PlaybackControl> playback;
+    std::string file_path;
+    {
+        std::lock_guard<std::mutex> lock(session.mutex);
+        playback = camera->playback;
+        file_path = camera->file_path;
+    }
+    if (!playback) {
+        if (command.seek_seconds || command.pause || command.rate || command.loop || command.quality) {
+            std::cout << "⚠️  " << peer_id << " is not playing a file of its own; ignoring playback control" << std::endl;
+            return ControlResult::Rejected;
         }
-        
-        // Get raw BGR data
-        size_t data_size = continuous_frame.total() * continuous_frame.elemSize();
-        h264_data.assign(continuous_frame.data, continuous_frame.data + data_size);
-        
-    } catch (const std::exception& e) {
-        std::cerr << "❌ Error preparing frame data: " << e.what() << std::endl;
+        return ControlResult::Ok;
+    }
+    
+    std::string variant = command.quality ? availableVariant(file_path, *command.quality) : file_path;
+    if (variant != file_path) {
+        // Same recording, another encoding: a new stream that carries on where this one is
+        std::shared_ptr<const MediaSource> source;
+        if (!variant.empty()) {
+            source = media_cache_.acquire(variant);
+        }
+        if (!source) {
+            std::cout << "⚠️  No " << *command.quality << "p variant of " << file_path << " for " << peer_id << std::endl;
+            return ControlResult::Unavailable;
+        }
+        auto next = std::make_shared<PlaybackControl>();
+        next->continueFrom(*playback);
+        if (!startFileStream(session, *camera, variant, source, next, StreamScheduler::Clock::duration::zero())) {
+            return ControlResult::Unavailable;
+        }
+        playback = next;
+        std::cout << "📶 " << peer_id << " switched to " << variant << std::endl;
     }
     
-    return h264_data;
+    if (command.rate) {
+        playback->setRate(*command.rate);
+    }
+    if (command.loop) {
+        playback->setLoop(*command.loop);
+    }
+    if (command.pause) {
+        playback->setPaused(*command.pause);
+    }
+    if (command.seek_seconds) {
+        playback->seek(*command.seek_seconds);
+    }
+    if (command.keyframe) {
+        playback->requestKeyframe();
+    }
+    std::cout << "🎛️  Playback control for " << peer_id << ": rate " << playback->rate() << "x, loop "
+              << (playback->loop() ? "on" : "off") << (playback->paused() ? ", paused" : "") << std::endl;
+    return ControlResult::Ok;
 }
 
-bool WebRTCManager::startH264FileStreaming(const std::string& peer_id, const std::string& h264_file_path) {
-    try {
-        auto it = peer_connections_.find(peer_id);
-        if (it == peer_connections_.end()) {
-            std::cout << "⚠️  No peer connection found for " << peer_id << std::endl;
-            return false;
+ControlTelemetry WebRTCManager::telemetryFor(PeerSession& session, CameraTrack& camera) {
+    ControlTelemetry telemetry;
+    telemetry.camera = camera.index;
+    telemetry.active_cameras = activeCameras(session);
+    std::shared_ptr<PlaybackControl> playback;
+    std::string file_path;
+    {
+        std::lock_guard<std::mutex> lock(session.mutex);
+        playback = camera.playback;
+        file_path = camera.file_path;
+    }
+    if (playback) {
+        telemetry.position = playback->position();
+        telemetry.duration = playback->duration();
+        telemetry.rate = playback->rate();
+        telemetry.flags |= kTelemetryControllable;
+        telemetry.flags |= playback->paused() ? kTelemetryPaused : 0;
+        telemetry.flags |= playback->loop() ? kTelemetryLoop : 0;
+        telemetry.quality = qualityOf(file_path);
+    }
+    if (const auto& sender = camera.sender) {
+        telemetry.frames_sent = sender->frames_sent;
+        if (sender->rtcp_stats) {
+            RtcpStats rtcp = sender->rtcp_stats->stats();
+            telemetry.bitrate_kbps = rtcp.bitrate_kbps;
+            telemetry.rtt_ms = rtcp.rtt_ms;
+            telemetry.fraction_lost = rtcp.fraction_lost;
+            telemetry.jitter_ms = rtcp.jitter_ms;
         }
-        
-        auto track_it = video_tracks_.find(peer_id);
-        if (track_it == video_tracks_.end()) {
-            std::cout << "⚠️  No video track found for " << peer_id << std::endl;
-            return false;
+    }
+    if (camera.track) {
+        telemetry.send_buffer_bytes = camera.track->bufferedAmount();
+    }
+    return telemetry;
+}
+
+void WebRTCManager::setupControlChannel(const PeerSessionPtr& session) {
+    const std::string peer_id = session->peer_id;
+    
+    // Negotiated: both ends create it on the agreed stream id, so it opens
+    // with the SCTP association instead of after an in-band open handshake
+    rtc::DataChannelInit init;
+    init.negotiated = true;
+    init.id = kControlChannelId;
+    auto channel = session->pc->createDataChannel("control", init);
+    session->control_channel = channel;
+    
+    // The channel lives in the session; its callbacks must not keep the session alive
+    std::weak_ptr<PeerSession> weak_session = session;
+    channel->onOpen([this, peer_id, weak_session]() {
+        std::cout << "🎛️  Control channel open for " << peer_id << std::endl;
+        if (auto session = weak_session.lock()) {
+            setTelemetryInterval(session, kDefaultTelemetryInterval);
         }
-        
-        auto track = track_it->second;
-        if (!track || !track->isOpen()) {
-            std::cout << "⚠️  Track is not ready for " << peer_id << std::endl;
-            return false;
+    });
+    channel->onClosed([peer_id]() {
+        std::cout << "❌ Control channel closed for " << peer_id << std::endl;
+    });
+    channel->onMessage([this, peer_id, weak_session](rtc::message_variant data) {
+        auto session = weak_session.lock();
+        if (!session) {
+            return;
         }
-        
-        std::cout << "🎬 Starting H264 file streaming: " << h264_file_path << std::endl;
-        
-        // Read H264/MP4 file
-        std::ifstream file(h264_file_path, std::ios::binary);
-        if (!file.is_open()) {
-            std::cout << "❌ Failed to open video file: " << h264_file_path << std::endl;
-            return false;
+        const rtc::binary* message = std::get_if<rtc::binary>(&data);
+        ControlCommand command;
+        if (!message ||
+            !decodeControlCommand(reinterpret_cast<const uint8_t*>(message->data()), message->size(), command)) {
+            LOG_WARN("⚠️ Malformed control message from {}", peer_id);
+            return;
         }
-        
-        // Read entire file
-        file.seekg(0, std::ios::end);
-        size_t file_size = file.tellg();
-        file.seekg(0, std::ios::beg);
-        
-        std::vector<uint8_t> video_data(file_size);
-        file.read(reinterpret_cast<char*>(video_data.data()), file_size);
-        file.close();
-        
-        std::cout << "📁 Loaded video file (" << file_size << " bytes)" << std::endl;
-        
-        // Extract NAL units from MP4 container
-        auto nal_units = extractNALUnits(video_data);
-        std::cout << "🔍 Extracted " << nal_units.size() << " NAL units from video file" << std::endl;
-        
-        if (nal_units.empty()) {
-            std::cout << "⚠️  No NAL units found in video file" << std::endl;
-            return false;
+        ControlResult result = applyControl(*session, command);
+        if (command.telemetry_interval_ms) {
+            setTelemetryInterval(session, std::chrono::milliseconds(*command.telemetry_interval_ms));
         }
-        
-        const auto frame_duration = std::chrono::milliseconds(33); // 30 FPS
-        
-        streaming_active_[peer_id] = true;
-        streaming_threads_[peer_id] = std::thread([this, peer_id, nal_units, frame_duration, track]() {
-            try {
-                int nal_count = 0;
-                auto& active = streaming_active_[peer_id];
-                
-                std::cout << "📤 Started sending H264 NAL units via WebRTC..." << std::endl;
-                
-                // Wait a bit for track to stabilize
-                std::this_thread::sleep_for(std::chrono::milliseconds(500));
-                
-                for (const auto& nal_unit : nal_units) {
-                    if (!active) break;
-                    
-                    try {
-                        if (track->isOpen()) {
-                            // Send NAL unit with proper RTP packetization
-                            sendNALUnit(track, nal_unit);
-                            
-                            if (nal_count % 10 == 0) {
-                                std::cout << "📤 Sent NAL unit " << nal_count << " (size: " << nal_unit.size() << " bytes)" << std::endl;
-                            }
-                        } else {
-                            std::cout << "⚠️ Track closed, stopping stream" << std::endl;
-                            break;
-                        }
-                    } catch (const std::exception& e) {
-                        std::cout << "⚠️ Error sending NAL unit: " << e.what() << std::endl;
-                        // Continue with next NAL unit
-                    }
-                    
-                    nal_count++;
-                    
-                    // Frame rate control - send frames at 30 FPS
-                    std::this_thread::sleep_for(frame_duration);
+        auto camera = session->camera(command.camera.value_or(0));
+        if (!camera) {
+            camera = session->camera(0);  // the result still has to reach the client
+        }
+        if (camera) {
+            sendTelemetry(*session, *camera, result);
+        }
+    });
+    std::cout << "✅ Control channel added for " << peer_id << std::endl;
+}
+
+void WebRTCManager::setTelemetryInterval(const PeerSessionPtr& session, std::chrono::milliseconds interval) {
+    StreamScheduler::StreamId id = 0;
+    if (interval.count() > 0) {
+        std::weak_ptr<PeerSession> weak_session = session;
+        id = scheduler_.every(interval, [this, weak_session]() {
+            auto session = weak_session.lock();
+            if (!session || !session->control_channel->isOpen()) {
+                return false;
+            }
+            // One report per streaming camera. Stale figures are worthless: skip
+            // a report rather than queue it behind a congested uplink.
+            uint32_t active = activeCameras(*session);
+            for (const CameraTrackPtr& camera : session->cameras) {
+                if ((active >> camera->index & 1) &&
+                    session->control_channel->bufferedAmount() < kMaxTelemetryBacklog) {
+                    sendTelemetry(*session, *camera, std::nullopt);
                 }
-                
-                std::cout << "✅ H264 NAL unit streaming completed (" << nal_count << " NAL units sent)" << std::endl;
-                
-            } catch (const std::exception& e) {
-                std::cerr << "❌ Error in H264 streaming thread: " << e.what() << std::endl;
             }
-        });
-        
-        return true;
-        
+            return true;
+        }, interval);
+    }
+    StreamScheduler::StreamId previous = 0;
+    {
+        std::lock_guard<std::mutex> lock(session->mutex);
+        previous = session->telemetry;
+        session->telemetry = id;
+    }
+    if (previous) {
+        scheduler_.cancel(previous);
+    }
+}
+
+bool WebRTCManager::sendTelemetry(PeerSession& session, CameraTrack& camera, std::optional<ControlResult> result) {
+    auto channel = session.control_channel;
+    if (!channel || !channel->isOpen()) {
+        return false;
+    }
+    ControlTelemetry telemetry = telemetryFor(session, camera);
+    telemetry.result = result;
+    std::vector<uint8_t> message;
+    encodeControlTelemetry(telemetry, message);
+    try {
+        return channel->send(reinterpret_cast<const std::byte*>(message.data()), message.size());
     } catch (const std::exception& e) {
-        std::cerr << "❌ Error starting H264 file streaming: " << e.what() << std::endl;
+        LOG_WARN("⚠️ Failed to send telemetry to {}: {}", session.peer_id, e.what());
         return false;
     }
 }
 
+StreamingMetrics WebRTCManager::collectMetrics() {
+    StreamingMetrics metrics;
+    for (const PeerSessionPtr& session : peers_.snapshot()) {
+        const std::string state = session->pc ? toString(session->pc->state()) : "none";
+        for (const CameraTrackPtr& camera : session->cameras) {
+            PeerMetrics peer;
+            peer.peer_id = session->peer_id;
+            peer.camera = camera->mid;
+            peer.state = state;
+            if (camera->track) {
+                peer.send_buffer_bytes = camera->track->bufferedAmount();
+            }
+            if (const auto& sender = camera->sender) {
+                peer.frames_sent = sender->frames_sent;
+                peer.send_failures = sender->send_failures;
+                if (sender->rtcp_stats) {
+                    RtcpStats rtcp = sender->rtcp_stats->stats();
+                    peer.rtp_packets = rtcp.rtp_packets;
+                    peer.rtp_bytes = rtcp.rtp_bytes;
+                    peer.bitrate_kbps = rtcp.bitrate_kbps;
+                    peer.rtt_ms = rtcp.rtt_ms;
+                    peer.nack_requests = rtcp.nack_requests;
+                    peer.nacked_packets = rtcp.nacked_packets;
+                    peer.pli_requests = rtcp.pli_requests;
+                    peer.fraction_lost = rtcp.fraction_lost;
+                    peer.packets_lost = rtcp.packets_lost;
+                    peer.jitter_ms = rtcp.jitter_ms;
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(session->mutex);
+                peer.active = camera->active;
+                peer.broadcast = camera->broadcast_key;
+                if (camera->pacer) {
+                    peer.has_pacing = true;
+                    peer.pacing = camera->pacer->stats();
+                }
+            }
+            metrics.peers.push_back(std::move(peer));
+        }
+    }
+
+    metrics.scheduled_streams = scheduler_.activeStreams();
+    metrics.scheduler_threads = scheduler_.threadCount();
+    metrics.decode_queue = decode_pool_.queueDepth();
+    {
+        std::lock_guard<std::mutex> lock(broadcasts_mutex_);
+        metrics.broadcasts = broadcasts_.size();
+    }
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        metrics.early_candidate_peers = pending_candidates_.size();
+    }
+    metrics.setup_timeline = timeline_stats_.toJson();
+    return metrics;
+}
+
 std::string WebRTCManager::findVideoFile() {
-    std::cout << "🔍 Looking for video files in /workspace/videos..." << std::endl;
+    std::vector<std::string> videos = findVideoFiles();
+    if (videos.empty()) {
+        return "";
+    }
+    LOG_INFO("📹 Using video: {}", videos[0]);
+    return videos[0];
+}
+
+std::vector<std::string> WebRTCManager::findVideoFiles() {
+    LOG_INFO("🔍 Looking for video files in /workspace/videos...");
     
-    // Look for MP4 files in the videos directory (copied during Docker build)
+    // Look for MP4 files and raw H.264 streams (the bag processor's passthrough
+    // output) in the videos directory (copied during Docker build).
+    // "_<N>p" files are other qualities of a recording, not other cameras: each
+    // recording plays its unsuffixed original, or its tallest rendition when the
+    // ladder wrote renditions only
     std::vector<cv::String> videos;
-    cv::glob("/workspace/videos/*.mp4", videos);
+    for (const char* pattern : {"/workspace/videos/*.mp4", "/workspace/videos/*.h264"}) {
+        std::vector<cv::String> matches;
+        cv::glob(pattern, matches);
+        videos.insert(videos.end(), matches.begin(), matches.end());
+    }
+    std::map<std::string, std::pair<int, std::string>> best;  // original path -> (rank, file)
+    for (const cv::String& video : videos) {
+        int lines = qualityOf(video);
+        int rank = lines == 0 ? std::numeric_limits<int>::max() : lines;
+        auto& entry = best[qualityVariant(video, 0)];
+        if (rank > entry.first) {
+            entry = {rank, video};
+        }
+    }
+    std::vector<std::string> recordings;
+    for (const auto& entry : best) {
+        recordings.push_back(entry.second.second);
+    }
     
-    if (!videos.empty()) {
-        std::cout << "✅ Found " << videos.size() << " video file(s)" << std::endl;
-        std::cout << "📹 Using video: " << videos[0] << std::endl;
-        return videos[0];
+    if (!recordings.empty()) {
+        LOG_INFO("✅ Found {} video file(s)", recordings.size());
+        return recordings;
     }
     
-    std::cout << "⚠️ No video files found in /workspace/videos/" << std::endl;
+    LOG_WARN("⚠️ No video files found in /workspace/videos/");
     
     // List what's actually there for debugging
-    std::cout << "📁 Contents of /workspace/videos:" << std::endl;
+    LOG_INFO("📁 Contents of /workspace/videos:");
+    logging::flush();  // ls writes to stdout directly
     system("ls -la /workspace/videos/ 2>/dev/null || echo 'Directory not found'");
     
-    return "";
+    return recordings;
 }
 
-void WebRTCManager::startTestPatternStreaming(const std::string& peer_id) {
+void WebRTCManager::startTestPatternStreaming(const std::string& peer_id, size_t camera_index) {
     try {
-        auto track_it = video_tracks_.find(peer_id);
-        if (track_it == video_tracks_.end()) {
+        auto session = peers_.find(peer_id);
+        auto camera = session ? session->camera(camera_index) : nullptr;
+        if (!camera || !camera->track) {
             std::cout << "⚠️  No video track found for " << peer_id << std::endl;
             return;
         }
         
-        auto track = track_it->second;
-        if (!track || !track->isOpen()) {
+        auto track = camera->track;
+        if (!track->isOpen()) {
             std::cout << "⚠️  Track is not ready for " << peer_id << std::endl;
             return;
         }
         
-        std::cout << "🎨 Starting test pattern streaming for " << peer_id << std::endl;
+        std::cout << "🎨 Starting test pattern streaming for " << peer_id << " on " << camera->mid << std::endl;
         
-        // Create a simple test pattern (color bars)
-        streaming_active_[peer_id] = true;
-        streaming_threads_[peer_id] = std::thread([this, peer_id, track]() {
-            try {
-                auto& active = streaming_active_[peer_id];
-                int frame_count = 0;
-                const auto frame_duration = std::chrono::milliseconds(33); // 30 FPS
-                
-                while (active && frame_count < 300) { // Stream for 10 seconds
-                    // Create a simple test pattern
-                    rtc::binary packet;
-                    
-                    // Send a small test packet (simulate video data)
-                    std::string test_data = "TEST_FRAME_" + std::to_string(frame_count);
-                    for (char c : test_data) {
-                        packet.push_back(static_cast<std::byte>(c));
-                    }
-                    
-                    if (track->send(packet)) {
-                        if (frame_count % 30 == 0) {
-                            std::cout << "📺 Sent test frame " << frame_count << " via WebRTC" << std::endl;
-                        }
-                    } else {
-                        std::cout << "⚠️  Failed to send test frame" << std::endl;
-                    }
-                    
-                    frame_count++;
-                    std::this_thread::sleep_for(frame_duration);
-                }
-                
-                std::cout << "✅ Test pattern streaming completed (" << frame_count << " frames sent)" << std::endl;
-                
-            } catch (const std::exception& e) {
-                std::cerr << "❌ Error in test pattern streaming: " << e.what() << std::endl;
-            }
-        });
+        auto sender = camera->sender;
+        if (!sender) {
+            std::cout << "⚠️  No RTP sender for " << peer_id << std::endl;
+            return;
+        }
+        
+        // Color bars, encoded and paced from the scheduler like any other stream
+        auto stream = std::make_shared<TestPatternStream>(peer_id + "/" + camera->mid,
+                                                          std::make_shared<PeerOutput>(track, sender));
+        setPeerStream(*session, *camera, [&]() { return scheduler_.add(stream); });
         
     } catch (const std::exception& e) {
         std::cerr << "❌ Error starting test pattern: " << e.what() << std::endl;
@@ -733,287 +1566,124 @@ bool WebRTCManager::isWebRTCEnabled() const {
     return true;
 }
 
-std::vector<std::vector<uint8_t>> WebRTCManager::extractNALUnits(const std::vector<uint8_t>& mp4_data) {
-    std::vector<std::vector<uint8_t>> nal_units;
-    
-    // Look for H.264 NAL unit start codes (0x00000001 or 0x000001)
-    for (size_t i = 0; i < mp4_data.size() - 4; ) {
-        // Check for 4-byte start code (0x00000001)
-        if (mp4_data[i] == 0x00 && mp4_data[i+1] == 0x00 && 
-            mp4_data[i+2] == 0x00 && mp4_data[i+3] == 0x01) {
-            
-            size_t start = i + 4; // Skip start code
-            size_t end = start;
-            
-            // Find next start code
-            bool found_next = false;
-            for (size_t j = start + 1; j < mp4_data.size() - 3; j++) {
-                if ((mp4_data[j] == 0x00 && mp4_data[j+1] == 0x00 && 
-                     mp4_data[j+2] == 0x00 && mp4_data[j+3] == 0x01) ||
-                    (mp4_data[j] == 0x00 && mp4_data[j+1] == 0x00 && 
-                     mp4_data[j+2] == 0x01)) {
-                    end = j;
-                    found_next = true;
-                    break;
-                }
-            }
-            
-            if (!found_next) {
-                end = mp4_data.size();
-            }
-            
-            // Extract NAL unit
-            if (end > start && start < mp4_data.size()) {
-                std::vector<uint8_t> nal_unit(mp4_data.begin() + start, mp4_data.begin() + end);
-                
-                // Only process valid H.264 NAL units and ensure minimum size
-                if (!nal_unit.empty() && nal_unit.size() >= 1) {
-                    uint8_t nal_type = nal_unit[0] & 0x1F;
-                    
-                    // Only accept common H.264 NAL unit types (more restrictive filtering)
-                    if (nal_type >= 1 && nal_type <= 9) {
-                        
-                        // Don't apply emulation prevention - it's already handled in MP4
-                        nal_units.push_back(nal_unit);
-                        
-                        const char* type_name = "Unknown";
-                        switch (nal_type) {
-                            case 1: type_name = "Non-IDR"; break;
-                            case 5: type_name = "IDR"; break;
-                            case 6: type_name = "SEI"; break;
-                            case 7: type_name = "SPS"; break;
-                            case 8: type_name = "PPS"; break;
-                            case 9: type_name = "AU Delimiter"; break;
-                        }
-                        
-                        std::cout << "🔍 Found valid NAL unit (type: " << (int)nal_type 
-                                 << "-" << type_name << ", size: " << nal_unit.size() << " bytes)" << std::endl;
-                    } else {
-                        std::cout << "⚠️ Skipping invalid NAL unit type: " << (int)nal_type << std::endl;
-                    }
-                }
-            }
-            
-            i = end;
-        }
-        // Check for 3-byte start code (0x000001)  
-        else if (mp4_data[i] == 0x00 && mp4_data[i+1] == 0x00 && mp4_data[i+2] == 0x01) {
-            
-            size_t start = i + 3; // Skip start code
-            size_t end = start;
-            
-            // Find next start code
-            bool found_next = false;
-            for (size_t j = start + 1; j < mp4_data.size() - 3; j++) {
-                if ((mp4_data[j] == 0x00 && mp4_data[j+1] == 0x00 && 
-                     mp4_data[j+2] == 0x00 && mp4_data[j+3] == 0x01) ||
-                    (mp4_data[j] == 0x00 && mp4_data[j+1] == 0x00 && 
-                     mp4_data[j+2] == 0x01)) {
-                    end = j;
-                    found_next = true;
-                    break;
-                }
-            }
-            
-            if (!found_next) {
-                end = mp4_data.size();
-            }
-            
-            // Extract NAL unit
-            if (end > start && start < mp4_data.size()) {
-                std::vector<uint8_t> nal_unit(mp4_data.begin() + start, mp4_data.begin() + end);
-                
-                // Only process valid H.264 NAL units and ensure minimum size
-                if (!nal_unit.empty() && nal_unit.size() >= 1) {
-                    uint8_t nal_type = nal_unit[0] & 0x1F;
-                    
-                    // Only accept common H.264 NAL unit types (more restrictive filtering)
-                    if (nal_type >= 1 && nal_type <= 9) {
-                        
-                        // Don't apply emulation prevention - it's already handled in MP4
-                        nal_units.push_back(nal_unit);
-                        
-                        const char* type_name = "Unknown";
-                        switch (nal_type) {
-                            case 1: type_name = "Non-IDR"; break;
-                            case 5: type_name = "IDR"; break;
-                            case 6: type_name = "SEI"; break;
-                            case 7: type_name = "SPS"; break;
-                            case 8: type_name = "PPS"; break;
-                            case 9: type_name = "AU Delimiter"; break;
-                        }
-                        
-                        std::cout << "🔍 Found valid NAL unit (type: " << (int)nal_type 
-                                 << "-" << type_name << ", size: " << nal_unit.size() << " bytes)" << std::endl;
-                    } else {
-                        std::cout << "⚠️ Skipping invalid NAL unit type: " << (int)nal_type << std::endl;
-                    }
-                }
-            }
-            
-            i = end;
-        } else {
-            i++;
-        }
-    }
-    
-    return nal_units;
-}
-
-std::vector<uint8_t> WebRTCManager::applyEmulationPrevention(const std::vector<uint8_t>& nal_unit) {
-    std::vector<uint8_t> result;
-    result.reserve(nal_unit.size() * 1.1); // Reserve a bit more space
-    
-    for (size_t i = 0; i < nal_unit.size(); i++) {
-        result.push_back(nal_unit[i]);
-        
-        // Check for emulation prevention pattern
-        if (i >= 1 && result.size() >= 2) {
-            size_t len = result.size();
-            // If we have 0x00 0x00 followed by 0x00, 0x01, 0x02, or 0x03
-            // we need to insert emulation prevention byte (0x03)
-            if (result[len-2] == 0x00 && result[len-1] == 0x00) {
-                if (i + 1 < nal_unit.size()) {
-                    uint8_t next_byte = nal_unit[i + 1];
-                    if (next_byte <= 0x03) {
-                        result.push_back(0x03); // Insert emulation prevention byte
-                        std::cout << "🔧 Applied emulation prevention at position " << i << std::endl;
-                    }
-                }
-            }
-        }
-    }
-    
-    return result;
+void WebRTCManager::appendNAL(rtc::binary& buffer, const uint8_t* data, size_t size) {
+    // 4-byte big-endian length prefix (H264RtpPacketizer::Separator::Length)
+    buffer.push_back(static_cast<std::byte>(size >> 24));
+    buffer.push_back(static_cast<std::byte>(size >> 16));
+    buffer.push_back(static_cast<std::byte>(size >> 8));
+    buffer.push_back(static_cast<std::byte>(size));
+    const std::byte* bytes = reinterpret_cast<const std::byte*>(data);
+    buffer.insert(buffer.end(), bytes, bytes + size);
 }
 
-void WebRTCManager::sendNALUnit(std::shared_ptr<rtc::Track> track, const std::vector<uint8_t>& nal_unit) {
-    if (!track || !track->isOpen() || nal_unit.empty()) {
+void WebRTCManager::sendAccessUnit(std::shared_ptr<rtc::Track> track, VideoSender& sender, uint64_t generation,
+                                   const AccessUnit& au, double pts_seconds, int64_t capture_ms) {
+    if (!track || !track->isOpen() || au.nal_units.empty()) {
         return;
     }
-    
-    // Skip very small NAL units that may be invalid/padding
-    if (nal_unit.size() < 2) {
-        std::cout << "⚠️ Skipping tiny NAL unit (size: " << nal_unit.size() << " bytes)" << std::endl;
-        return;
+    // Held to the end: the stream replacing this one may be sending from another worker
+    std::lock_guard<std::mutex> lock(sender.mutex);
+    if (generation != sender.generation.load()) {
+        return;  // the stream was replaced while this unit was on its way
     }
     
     try {
-        // Fragment large NAL units to avoid MTU issues
-        const size_t MAX_PACKET_SIZE = 1200; // Safe MTU size
-        const size_t START_CODE_SIZE = 4;
-        const size_t MIN_PACKET_SIZE = 12; // Minimum for RTP header + data
-        
-        uint8_t nal_type = nal_unit[0] & 0x1F;
-        const char* nal_type_name = "Unknown";
-        switch (nal_type) {
-            case 1: nal_type_name = "Non-IDR"; break;
-            case 5: nal_type_name = "IDR"; break;
-            case 6: nal_type_name = "SEI"; break;
-            case 7: nal_type_name = "SPS"; break;
-            case 8: nal_type_name = "PPS"; break;
-            case 9: nal_type_name = "AU Delimiter"; break;
-        }
-        
-        // Skip invalid NAL unit types
-        if (nal_type == 0 || nal_type > 9) {
-            std::cout << "⚠️ Skipping invalid NAL unit type: " << (int)nal_type << std::endl;
-            return;
+        rtc::binary& buffer = sender.buffer;
+        buffer.clear();
+        
+        // Latency SEI goes after the parameter sets and before the first slice
+        const bool with_sei = sender.sei_mode != SeiTimestampMode::Off;
+        if (with_sei) {
+            bool use_capture = sender.sei_mode == SeiTimestampMode::Capture && capture_ms > 0;
+            buildTimestampSei(use_capture ? capture_ms : wallClockMillis(), sender.sei);
+            
+            auto first_vcl = std::find_if(au.nal_units.begin(), au.nal_units.end(), [](const NalView& nal) {
+                return nal.type() >= 1 && nal.type() <= 5;
+            });
+            sender.nals.assign(au.nal_units.begin(), first_vcl);
+            sender.nals.push_back({sender.sei.data(), sender.sei.size()});
+            sender.nals.insert(sender.nals.end(), first_vcl, au.nal_units.end());
         }
-        
-        // Ensure minimum packet size for RTP compatibility
-        size_t total_packet_size = nal_unit.size() + START_CODE_SIZE;
-        if (total_packet_size < MIN_PACKET_SIZE) {
-            std::cout << "⚠️ Skipping NAL unit too small for RTP (type " << (int)nal_type 
-                     << ", " << total_packet_size << " bytes)" << std::endl;
-            return;
+        const std::vector<NalView>& nals = with_sei ? sender.nals : au.nal_units;
+        
+        // Aggregate leading parameter sets / SEI into one STAP-A (RFC 6184 5.7.1).
+        // The packetizer sends it as a single NAL unit packet, and the receiver
+        // gets SPS+PPS in one packet right before the IDR.
+        size_t first = 0;
+        size_t stap_size = 1;
+        uint8_t stap_nri = 0;
+        while (first < nals.size()) {
+            const NalView& nal = nals[first];
+            uint8_t type = nal.type();
+            if ((type != 6 && type != 7 && type != 8) || stap_size + 2 + nal.size > kMaxRtpPayload) {
+                break;
+            }
+            stap_size += 2 + nal.size;
+            stap_nri = std::max<uint8_t>(stap_nri, nal.data[0] & 0x60);
+            first++;
         }
         
-        // If NAL unit + start code fits in one packet, send as single packet
-        if (total_packet_size <= MAX_PACKET_SIZE) {
-            rtc::binary packet;
-            packet.reserve(total_packet_size);
-            
-            // Add NAL unit start code
-            packet.push_back(static_cast<std::byte>(0x00));
-            packet.push_back(static_cast<std::byte>(0x00));
-            packet.push_back(static_cast<std::byte>(0x00));
-            packet.push_back(static_cast<std::byte>(0x01));
-            
-            // Add NAL unit payload
-            for (uint8_t byte : nal_unit) {
-                packet.push_back(static_cast<std::byte>(byte));
-            }
-            
-            if (track->send(packet)) {
-                static int sent_count = 0;
-                if (sent_count % 10 == 0) {
-                    std::cout << "📤 Sent NAL unit (type " << (int)nal_type << "-" << nal_type_name 
-                             << ", size: " << packet.size() << " bytes)" << std::endl;
-                }
-                sent_count++;
-            } else {
-                std::cout << "⚠️ Failed to send NAL unit (type " << (int)nal_type << ")" << std::endl;
+        if (first >= 2) {
+            size_t stap_start = buffer.size();
+            buffer.resize(stap_start + 4);  // length prefix, patched below
+            buffer.push_back(static_cast<std::byte>(stap_nri | 24));
+            for (size_t i = 0; i < first; i++) {
+                const NalView& nal = nals[i];
+                buffer.push_back(static_cast<std::byte>(nal.size >> 8));
+                buffer.push_back(static_cast<std::byte>(nal.size));
+                const std::byte* bytes = reinterpret_cast<const std::byte*>(nal.data);
+                buffer.insert(buffer.end(), bytes, bytes + nal.size);
             }
+            // Patch the length prefix now that the aggregate size is known
+            size_t length = buffer.size() - stap_start - 4;
+            buffer[stap_start] = static_cast<std::byte>(length >> 24);
+            buffer[stap_start + 1] = static_cast<std::byte>(length >> 16);
+            buffer[stap_start + 2] = static_cast<std::byte>(length >> 8);
+            buffer[stap_start + 3] = static_cast<std::byte>(length);
         } else {
-            // Fragment large NAL unit into multiple packets
-            std::cout << "📦 Fragmenting large NAL unit (type " << (int)nal_type << "-" << nal_type_name 
-                     << ", " << nal_unit.size() << " bytes) into smaller packets" << std::endl;
-            
-            size_t offset = 0;
-            int fragment_count = 0;
-            bool success = true;
-            
-            while (offset < nal_unit.size() && success) {
-                size_t remaining = nal_unit.size() - offset;
-                size_t fragment_size = std::min(MAX_PACKET_SIZE - START_CODE_SIZE, remaining);
-                
-                // Ensure last fragment is not too small
-                if (remaining > fragment_size && (remaining - fragment_size) < (MIN_PACKET_SIZE - START_CODE_SIZE)) {
-                    fragment_size = remaining; // Include the small remainder in this fragment
-                }
-                
-                // Ensure this fragment meets minimum size
-                if (fragment_size + START_CODE_SIZE < MIN_PACKET_SIZE) {
-                    std::cout << "⚠️ Fragment too small, skipping remainder" << std::endl;
-                    break;
-                }
-                
-                rtc::binary packet;
-                packet.reserve(fragment_size + START_CODE_SIZE);
-                
-                // Add start code for each fragment
-                packet.push_back(static_cast<std::byte>(0x00));
-                packet.push_back(static_cast<std::byte>(0x00));
-                packet.push_back(static_cast<std::byte>(0x00));
-                packet.push_back(static_cast<std::byte>(0x01));
-                
-                // Add fragment data
-                for (size_t i = 0; i < fragment_size; i++) {
-                    packet.push_back(static_cast<std::byte>(nal_unit[offset + i]));
-                }
-                
-                if (track->send(packet)) {
-                    std::cout << "📤 Sent fragment " << fragment_count << " (size: " << packet.size() << " bytes)" << std::endl;
-                } else {
-                    std::cout << "⚠️ Failed to send fragment " << fragment_count << std::endl;
-                    success = false;
-                }
-                
-                offset += fragment_size;
-                fragment_count++;
-                
-                // Small delay between fragments to avoid overwhelming
-                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            first = 0;
+        }
+        
+        // Everything else goes out as single NAL unit packets or FU-A fragments
+        for (size_t i = first; i < nals.size(); i++) {
+            appendNAL(buffer, nals[i].data, nals[i].size);
+        }
+        
+        // Each stream's pts starts wherever it likes; the track's clock only moves forward
+        if (sender.clock_generation != generation) {
+            sender.clock_generation = generation;
+            sender.clock_offset = sender.last_clock < 0.0 ? 0.0 : sender.last_clock + sender.frame_step - pts_seconds;
+        }
+        double clock = pts_seconds + sender.clock_offset;
+        if (clock > sender.last_clock) {
+            if (sender.last_clock >= 0.0 && clock - sender.last_clock < kMaxFrameStep) {
+                sender.frame_step = clock - sender.last_clock;
             }
-            
-            if (success) {
-                std::cout << "✅ Successfully sent " << fragment_count << " fragments for NAL unit type " << (int)nal_type << std::endl;
+            sender.last_clock = clock;
+        }
+        
+        auto& config = sender.rtp_config;
+        config->timestamp = config->startTimestamp + config->secondsToTimestamp(clock);
+        
+        // One RTCP sender report per second maps RTP time to wall clock for the receiver
+        uint32_t since_report = config->timestamp - sender.rtcp_stats->lastReportedTimestamp();
+        if (config->timestampToSeconds(since_report) > 1.0) {
+            sender.rtcp_stats->requestReport();
+        }
+        
+        if (!track->send(buffer.data(), buffer.size())) {
+            sender.send_failures++;
+            // A congested or closing track fails every unit; keep this off the send path's budget
+            LOG_EVERY_MS(logging::Level::Warn, 1000, "⚠️ Failed to send access unit {} ({} bytes)", au.index, buffer.size());
+        } else {
+            sender.frames_sent++;
+            if (sender.timeline && !sender.timeline->reached(Milestone::FirstMediaSent)) {
+                sender.timeline->mark(Milestone::FirstMediaSent);
             }
         }
         
     } catch (const std::exception& e) {
-        std::cerr << "❌ Error sending NAL unit: " << e.what() << std::endl;
+        std::cerr << "❌ Error sending access unit: " << e.what() << std::endl;
     }
 }
 
@@ -1026,8 +1696,9 @@ MockWebRTCManager::MockWebRTCManager(const std::string& thing_name, PublishCallb
     std::cout << "⚠️ WebRTC Manager initialized in MOCK mode (libdatachannel not available)" << std::endl;
 }
 
-bool MockWebRTCManager::handleOffer(const std::string& peer_id, const std::string& offer_sdp) {
-    std::cout << "🤖 MOCK: Handling offer for peer " << peer_id << std::endl;
+bool MockWebRTCManager::handleOffer(const std::string& peer_id, const std::string& offer_sdp,
+                                    SeiTimestampMode) {
+    LOG_INFO("🤖 MOCK: Handling offer for peer {}", peer_id);
     
     // Send mock answer
     std::string answer_topic = thing_name_ + "/robot-control/" + peer_id + "/answer";
@@ -1035,7 +1706,7 @@ bool MockWebRTCManager::handleOffer(const std::string& peer_id, const std::strin
     
     if (publish_callback_) {
         publish_callback_(answer_topic, mock_answer);
-        std::cout << "✅ Mock answer published for peer " << peer_id << std::endl;
+        LOG_INFO("✅ Mock answer published for peer {}", peer_id);
     }
     
     return true;
@@ -1043,7 +1714,7 @@ bool MockWebRTCManager::handleOffer(const std::string& peer_id, const std::strin
 
 bool MockWebRTCManager::handleCandidates(const std::string& peer_id, const Json::Value& candidates) {
 #ifdef JSON_ENABLED
-    std::cout << "🧊 MOCK: Handling " << candidates.size() << " ICE candidates for peer " << peer_id << std::endl;
+    LOG_INFO("🧊 MOCK: Handling {} ICE candidates for peer {}", candidates.size(), peer_id);
     
     // Mock republish to rmcs topic
     std::string rmcs_topic = thing_name_ + "/robot-control/" + peer_id + "/candidate/rmcs";
@@ -1054,27 +1725,32 @@ bool MockWebRTCManager::handleCandidates(const std::string& peer_id, const Json:
     
     if (publish_callback_) {
         publish_callback_(rmcs_topic, candidatesStr);
-        std::cout << "📤 MOCK: Republished ICE candidates to rmcs topic" << std::endl;
+        LOG_INFO("📤 MOCK: Republished ICE candidates to rmcs topic");
     }
     
     return true;
 #else
-    std::cout << "⚠️  MOCK: JSON parsing disabled - cannot handle ICE candidates" << std::endl;
+    LOG_WARN("⚠️  MOCK: JSON parsing disabled - cannot handle ICE candidates");
     return false;
 #endif
 }
 
 bool MockWebRTCManager::startVideoStreaming(const std::string& peer_id, const std::string& images_dir_path) {
-    std::cout << "🎥 MOCK: Starting video streaming for " << peer_id << " with images dir: " << images_dir_path << std::endl;
+    LOG_INFO("🎥 MOCK: Starting video streaming for {} with images dir: {}", peer_id, images_dir_path);
     return true;
 }
 
 void MockWebRTCManager::stopVideoStreaming(const std::string& peer_id) {
-    std::cout << "🛑 MOCK: Stopping video streaming for " << peer_id << std::endl;
+    LOG_INFO("🛑 MOCK: Stopping video streaming for {}", peer_id);
 }
 
 void MockWebRTCManager::closePeerConnection(const std::string& peer_id) {
-    std::cout << "🔒 MOCK: Closed peer connection for " << peer_id << std::endl;
+    LOG_INFO("🔒 MOCK: Closed peer connection for {}", peer_id);
+}
+
+bool MockWebRTCManager::handlePlaybackControl(const std::string& peer_id, const Json::Value& /*command*/) {
+    LOG_INFO("🎛️  MOCK: Ignoring playback control for {}", peer_id);
+    return false;
 }
 
 #endif
\ No newline at end of file
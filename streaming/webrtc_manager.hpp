@@ -7,15 +7,27 @@
 
 #ifdef WEBRTC_ENABLED
 #include <rtc/rtc.hpp>
-#include <thread>
 #include <atomic>
 #include <fstream>
 #include <vector>
 #include <opencv2/opencv.hpp>
+#include <mutex>
+#include "media_source.hpp"
+#include "pacing.hpp"
+#include "h264_encoder.hpp"
+#include "frame_prefetcher.hpp"
+#include "broadcast_source.hpp"
+#include "stream_scheduler.hpp"
+#include "peer_registry.hpp"
+#include "video_streams.hpp"
+#include "metrics_server.hpp"
+#include "control_channel.hpp"
 #endif
 
 #include <json/json.h>
 
+#include "sei_timestamp.hpp"
+
 class WebRTCManager {
 public:
     // Callback type for publishing MQTT messages
@@ -24,8 +36,10 @@ public:
     WebRTCManager(const std::string& thing_name, PublishCallback publish_cb);
     ~WebRTCManager();
     
-    // Handle incoming offer and create peer connection
-    bool handleOffer(const std::string& peer_id, const std::string& offer_sdp);
+    // Handle incoming offer and create peer connection; sei_mode selects the
+    // latency timestamp carried in front of every access unit sent to the peer
+    bool handleOffer(const std::string& peer_id, const std::string& offer_sdp,
+                     SeiTimestampMode sei_mode = defaultSeiTimestampMode());
     
     // Handle ICE candidates array and republish
     bool handleCandidates(const std::string& peer_id, const Json::Value& candidates);
@@ -36,56 +50,164 @@ public:
     // Start live image streaming
     bool startVideoStreaming(const std::string& peer_id, const std::string& images_dir_path);
     
-    // Start H264 file streaming
-    bool startH264FileStreaming(const std::string& peer_id, const std::string& h264_file_path);
+    // Start H264 file streaming on one of the peer's cameras
+    bool startH264FileStreaming(const std::string& peer_id, const std::string& h264_file_path, size_t camera = 0);
     
     // Stop video streaming
     void stopVideoStreaming(const std::string& peer_id);
     
+    // Seek / pause / loop / rate / keyframe / quality of the peer's stream, from
+    // <thing>/robot-control/<peer>/control; the resulting state is published to
+    // <thing>/robot-control/<peer>/playback. Peers whose offer has a data section
+    // send the same commands over their "control" DataChannel instead.
+    bool handlePlaybackControl(const std::string& peer_id, const Json::Value& command);
+    
+#ifdef WEBRTC_ENABLED
+    // Send-time jitter of the current file stream of the peer's first camera
+    bool getPacingStats(const std::string& peer_id, PacingStats& stats);
+    
+    // Per-camera transport, pacing and queue figures for the metrics endpoint
+    StreamingMetrics collectMetrics();
+#endif
+    
     // Get status
     bool isWebRTCEnabled() const;
     
     // Helper function to find video file
     std::string findVideoFile();
     
+    // One recording per camera: /workspace/videos/*.{mp4,h264} grouped by recording, in
+    // name order; camera k of a session plays the k-th. A recording is its
+    // unsuffixed file, or its tallest "_<N>p" rendition if it has no original
+    std::vector<std::string> findVideoFiles();
+    
     // Test pattern streaming for debugging
-    void startTestPatternStreaming(const std::string& peer_id);
+    void startTestPatternStreaming(const std::string& peer_id, size_t camera = 0);
     
 private:
     std::string thing_name_;
     PublishCallback publish_callback_;
     
 #ifdef WEBRTC_ENABLED
-    // Store peer connections by peerId
-    std::map<std::string, std::shared_ptr<rtc::PeerConnection>> peer_connections_;
-    
-    // Store video tracks by peerId
-    std::map<std::string, std::shared_ptr<rtc::Track>> video_tracks_;
-    
-    // Streaming control
-    std::map<std::string, std::atomic<bool>> streaming_active_;
-    std::map<std::string, std::thread> streaming_threads_;
+    // Connection, track, RTP sender and streaming state of every peer
+    PeerRegistry peers_;
+    
+    static constexpr uint8_t kH264PayloadType = 96;
+    static constexpr size_t kMaxRtpPayload = 1200;  // safe under a 1280-byte path MTU
+    static constexpr double kMaxFrameStep = 1.0;    // longer gaps (pauses) are not a frame interval
+    
+    // Streaming control: the scheduled stream (or pending start) of each camera
+    class PeerOutput;
+    void setPeerStream(PeerSession& session, CameraTrack& camera,
+                       const std::function<StreamScheduler::StreamId()>& schedule);
+    void stopCameraStreaming(PeerSession& session, CameraTrack& camera);
+    void stopSessionStreaming(PeerSession& session);
+    bool startFileStream(PeerSession& session, CameraTrack& camera, const std::string& path,
+                         std::shared_ptr<const MediaSource> source, std::shared_ptr<PlaybackControl> playback,
+                         StreamScheduler::Clock::duration delay);
+    
+    // Multi-camera sessions: one send-only video track per video section of
+    // the offer (up to the number of recordings and kMaxCameras), all bundled
+    // on the peer connection's single ICE/DTLS transport. Each camera has its
+    // own RTP sender and paced stream on the shared scheduler. The client
+    // picks which cameras stream from the control plane, without renegotiating.
+    void addCameraTrack(const PeerSessionPtr& session, const CameraTrackPtr& camera, SeiTimestampMode sei_mode);
+    void startCamera(const std::string& peer_id, size_t index);
+    void setActiveCameras(PeerSession& session, uint32_t mask);
+    static uint32_t activeCameras(PeerSession& session);
+    
+    // Low-latency control plane: a negotiated DataChannel on SCTP stream 1 that
+    // carries binary commands (control_channel.hpp) from the client and
+    // telemetry back, every second by default and in reply to each command
+    static constexpr uint16_t kControlChannelId = 1;
+    static constexpr std::chrono::milliseconds kDefaultTelemetryInterval{1000};
+    static constexpr size_t kMaxTelemetryBacklog = 1024;  // bytes queued before periodic reports are skipped
+    void setupControlChannel(const PeerSessionPtr& session);
+    void setTelemetryInterval(const PeerSessionPtr& session, std::chrono::milliseconds interval);
+    bool sendTelemetry(PeerSession& session, CameraTrack& camera, std::optional<ControlResult> result);
+    ControlTelemetry telemetryFor(PeerSession& session, CameraTrack& camera);
+    ControlResult applyControl(PeerSession& session, const ControlCommand& command);
     
     // WebRTC configuration
     rtc::Configuration getRTCConfig();
     
     // Create peer connection for specific peerId
-    std::shared_ptr<rtc::PeerConnection> createPeerConnection(const std::string& peer_id);
+    std::shared_ptr<rtc::PeerConnection> createPeerConnection(const PeerSessionPtr& session);
     
     // Handle ICE candidates
-    void setupICEHandling(const std::string& peer_id, std::shared_ptr<rtc::PeerConnection> pc);
-    
-    // Live image streaming methods
-    void streamImagesFromDirectory(const std::string& peer_id, const std::string& images_dir);
+    void setupICEHandling(const PeerSessionPtr& session, std::shared_ptr<rtc::PeerConnection> pc);
+    
+    // Local candidates are published when gathering completes, or with
+    // TRICKLE_ICE=1 as they are gathered, coalesced over a short window
+    // (TRICKLE_ICE_COALESCE_MS, default 20) into one message
+    bool trickle_ice_ = false;
+    std::chrono::milliseconds candidate_coalesce_{20};
+    void publishLocalCandidates(PeerSession& session);
+    
+    void publishAnswer(const std::string& peer_id, const std::string& sdp_answer);
+    
+    // Connection-setup timeline of each session, published as JSON to
+    // <thing>/robot-control/<peer>/timeline with percentiles over recent sessions
+    TimelineStats timeline_stats_;
+    void publishTimeline(const std::string& peer_id, SessionTimeline& timeline, const std::string& outcome);
+    
+    // An offer for a peer that already has a live session, from the same
+    // client session (SDP o= line): a retransmission gets the answer again,
+    // an older version is dropped, a newer one renegotiates in place. False
+    // if the session should be replaced instead.
+    bool handleRepeatedOffer(PeerSession& session, const std::string& offer_sdp,
+                             const std::string& origin_id, uint64_t origin_version);
+    
+    // Remote candidates that arrive before the peer's offer (or before the
+    // offer of a reloaded client, going by their ICE ufrag) are held for a
+    // while and applied right after its remote description is set
+    struct PendingCandidates {
+        Json::Value candidates{Json::arrayValue};
+        std::chrono::steady_clock::time_point received;  // last arrival
+    };
+    static constexpr std::chrono::seconds kPendingCandidateTtl{15};
+    static constexpr Json::ArrayIndex kMaxPendingCandidates = 64;
+    std::mutex pending_mutex_;
+    std::map<std::string, PendingCandidates> pending_candidates_;
+    void bufferEarlyCandidates(const std::string& peer_id, const Json::Value& candidates);
+    Json::Value takeEarlyCandidates(const std::string& peer_id);
+    static void addRemoteCandidates(rtc::PeerConnection& pc, const Json::Value& candidates);
+    
+    // Live image streaming methods (first camera)
+    void startImageStream(const std::string& peer_id, const std::string& images_dir);
     std::vector<std::string> getImageFiles(const std::string& directory);
-    cv::Mat loadAndResizeImage(const std::string& image_path);
-    void sendH264Frame(std::shared_ptr<rtc::Track> track, const cv::Mat& frame);
-    std::vector<uint8_t> encodeFrameToH264(const cv::Mat& frame);
+    
+    // Image decoding for all directory streams, ahead of their senders
+    DecodePool decode_pool_;
+    
+    // Broadcast mode (STREAM_BROADCAST=1): cameras of any peer showing the same
+    // file or image directory share one producer, keyed by "file:<path>" / "images:<dir>"
+    bool broadcast_enabled_ = false;
+    std::mutex broadcasts_mutex_;
+    std::map<std::string, std::shared_ptr<BroadcastSource>> broadcasts_;
+    using ProducerFactory = std::function<std::shared_ptr<ScheduledStream>(std::shared_ptr<BroadcastSource>)>;
+    bool joinBroadcast(PeerSession& session, CameraTrack& camera, const std::string& key,
+                       const ProducerFactory& make_producer);
+    void leaveBroadcast(PeerSession& session, CameraTrack& camera);
+    
+    // Mapped video files shared by all peers
+    MediaSourceCache media_cache_;
     
     // H.264 NAL unit processing
-    std::vector<std::vector<uint8_t>> extractNALUnits(const std::vector<uint8_t>& mp4_data);
-    std::vector<uint8_t> applyEmulationPrevention(const std::vector<uint8_t>& nal_unit);
-    void sendNALUnit(std::shared_ptr<rtc::Track> track, const std::vector<uint8_t>& nal_unit);
+    // generation is the sender's beginStream() value for the calling stream; units of
+    // an older generation are dropped. capture_ms is the frame's capture time (Unix ms)
+    // if the source knows it, else 0
+    static void sendAccessUnit(std::shared_ptr<rtc::Track> track, VideoSender& sender, uint64_t generation,
+                               const AccessUnit& au, double pts_seconds, int64_t capture_ms = 0);
+    static void appendNAL(rtc::binary& buffer, const uint8_t* data, size_t size);
+    
+    // Every stream of every peer runs on this fixed worker pool. Declared
+    // after what the streams use so it stops, and finishes its streams, first.
+    StreamScheduler scheduler_;
+    
+    // Loads recordings for startCamera() off the stream workers. Declared last:
+    // it drains before the scheduler and cache its jobs call into are gone.
+    DecodePool loader_{1};
 #endif
 };
 
@@ -96,11 +218,13 @@ public:
     using PublishCallback = std::function<void(const std::string& topic, const std::string& message)>;
     
     MockWebRTCManager(const std::string& thing_name, PublishCallback publish_cb);
-    bool handleOffer(const std::string& peer_id, const std::string& offer_sdp);
+    bool handleOffer(const std::string& peer_id, const std::string& offer_sdp,
+                     SeiTimestampMode sei_mode = defaultSeiTimestampMode());
     bool handleCandidates(const std::string& peer_id, const Json::Value& candidates);
     bool startVideoStreaming(const std::string& peer_id, const std::string& images_dir_path);
     void stopVideoStreaming(const std::string& peer_id);
     void closePeerConnection(const std::string& peer_id);
+    bool handlePlaybackControl(const std::string& peer_id, const Json::Value& command);
     bool isWebRTCEnabled() const { return false; }
     
 private: